@@ -0,0 +1,100 @@
+#include "arena.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const struct _object arena_object = {
+    (void   (*) (void *)) arena_delete,
+    (void * (*) (void *)) arena_copy,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+struct _arena * arena_create ()
+{
+    struct _arena * arena;
+
+    arena = (struct _arena *) malloc(sizeof(struct _arena));
+    arena->object = &arena_object;
+    arena->refs   = 1;
+    arena->chunks = NULL;
+    arena->top    = NULL;
+    arena->end    = NULL;
+    memset(arena->free_blocks, 0, sizeof(arena->free_blocks));
+
+    return arena;
+}
+
+
+void arena_delete (struct _arena * arena)
+{
+    if (! object_release(arena))
+        return;
+
+    struct _arena_chunk * chunk = arena->chunks;
+    while (chunk != NULL) {
+        struct _arena_chunk * next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    free(arena);
+}
+
+
+// arenas are shared, never copied
+struct _arena * arena_copy (struct _arena * arena)
+{
+    return object_share(arena);
+}
+
+
+void * arena_alloc (struct _arena * arena, size_t size)
+{
+    void * block;
+
+    if (arena == NULL)
+        return malloc(size);
+
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+    if (size > ARENA_MAX_BLOCK)
+        return malloc(size);
+
+    // reuse a freed block of the same class
+    size_t class = size / ARENA_ALIGN - 1;
+    if (arena->free_blocks[class] != NULL) {
+        block = arena->free_blocks[class];
+        arena->free_blocks[class] = *((void **) block);
+        return block;
+    }
+
+    if (arena->top + size > arena->end) {
+        struct _arena_chunk * chunk = malloc(ARENA_CHUNK_SIZE);
+        chunk->next   = arena->chunks;
+        arena->chunks = chunk;
+        // the chunk header is padded out so blocks stay aligned
+        arena->top    = (uint8_t *) chunk + ARENA_ALIGN;
+        arena->end    = (uint8_t *) chunk + ARENA_CHUNK_SIZE;
+    }
+
+    block = arena->top;
+    arena->top += size;
+
+    return block;
+}
+
+
+void arena_free (struct _arena * arena, void * block, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+    if ((arena == NULL) || (size > ARENA_MAX_BLOCK)) {
+        free(block);
+        return;
+    }
+
+    size_t class = size / ARENA_ALIGN - 1;
+    *((void **) block) = arena->free_blocks[class];
+    arena->free_blocks[class] = block;
+}
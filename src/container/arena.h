@@ -0,0 +1,54 @@
+#ifndef arena_HEADER
+#define arena_HEADER
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "object.h"
+
+/*
+* An arena hands out small blocks of memory carved from large chunks. Freed
+* blocks go on a free list for their size class and are handed out again, and
+* every chunk is released at once when the arena is deleted.
+*
+* Containers opt in by being created with an arena (list_create_arena,
+* tree_create_arena, graph_create_arena). They then take the memory for their
+* own bookkeeping (list links, tree nodes) from it instead of malloc. Payload
+* objects are still allocated by whoever creates them.
+*
+* Arenas are reference counted. Every container created with an arena holds a
+* reference, so an arena lives as long as the last structure using it. Arenas
+* are not thread safe: a structure built in an arena must only be modified by
+* one thread at a time. Copies of a container do not share its arena.
+*/
+
+#define ARENA_CHUNK_SIZE  (64 * 1024)
+#define ARENA_ALIGN       16
+// blocks larger than this are passed through to malloc and free
+#define ARENA_MAX_BLOCK   256
+#define ARENA_CLASSES     (ARENA_MAX_BLOCK / ARENA_ALIGN)
+
+struct _arena_chunk {
+    struct _arena_chunk * next;
+};
+
+struct _arena {
+    const struct _object * object;
+    unsigned int refs;
+    struct _arena_chunk  * chunks;
+    uint8_t              * top;
+    uint8_t              * end;
+    void                 * free_blocks[ARENA_CLASSES];
+};
+
+struct _arena * arena_create ();
+void            arena_delete (struct _arena * arena);
+struct _arena * arena_copy   (struct _arena * arena);
+
+// a NULL arena passes straight through to malloc and free, so containers can
+// call these whether or not they were given an arena
+void *          arena_alloc  (struct _arena * arena, size_t size);
+// size must be the size the block was allocated with
+void            arena_free   (struct _arena * arena, void * block, size_t size);
+
+#endif
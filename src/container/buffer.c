@@ -9,7 +9,8 @@ static const struct _object buffer_object = {
     (void *   (*) (void *)) buffer_copy,
     NULL,
     NULL,
-    (json_t * (*) (void *)) buffer_serialize
+    (json_t * (*) (void *)) buffer_serialize,
+    (void *   (*) (void *)) buffer_clone
 };
 
 
@@ -18,6 +19,7 @@ struct _buffer * buffer_create (const uint8_t * bytes, size_t size)
     struct _buffer * buffer = (struct _buffer *) malloc(sizeof(struct _buffer));
 
     buffer->object      = &buffer_object;
+    buffer->refs        = 1;
     buffer->bytes       = (uint8_t *) malloc(size);
     buffer->size        = size;
     buffer->permissions = 0;
@@ -33,6 +35,7 @@ struct _buffer * buffer_create_null (size_t size)
     struct _buffer * buffer = (struct _buffer *) malloc(sizeof(struct _buffer));
 
     buffer->object      = &buffer_object;
+    buffer->refs        = 1;
     buffer->bytes       = (uint8_t *) malloc(size);
     buffer->size        = size;
     buffer->permissions = 0;
@@ -45,6 +48,8 @@ struct _buffer * buffer_create_null (size_t size)
 
 void buffer_delete (struct _buffer * buffer)
 {
+    if (! object_release(buffer))
+        return;
     free(buffer->bytes);
     free(buffer);
 }
@@ -52,7 +57,15 @@ void buffer_delete (struct _buffer * buffer)
 
 struct _buffer * buffer_copy (struct _buffer * buffer)
 {
-    return buffer_create(buffer->bytes, buffer->size);
+    return object_share(buffer);
+}
+
+
+struct _buffer * buffer_clone (struct _buffer * buffer)
+{
+    struct _buffer * new_buffer = buffer_create(buffer->bytes, buffer->size);
+    new_buffer->permissions = buffer->permissions;
+    return new_buffer;
 }
 
 
@@ -11,8 +11,10 @@
 #define BUFFER_WRITE   (1 << 1)
 #define BUFFER_EXECUTE (1 << 2)
 
+// buffers are reference counted, see object.h
 struct _buffer {
     const struct _object * object;
+    unsigned int refs;
     uint32_t  permissions;
     uint8_t * bytes;
     size_t    size;
@@ -22,6 +24,7 @@ struct _buffer * buffer_create      (const uint8_t * bytes, size_t size);
 struct _buffer * buffer_create_null (size_t size);
 void             buffer_delete      (struct _buffer * buffer);
 struct _buffer * buffer_copy        (struct _buffer * buffer);
+struct _buffer * buffer_clone       (struct _buffer * buffer);
 json_t *         buffer_serialize   (struct _buffer * buffer);
 struct _buffer * buffer_deserialize (json_t * json);
 
@@ -0,0 +1,176 @@
+#include "function_index.h"
+
+#include "function.h"
+
+static const struct _object function_index_object = {
+    (void   (*) (void *)) function_index_delete,
+    (void * (*) (void *)) function_index_copy,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+int function_index_entry_cmp (const void * lhs, const void * rhs)
+{
+    const struct _function_index_entry * a = lhs;
+    const struct _function_index_entry * b = rhs;
+
+    if (a->lower < b->lower)
+        return -1;
+    else if (a->lower > b->lower)
+        return 1;
+    else if (a->address < b->address)
+        return -1;
+    else if (a->address > b->address)
+        return 1;
+    return 0;
+}
+
+
+struct _function_index * function_index_create (struct _map * functions)
+{
+    size_t size = 0;
+    struct _function_index_entry * entries;
+    entries = malloc(sizeof(struct _function_index_entry) * (functions->size + 1));
+
+    struct _map_it * it;
+    for (it = map_iterator(functions); it != NULL; it = map_it_next(it)) {
+        struct _function * function = map_it_data(it);
+        if (function->bounds.lower >= function->bounds.upper)
+            continue;
+        entries[size].lower   = function->bounds.lower;
+        entries[size].upper   = function->bounds.upper;
+        entries[size].address = function->address;
+        size++;
+    }
+
+    qsort(entries, size, sizeof(struct _function_index_entry),
+          function_index_entry_cmp);
+
+    size_t slots = 1;
+    while (slots < size)
+        slots <<= 1;
+
+    // unused leaves reach 0, so every query prunes them
+    uint64_t * reach = calloc(slots * 2, sizeof(uint64_t));
+    size_t i;
+    for (i = 0; i < size; i++)
+        reach[slots + i] = entries[i].upper;
+    for (i = slots - 1; i > 0; i--) {
+        if (reach[i * 2] > reach[i * 2 + 1])
+            reach[i] = reach[i * 2];
+        else
+            reach[i] = reach[i * 2 + 1];
+    }
+
+    struct _function_index * index = malloc(sizeof(struct _function_index));
+    index->object  = &function_index_object;
+    index->refs    = 1;
+    index->size    = size;
+    index->entries = entries;
+    index->slots   = slots;
+    index->reach   = reach;
+
+    return index;
+}
+
+
+void function_index_delete (struct _function_index * index)
+{
+    if (! object_release(index))
+        return;
+
+    free(index->entries);
+    free(index->reach);
+    free(index);
+}
+
+
+// indexes never change, so copies are shared
+struct _function_index * function_index_copy (struct _function_index * index)
+{
+    return object_share(index);
+}
+
+
+// the number of entries whose lower bound is below address
+size_t function_index_below (struct _function_index * index, uint64_t address)
+{
+    size_t lo = 0;
+    size_t hi = index->size;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->entries[mid].lower < address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+struct _function_index_frame {
+    size_t node;
+    size_t start;
+    size_t width;
+};
+
+
+// only entries below the first lower bound at or past upper can overlap, and
+// of those only the ones in subtrees reaching past lower. the stack holds at
+// most one pending sibling per level of the tree
+size_t function_index_overlap (struct _function_index * index,
+                               uint64_t                 lower,
+                               uint64_t                 upper,
+                               void                  (* callback) (uint64_t, void *),
+                               void                   * data)
+{
+    size_t below = function_index_below(index, upper);
+    size_t found = 0;
+
+    struct _function_index_frame stack[sizeof(size_t) * 8 + 1];
+    size_t top = 0;
+
+    stack[top].node  = 1;
+    stack[top].start = 0;
+    stack[top].width = index->slots;
+    top++;
+
+    while (top > 0) {
+        struct _function_index_frame frame = stack[--top];
+
+        if ((frame.start >= below) || (index->reach[frame.node] <= lower))
+            continue;
+
+        if (frame.width == 1) {
+            callback(index->entries[frame.start].address, data);
+            found++;
+            continue;
+        }
+
+        // right first, so entries come off the stack in order
+        size_t half = frame.width / 2;
+        stack[top].node  = frame.node * 2 + 1;
+        stack[top].start = frame.start + half;
+        stack[top].width = half;
+        top++;
+        stack[top].node  = frame.node * 2;
+        stack[top].start = frame.start;
+        stack[top].width = half;
+        top++;
+    }
+
+    return found;
+}
+
+
+size_t function_index_containing (struct _function_index * index,
+                                  uint64_t                 address,
+                                  void                  (* callback) (uint64_t, void *),
+                                  void                   * data)
+{
+    return function_index_overlap(index, address, address + 1, callback, data);
+}
@@ -0,0 +1,63 @@
+#ifndef function_index_HEADER
+#define function_index_HEADER
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "map.h"
+#include "object.h"
+
+/*
+* A function_index answers which functions' bounds overlap a range of
+* addresses, or contain one address, in O((k + 1) log F) for k functions found
+* among F. Bounds are half open, as rdis sets them, and functions whose bounds
+* are empty are left out.
+*
+* Functions are sorted on their lower bound, and a max tree over their upper
+* bounds prunes everything which ends before the range starts.
+*
+* The index copies the bounds it needs, so it is a snapshot which must be
+* built again once bounds change or functions are added or removed. Indexes
+* are reference counted and copies are shared.
+*/
+
+struct _function_index_entry {
+    uint64_t lower;
+    uint64_t upper;
+    uint64_t address;
+};
+
+struct _function_index {
+    const struct _object * object;
+    unsigned int refs;
+    size_t       size;
+    // sorted by lower bound, and then by address
+    struct _function_index_entry * entries;
+    // reach[slots + i] is the upper bound of entry i, and every other node is
+    // the greatest of its two children. slots is a power of two
+    size_t       slots;
+    uint64_t   * reach;
+};
+
+
+// functions is a map of struct _function, like rdis->functions
+struct _function_index * function_index_create (struct _map * functions);
+void                     function_index_delete (struct _function_index * index);
+struct _function_index * function_index_copy   (struct _function_index * index);
+
+// calls callback with the address of every function whose bounds overlap
+// lower to upper, upper not included, in order of their lower bounds.
+// returns the number of functions found
+size_t function_index_overlap (struct _function_index * index,
+                               uint64_t                 lower,
+                               uint64_t                 upper,
+                               void                  (* callback) (uint64_t, void *),
+                               void                   * data);
+
+// like function_index_overlap, for the functions whose bounds hold address
+size_t function_index_containing (struct _function_index * index,
+                                  uint64_t                 address,
+                                  void                  (* callback) (uint64_t, void *),
+                                  void                   * data);
+
+#endif
@@ -5,6 +5,7 @@
 #include "queue.h"
 
 #include <stdio.h>
+#include <string.h>
 
 static const struct _object graph_edge_object = {
     (void     (*) (void *))         graph_edge_delete, 
@@ -22,6 +23,14 @@ static const struct _object graph_node_object = {
     (json_t * (*) (void *))         graph_node_serialize
 };
 
+static const struct _object graph_walk_object = {
+    (void     (*) (void *))         graph_walk_delete,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
 static const struct _object graph_object = {
     (void     (*) (void *))         graph_delete,
     (void *   (*) (void *))         graph_copy,
@@ -37,11 +46,18 @@ void graph_debug (struct _graph * graph)
 {
     struct _graph_it * it;
     for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
-        struct _list_it * edge_it;
+        struct _graph_node * node = graph_it_node(it);
         struct _graph_edge * edge;
+        size_t e;
         printf("%llx [ ", (unsigned long long) graph_it_index(it));
-        for (edge_it = list_iterator(graph_it_edges(it)); edge_it != NULL; edge_it = edge_it->next) {
-            edge = edge_it->data;
+        for (e = 0; e < node->predecessors.size; e++) {
+            edge = node->predecessors.edges[e];
+            printf("(%llx -> %llx) ",
+                   (unsigned long long) edge->head,
+                   (unsigned long long) edge->tail);
+        }
+        for (e = 0; e < node->successors.size; e++) {
+            edge = node->successors.edges[e];
             printf("(%llx -> %llx) ",
                    (unsigned long long) edge->head,
                    (unsigned long long) edge->tail);
@@ -71,6 +87,323 @@ void graph_debug (struct _graph * graph)
 
 
 
+uint64_t graph_edge_hash (uint64_t head, uint64_t tail)
+{
+    uint64_t hash = (head * 0x9e3779b97f4a7c15ULL) ^ tail;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+
+// returns the slot holding the edge from head to tail, or the empty slot it
+// would go in
+size_t graph_edge_table_slot (struct _graph * graph, uint64_t head, uint64_t tail)
+{
+    size_t mask = graph->edge_table_slots - 1;
+    size_t slot = graph_edge_hash(head, tail) & mask;
+
+    while (graph->edge_table[slot] != NULL) {
+        if (    (graph->edge_table[slot]->head == head)
+             && (graph->edge_table[slot]->tail == tail))
+            break;
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+
+// the slot holding edge, found by address so other edges are not touched
+size_t graph_edge_table_slot_of (struct _graph * graph, struct _graph_edge * edge)
+{
+    size_t mask = graph->edge_table_slots - 1;
+    size_t slot = graph_edge_hash(edge->head, edge->tail) & mask;
+
+    while (graph->edge_table[slot] != edge)
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+
+void graph_edge_table_grow (struct _graph * graph)
+{
+    struct _graph_edge ** old_table = graph->edge_table;
+    size_t                old_slots = graph->edge_table_slots;
+
+    if (old_slots == 0)
+        graph->edge_table_slots = 16;
+    else
+        graph->edge_table_slots = old_slots * 2;
+    graph->edge_table = calloc(graph->edge_table_slots,
+                               sizeof(struct _graph_edge *));
+
+    size_t i;
+    for (i = 0; i < old_slots; i++) {
+        struct _graph_edge * edge = old_table[i];
+        if (edge == NULL)
+            continue;
+        graph->edge_table[graph_edge_table_slot(graph, edge->head, edge->tail)] = edge;
+    }
+
+    free(old_table);
+}
+
+
+struct _graph_edge * graph_edge_table_fetch (struct _graph * graph,
+                                             uint64_t        head,
+                                             uint64_t        tail)
+{
+    if (graph->edge_table_slots == 0)
+        return NULL;
+    return graph->edge_table[graph_edge_table_slot(graph, head, tail)];
+}
+
+
+// returns 0 if edge was added, -1 if the graph already has an edge from its
+// head to its tail
+int graph_edge_table_insert (struct _graph * graph, struct _graph_edge * edge)
+{
+    // keep the table at most half full
+    if ((graph->edge_table_size + 1) * 2 > graph->edge_table_slots)
+        graph_edge_table_grow(graph);
+
+    size_t slot = graph_edge_table_slot(graph, edge->head, edge->tail);
+    if (graph->edge_table[slot] != NULL)
+        return -1;
+
+    graph->edge_table[slot] = edge;
+    graph->edge_table_size++;
+
+    return 0;
+}
+
+
+// takes the edge from head to tail out of the table and returns it, or NULL
+// if there is no such edge. the edge is not deleted
+struct _graph_edge * graph_edge_table_remove (struct _graph * graph,
+                                              uint64_t        head,
+                                              uint64_t        tail)
+{
+    if (graph->edge_table_slots == 0)
+        return NULL;
+
+    size_t mask = graph->edge_table_slots - 1;
+    size_t hole = graph_edge_table_slot(graph, head, tail);
+    struct _graph_edge * edge = graph->edge_table[hole];
+    if (edge == NULL)
+        return NULL;
+
+    // there are no tombstones. instead, edges further along the probe run are
+    // shifted back into the hole unless that would put them before their home
+    // slot
+    size_t next = hole;
+    while (1) {
+        next = (next + 1) & mask;
+        if (graph->edge_table[next] == NULL)
+            break;
+        size_t home = graph_edge_hash(graph->edge_table[next]->head,
+                                      graph->edge_table[next]->tail) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            graph->edge_table[hole] = graph->edge_table[next];
+            hole = next;
+        }
+    }
+
+    graph->edge_table[hole] = NULL;
+    graph->edge_table_size--;
+
+    return edge;
+}
+
+
+uint64_t graph_node_hash (uint64_t index)
+{
+    uint64_t hash = index * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    return hash ^ (hash >> 31);
+}
+
+
+/*
+* The node table works like the edge table: linear probing, at most half full,
+* and backward shifting instead of tombstones on removal.
+*/
+size_t graph_node_table_slot (struct _graph * graph, uint64_t index)
+{
+    size_t mask = graph->node_table_slots - 1;
+    size_t slot = graph_node_hash(index) & mask;
+
+    while (    (graph->node_table[slot] != NULL)
+            && (graph->node_table[slot]->index != index))
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+
+void graph_node_table_grow (struct _graph * graph)
+{
+    struct _graph_node ** old_table = graph->node_table;
+    size_t                old_slots = graph->node_table_slots;
+
+    if (old_slots == 0)
+        graph->node_table_slots = 16;
+    else
+        graph->node_table_slots = old_slots * 2;
+    graph->node_table = calloc(graph->node_table_slots,
+                               sizeof(struct _graph_node *));
+
+    size_t i;
+    for (i = 0; i < old_slots; i++) {
+        struct _graph_node * node = old_table[i];
+        if (node == NULL)
+            continue;
+        graph->node_table[graph_node_table_slot(graph, node->index)] = node;
+    }
+
+    free(old_table);
+}
+
+
+// returns 0 if node was added, -1 if the graph already has a node at its index
+int graph_node_table_insert (struct _graph * graph, struct _graph_node * node)
+{
+    if ((graph->node_table_size + 1) * 2 > graph->node_table_slots)
+        graph_node_table_grow(graph);
+
+    size_t slot = graph_node_table_slot(graph, node->index);
+    if (graph->node_table[slot] != NULL)
+        return -1;
+
+    graph->node_table[slot] = node;
+    graph->node_table_size++;
+
+    return 0;
+}
+
+
+void graph_node_table_remove (struct _graph * graph, uint64_t index)
+{
+    if (graph->node_table_slots == 0)
+        return;
+
+    size_t mask = graph->node_table_slots - 1;
+    size_t hole = graph_node_table_slot(graph, index);
+    if (graph->node_table[hole] == NULL)
+        return;
+
+    size_t next = hole;
+    while (1) {
+        next = (next + 1) & mask;
+        if (graph->node_table[next] == NULL)
+            break;
+        size_t home = graph_node_hash(graph->node_table[next]->index) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            graph->node_table[hole] = graph->node_table[next];
+            hole = next;
+        }
+    }
+
+    graph->node_table[hole] = NULL;
+    graph->node_table_size--;
+}
+
+
+// appends edge to an edge array and returns where it was put
+size_t graph_edges_append (struct _arena       * arena,
+                           struct _graph_edges * edges,
+                           struct _graph_edge  * edge)
+{
+    if (edges->size == edges->capacity) {
+        size_t capacity = edges->capacity * 2;
+        if (capacity == 0)
+            capacity = 2;
+
+        struct _graph_edge ** new_edges;
+        new_edges = arena_alloc(arena, sizeof(struct _graph_edge *) * capacity);
+        if (edges->edges != NULL) {
+            memcpy(new_edges,
+                   edges->edges,
+                   sizeof(struct _graph_edge *) * edges->size);
+            arena_free(arena,
+                       edges->edges,
+                       sizeof(struct _graph_edge *) * edges->capacity);
+        }
+
+        edges->edges    = new_edges;
+        edges->capacity = capacity;
+    }
+
+    edges->edges[edges->size] = edge;
+
+    return edges->size++;
+}
+
+
+// sizes an empty array for capacity edges. the array is allocated with malloc
+void graph_edges_reserve (struct _graph_edges * edges, size_t capacity)
+{
+    if (capacity == 0)
+        return;
+    edges->edges    = malloc(sizeof(struct _graph_edge *) * capacity);
+    edges->capacity = capacity;
+}
+
+
+// frees the array, but not the edges in it
+void graph_edges_free (struct _arena * arena, struct _graph_edges * edges)
+{
+    if (edges->edges != NULL)
+        arena_free(arena,
+                   edges->edges,
+                   sizeof(struct _graph_edge *) * edges->capacity);
+
+    edges->edges    = NULL;
+    edges->size     = 0;
+    edges->capacity = 0;
+}
+
+
+/*
+* Edges are unlinked from a node's arrays by moving the last edge of the array
+* into their place, so they are removed in constant time but the order of the
+* remaining edges changes.
+*/
+void graph_node_link_successor (struct _graph_node * node,
+                                struct _graph_edge * edge)
+{
+    edge->successors_pos = graph_edges_append(node->arena, &(node->successors), edge);
+}
+
+
+void graph_node_link_predecessor (struct _graph_node * node,
+                                  struct _graph_edge * edge)
+{
+    edge->predecessors_pos = graph_edges_append(node->arena, &(node->predecessors), edge);
+}
+
+
+void graph_node_unlink_successor (struct _graph_node * node,
+                                  struct _graph_edge * edge)
+{
+    struct _graph_edge * last = node->successors.edges[--node->successors.size];
+    node->successors.edges[edge->successors_pos] = last;
+    last->successors_pos = edge->successors_pos;
+}
+
+
+void graph_node_unlink_predecessor (struct _graph_node * node,
+                                    struct _graph_edge * edge)
+{
+    struct _graph_edge * last = node->predecessors.edges[--node->predecessors.size];
+    node->predecessors.edges[edge->predecessors_pos] = last;
+    last->predecessors_pos = edge->predecessors_pos;
+}
+
+
+
 struct _graph * graph_create ()
 {
     struct _graph * graph;
@@ -78,6 +411,35 @@ struct _graph * graph_create ()
     graph = (struct _graph *) malloc(sizeof(struct _graph));
     graph->object = &graph_object;
     graph->nodes = tree_create();
+    graph->arena = NULL;
+    graph->edge_table       = NULL;
+    graph->edge_table_size  = 0;
+    graph->edge_table_slots = 0;
+    graph->node_table       = NULL;
+    graph->node_table_size  = 0;
+    graph->node_table_slots = 0;
+
+    return graph;
+}
+
+
+
+struct _graph * graph_create_arena (struct _arena * arena)
+{
+    struct _graph * graph;
+
+    graph = (struct _graph *) malloc(sizeof(struct _graph));
+    graph->object = &graph_object;
+    graph->nodes = tree_create_arena(arena);
+    graph->arena = NULL;
+    if (arena != NULL)
+        graph->arena = object_share(arena);
+    graph->edge_table       = NULL;
+    graph->edge_table_size  = 0;
+    graph->edge_table_slots = 0;
+    graph->node_table       = NULL;
+    graph->node_table_size  = 0;
+    graph->node_table_slots = 0;
 
     return graph;
 }
@@ -87,6 +449,17 @@ struct _graph * graph_create ()
 void graph_delete (struct _graph * graph)
 {
     tree_delete(graph->nodes);
+    if (graph->arena != NULL)
+        object_delete(graph->arena);
+
+    size_t i;
+    for (i = 0; i < graph->edge_table_slots; i++) {
+        if (graph->edge_table[i] != NULL)
+            object_delete(graph->edge_table[i]);
+    }
+    free(graph->edge_table);
+    free(graph->node_table);
+
     free(graph);
 }
 
@@ -97,20 +470,57 @@ struct _graph * graph_copy (struct _graph * graph)
 
     new_graph = graph_create();
 
-    // we have to manually enter the new graph nodes. copying them will cause
-    // them to point to the old graph
-    struct _graph_it * it;
-    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
-        graph_add_node(new_graph, graph_it_index(it), graph_it_data(it));
+    // copying the node tree copies every node, without its edges, in one
+    // linear pass
+    object_delete(new_graph->nodes);
+    new_graph->nodes = object_copy(graph->nodes);
+
+    // the edge table is copied slot for slot, so every copied edge is found
+    // in the same slot as its original
+    size_t i;
+    if (graph->edge_table_slots > 0) {
+        new_graph->edge_table = calloc(graph->edge_table_slots,
+                                       sizeof(struct _graph_edge *));
+        for (i = 0; i < graph->edge_table_slots; i++) {
+            if (graph->edge_table[i] != NULL)
+                new_graph->edge_table[i] = object_copy(graph->edge_table[i]);
+        }
     }
-
+    new_graph->edge_table_size  = graph->edge_table_size;
+    new_graph->edge_table_slots = graph->edge_table_slots;
+
+    // the node table is laid out the same way
+    if (graph->node_table_slots > 0)
+        new_graph->node_table = calloc(graph->node_table_slots,
+                                       sizeof(struct _graph_node *));
+    new_graph->node_table_size  = graph->node_table_size;
+    new_graph->node_table_slots = graph->node_table_slots;
+
+    // both node trees are in index order, so walk them side by side. point
+    // the copied nodes at the new graph and at the copied edges, in the same
+    // order as the originals
+    struct _graph_it * it;
+    struct _graph_it * new_it = graph_iterator(new_graph);
     for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
-        struct _list * edges = graph_it_edges(it);
-        struct _list_it * eit;
-        for (eit = list_iterator(edges); eit != NULL; eit = eit->next) {
-            struct _graph_edge * edge = eit->data;
-            graph_add_edge(new_graph, edge->head, edge->tail, edge->data);
+        struct _graph_node * node     = graph_it_node(it);
+        struct _graph_node * new_node = graph_it_node(new_it);
+        new_node->graph = new_graph;
+        new_graph->node_table[graph_node_table_slot(graph, node->index)] = new_node;
+        graph_edges_reserve(&(new_node->successors),   node->successors.size);
+        graph_edges_reserve(&(new_node->predecessors), node->predecessors.size);
+
+        for (i = 0; i < node->successors.size; i++) {
+            struct _graph_edge * edge = node->successors.edges[i];
+            size_t slot = graph_edge_table_slot_of(graph, edge);
+            graph_node_link_successor(new_node, new_graph->edge_table[slot]);
         }
+        for (i = 0; i < node->predecessors.size; i++) {
+            struct _graph_edge * edge = node->predecessors.edges[i];
+            size_t slot = graph_edge_table_slot_of(graph, edge);
+            graph_node_link_predecessor(new_node, new_graph->edge_table[slot]);
+        }
+
+        new_it = graph_it_next(new_it);
     }
 
     return new_graph;
@@ -145,74 +555,137 @@ struct _graph * graph_deserialize (json_t * json)
     for (it = tree_iterator(graph->nodes); it != NULL; it = tree_it_next(it)) {
         struct _graph_node * node = tree_it_data(it);
         node->graph = graph;
+        graph_node_table_insert(graph, node);
+    }
+
+    // each deserialized node holds its successor edges. move them into the
+    // edge table and link them to the nodes at both ends
+    for (it = tree_iterator(graph->nodes); it != NULL; it = tree_it_next(it)) {
+        struct _graph_node * node = tree_it_data(it);
+        struct _graph_edges  edges = node->successors;
+        memset(&(node->successors), 0, sizeof(struct _graph_edges));
+
+        size_t i;
+        for (i = 0; i < edges.size; i++) {
+            struct _graph_edge * edge      = edges.edges[i];
+            struct _graph_node * tail_node = graph_fetch_node(graph, edge->tail);
+            if (    (tail_node == NULL)
+                 || (edge->head != node->index)
+                 || graph_edge_table_insert(graph, edge)) {
+                object_delete(edge);
+                continue;
+            }
+            graph_node_link_successor(node, edge);
+            graph_node_link_predecessor(tail_node, edge);
+        }
+        graph_edges_free(NULL, &edges);
     }
 
     return graph;
 }
 
 
-void graph_merge_node_edges (struct _graph_node * lhs, struct _graph_node * rhs)
+void graph_merge (struct _graph * graph, struct _graph * rhs)
 {
-    struct _list_it *    rhs_it;
-    struct _graph_edge * rhs_edge;
-    struct _list_it *    lhs_it;
-    struct _graph_edge * lhs_edge;
-    int found;
+    // start by adding all new nodes
+    struct _graph_it * it;
+    for (it = graph_iterator(rhs); it != NULL; it = graph_it_next(it)) {
+        struct _graph_node * node = graph_it_node(it);
+        if (graph_fetch_node(graph, node->index) == NULL)
+            graph_add_node(graph, node->index, node->data);
+    }
 
-    for (rhs_it =  list_iterator(rhs->edges);
-         rhs_it != NULL;
-         rhs_it =  rhs_it->next) {
-        rhs_edge = rhs_it->data;
+    // then add all new edges. even where a node already existed we want all
+    // of its new edges, and every edge is in rhs's edge table once
+    size_t i;
+    for (i = 0; i < rhs->edge_table_slots; i++) {
+        struct _graph_edge * edge = rhs->edge_table[i];
+        if (edge != NULL)
+            graph_add_edge(graph, edge->head, edge->tail, edge->data);
+    }
+}
 
-        found = 0;
-        for (lhs_it =  list_iterator(lhs->edges);
-             lhs_it != NULL;
-             lhs_it =  lhs_it->next) {
 
-            lhs_edge = lhs_it->data;
-            if (    (lhs_edge->head == rhs_edge->head)
-                 && (lhs_edge->tail == rhs_edge->tail)) {
-                found = 1;
-                break;
+struct _graph * graph_merge_take (struct _graph * graph, struct _graph * rhs)
+{
+    size_t graph_size = graph->node_table_size;
+    size_t rhs_size   = rhs->node_table_size;
+
+    // a few nodes are cheaper to insert one by one. otherwise both node trees
+    // are walked in order and graph's tree is rebuilt from the merged
+    // sequence, which is linear in the size of both
+    int rebuild = rhs_size * 16 >= graph_size;
+
+    void ** nodes   = NULL;
+    size_t  nodes_n = 0;
+    if (rebuild)
+        nodes = malloc(sizeof(void *) * (graph_size + rhs_size + 1));
+
+    struct _graph_it * lit = graph_iterator(graph);
+    struct _graph_it * rit = graph_iterator(rhs);
+    while (rit != NULL) {
+        struct _graph_node * node = graph_it_node(rit);
+        rit = graph_it_next(rit);
+
+        if (rebuild) {
+            while ((lit != NULL) && (graph_it_index(lit) < node->index)) {
+                nodes[nodes_n++] = graph_it_node(lit);
+                lit = graph_it_next(lit);
             }
         }
 
-        if (found == 0) {
-            list_append(lhs->edges, rhs_edge);
+        // graph's node wins. the edges of this one are dealt with below
+        if (graph_fetch_node(graph, node->index) != NULL) {
+            object_delete(node);
+            continue;
         }
-    }
-}
-
 
+        // the node moves over with its data, and with the arena its edge
+        // arrays came from. the arrays are kept for their capacity and
+        // refilled below
+        node->graph = graph;
+        node->successors.size   = 0;
+        node->predecessors.size = 0;
+        graph_node_table_insert(graph, node);
+
+        if (rebuild)
+            nodes[nodes_n++] = node;
+        else
+            tree_insert_take(graph->nodes, node);
+    }
 
-void graph_merge (struct _graph * graph, struct _graph * rhs)
-{
-    struct _queue * queue = queue_create();
+    if (rebuild) {
+        for (; lit != NULL; lit = graph_it_next(lit))
+            nodes[nodes_n++] = graph_it_node(lit);
 
-    // start by adding all new nodes
-    struct _graph_it   * it;
-    for (it = graph_iterator(rhs); it != NULL; it = graph_it_next(it)) {
-        struct _graph_node * node = graph_it_node(it);
+        tree_detach(graph->nodes);
+        graph->nodes->nodes = tree_node_build(graph->nodes, nodes, nodes_n);
+        if (graph->nodes->nodes != NULL)
+            graph->nodes->nodes->parent = NULL;
+        free(nodes);
+    }
 
-        // add this node's edge to queue. Even if this node already exists,
-        // we want all the new edges
-        struct _list_it * eit;
-        for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-            queue_push(queue, eit->data);
-        }
+    // every node of rhs has been moved or deleted
+    tree_detach(rhs->nodes);
 
-        if (graph_fetch_node(graph, node->index) != NULL)
+    // edges move over unless graph already has them
+    size_t i;
+    for (i = 0; i < rhs->edge_table_slots; i++) {
+        struct _graph_edge * edge = rhs->edge_table[i];
+        if (edge == NULL)
             continue;
-
-        graph_add_node(graph, node->index, node->data);
+        if (graph_edge_table_insert(graph, edge)) {
+            object_delete(edge);
+            continue;
+        }
+        graph_node_link_successor(graph_fetch_node(graph, edge->head), edge);
+        graph_node_link_predecessor(graph_fetch_node(graph, edge->tail), edge);
     }
+    rhs->edge_table_slots = 0;
 
-    // then add all new edges
-    while (queue->size > 0) {
-        struct _graph_edge * edge = queue_peek(queue);
-        graph_add_edge(graph, edge->head, edge->tail, edge->data);
-        queue_pop(queue);
-    }
+    graph_delete(rhs);
+
+    return graph;
 }
 
 
@@ -233,8 +706,7 @@ void graph_reduce (struct _graph * graph)
          graph_it != NULL;
          graph_it = graph_it_next(graph_it)) {
         index = index_create(graph_it_index(graph_it));
-        list_append(node_list, index);
-        object_delete(index);
+        list_append_take(node_list, index);
     }
 
     struct _list_it * node_it;
@@ -254,16 +726,14 @@ void graph_reduce (struct _graph * graph)
         }
 
         // if this node has only one successor
-        if (graph_node_successors_n(head_node) != 1) {
+        if (head_node->successors.size != 1) {
             node_it = node_it->next;
             continue;
         }
 
         // get that successor
-        struct _list * successors = graph_node_successors(head_node);
-        struct _graph_edge * successor_edge = list_first(successors);
+        struct _graph_edge * successor_edge = head_node->successors.edges[0];
         tail_node = graph_fetch_node(graph, successor_edge->tail);
-        object_delete(successors);
 
         if (tail_node == NULL) {
             fprintf(stderr,
@@ -272,8 +742,14 @@ void graph_reduce (struct _graph * graph)
             exit(-1);
         }
 
+        // a node which only loops back to itself has nothing to merge
+        if (tail_node == head_node) {
+            node_it = node_it->next;
+            continue;
+        }
+
         // how many predecessors does the tail node have?
-        if (graph_node_predecessors_n(tail_node) != 1) {
+        if (tail_node->predecessors.size != 1) {
             node_it = node_it->next;
             continue;
         }
@@ -282,52 +758,25 @@ void graph_reduce (struct _graph * graph)
         object_merge(head_node->data, tail_node->data);
 
         // head removes its successor
-        struct _list_it * suc_it;
-        for (suc_it = list_iterator(head_node->edges);
-             suc_it != NULL;
-             suc_it = suc_it->next) {
-            successor_edge = suc_it->data;
-            if (successor_edge->head == head_node->index) {
-                list_remove(head_node->edges, suc_it);
-                break;
-            }
+        graph_edge_table_remove(graph, head_node->index, tail_node->index);
+        graph_node_unlink_successor(head_node, successor_edge);
+        graph_node_unlink_predecessor(tail_node, successor_edge);
+        object_delete(successor_edge);
+
+        // tail's successors become head's successors. the edges are moved,
+        // not copied, so the successor nodes see their new head as well
+        size_t i;
+        for (i = 0; i < tail_node->successors.size; i++) {
+            successor_edge = tail_node->successors.edges[i];
+            graph_edge_table_remove(graph, successor_edge->head, successor_edge->tail);
+            successor_edge->head = head_node->index;
+            graph_edge_table_insert(graph, successor_edge);
+            graph_node_link_successor(head_node, successor_edge);
         }
-
-        // head creates a new successor using tail's successors
-        // meanwhile, patch tail's successors
-        successors = graph_node_successors(tail_node);
-        // for each of tail's successors
-        for (suc_it = list_iterator(successors);
-             suc_it != NULL;
-             suc_it = suc_it->next) {
-
-            successor_edge = suc_it->data;
-
-            // create an edge in head_node pointing to this successor
-            struct _graph_edge * new_edge;
-            new_edge = object_copy(successor_edge);
-            new_edge->head = head_node->index;
-            list_append(head_node->edges, new_edge);
-            object_delete(new_edge);
-
-            // patch tail's successors
-            struct _graph_node * tail_suc_node;
-            // tail_suc_node is the successor node
-            tail_suc_node = graph_fetch_node(graph, successor_edge->tail);
-            struct _list_it * tail_suc_it;
-            // for each of the successor's edges
-            for (tail_suc_it  = list_iterator(tail_suc_node->edges);
-                 tail_suc_it != NULL;
-                 tail_suc_it  = tail_suc_it->next) {
-                struct _graph_edge * tail_suc_edge = tail_suc_it->data;
-                // if the head of this edge was tail, it is now head
-                if (tail_suc_edge->head == tail_node->index)
-                    tail_suc_edge->head = head_node->index;
-            }
-        }
-        object_delete(successors);
+        tail_node->successors.size = 0;
 
         // remove tail node from graph
+        graph_node_table_remove(graph, tail_node->index);
         tree_remove(graph->nodes, tail_node);
 
         // continue processing this node
@@ -345,13 +794,17 @@ struct _graph * graph_family (struct _graph * graph, uint64_t indx)
         return NULL;
     }
 
-    struct _graph       * new_graph = graph_create();
+    // the family is usually a short lived piece of a larger graph, so give it
+    // its own arena and tear it down in chunks
+    struct _arena       * arena = arena_create();
+    struct _graph       * new_graph = graph_create_arena(arena);
     struct _index * index;
     struct _queue       * queue = queue_create();
 
+    object_delete(arena);
+
     index = index_create(indx);
-    queue_push(queue, index);
-    object_delete(index);
+    queue_push_take(queue, index);
 
     while (queue->size > 0) {
         index = object_copy(queue_peek(queue));
@@ -371,24 +824,20 @@ struct _graph * graph_family (struct _graph * graph, uint64_t indx)
             exit(-1);
         }
 
-        // create new node with this graph as graph
-        struct _graph_node * new_node;
-        new_node = graph_node_create(new_graph, node->index, node->data);
-        tree_insert(new_graph->nodes, new_node);
-        object_delete(new_node);
+        graph_add_node(new_graph, node->index, node->data);
 
         // add this node's edges and queue up new nodes
-        struct _list_it * it;
+        size_t i;
         object_delete(index);
-        for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            if (edge->head == node->index)
-                index = index_create(edge->tail);
-            else
-                index = index_create(edge->head);
+        for (i = 0; i < node->successors.size; i++) {
+            struct _graph_edge * edge = node->successors.edges[i];
             graph_add_edge(new_graph, edge->head, edge->tail, edge->data);
-            queue_push(queue, index);
-            object_delete(index);
+            queue_push_take(queue, index_create(edge->tail));
+        }
+        for (i = 0; i < node->predecessors.size; i++) {
+            struct _graph_edge * edge = node->predecessors.edges[i];
+            graph_add_edge(new_graph, edge->head, edge->tail, edge->data);
+            queue_push_take(queue, index_create(edge->head));
         }
     }
 
@@ -399,15 +848,34 @@ struct _graph * graph_family (struct _graph * graph, uint64_t indx)
 
 
 
-void graph_add_node (struct _graph * graph, uint64_t index, void * data)
+int graph_add_node (struct _graph * graph, uint64_t index, void * data)
+{
+    if (graph_fetch_node(graph, index) != NULL)
+        return -1;
+
+    if (data != NULL)
+        data = object_copy(data);
+
+    return graph_add_node_take(graph, index, data);
+}
+
+
+
+int graph_add_node_take (struct _graph * graph, uint64_t index, void * data)
 {
     struct _graph_node * node;
 
-    node = graph_node_create(graph, index, data);
+    node = graph_node_create(graph, index, NULL);
+    node->data = data;
+
+    if (graph_node_table_insert(graph, node)) {
+        object_delete(node);
+        return -1;
+    }
 
-    tree_insert(graph->nodes, node);
+    tree_insert_take(graph->nodes, node);
 
-    object_delete(node);
+    return 0;
 }
 
 
@@ -418,38 +886,46 @@ void graph_remove_node (struct _graph * graph, uint64_t index)
     if (node == NULL)
         return;
 
-    // remove all edges to/from this node
-    struct _queue * queue = queue_create();
-    struct _list_it * eit;
-    for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-        queue_push(queue, eit->data);
-    }
-
-    while (queue->size > 0) {
-        struct _graph_edge * edge = queue_peek(queue);
+    // remove all edges to/from this node. every edge unlinks itself from
+    // the end of its arrays, so take them from the back
+    while ((node->successors.size > 0) || (node->predecessors.size > 0)) {
+        struct _graph_edge * edge;
+        if (node->successors.size > 0)
+            edge = node->successors.edges[node->successors.size - 1];
+        else
+            edge = node->predecessors.edges[node->predecessors.size - 1];
         printf("graph_remove_node removing %llx's edge %llx->%llx\n",
                (unsigned long long) index,
                (unsigned long long) edge->head,
                (unsigned long long) edge->tail);
         fflush(stdout);
         graph_remove_edge(graph, edge->head, edge->tail);
-        queue_pop(queue);
     }
 
-    object_delete(queue);
-
+    graph_node_table_remove(graph, index);
     tree_remove(graph->nodes, node);
 }
 
 
 
+// orders a graph node index against a graph node for key based tree lookups
+int graph_node_index_cmp (uint64_t * index, struct _graph_node * node)
+{
+    if (*index < node->index)
+        return -1;
+    else if (*index > node->index)
+        return 1;
+    return 0;
+}
+
+
+
 struct _graph_node * graph_fetch_node (struct _graph * graph,
                                        uint64_t index)
 {
-    struct _graph_node * node        = graph_node_create(graph, index, NULL);
-    struct _graph_node * target_node = tree_fetch(graph->nodes, node);
-    object_delete(node);
-    return target_node;
+    if (graph->node_table_slots == 0)
+        return NULL;
+    return graph->node_table[graph_node_table_slot(graph, index)];
 }
 
 
@@ -464,23 +940,19 @@ void * graph_fetch_data (struct _graph * graph, uint64_t index)
 
 
 
-struct _list * graph_fetch_edges (struct _graph * graph, uint64_t index)
+struct _graph_node * graph_fetch_node_max (struct _graph * graph,
+                                           uint64_t index)
 {
-    struct _graph_node * node = graph_fetch_node(graph, index);
-    if (node == NULL)
-        return NULL;
-    return node->edges;
+    return tree_fetch_max_key(graph->nodes, &index, TREE_CMP(graph_node_index_cmp));
 }
 
 
 
-struct _graph_node * graph_fetch_node_max (struct _graph * graph,
-                                           uint64_t index)
+struct _graph_edge * graph_fetch_edge (struct _graph * graph,
+                                       uint64_t        head,
+                                       uint64_t        tail)
 {
-    struct _graph_node * node        = graph_node_create(graph, index, NULL);
-    struct _graph_node * target_node = tree_fetch_max(graph->nodes, node);
-    object_delete(node);
-    return target_node;
+    return graph_edge_table_fetch(graph, head, tail);
 }
 
 
@@ -500,22 +972,15 @@ int graph_add_edge (struct _graph * graph,
     if ((head_node == NULL) || (tail_node == NULL))
         return -1;
 
-    edge = graph_edge_create(head_node->index, tail_node->index, data);
-
     // do not add a duplicate edge
-    struct _list_it * it;
-    for (it = list_iterator(head_node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge_ptr = it->data;
-        if (object_cmp(edge, edge_ptr) == 0) {
-            object_delete(edge);
-            return -1;
-        }
-    }
-
-    list_append(head_node->edges, edge);
-    list_append(tail_node->edges, edge);
+    if (graph_edge_table_fetch(graph, head_node->index, tail_node->index) != NULL)
+        return -1;
 
-    object_delete(edge);
+    // the graph holds the only copy of the edge, and both nodes point to it
+    edge = graph_edge_create(head_node->index, tail_node->index, data);
+    graph_edge_table_insert(graph, edge);
+    graph_node_link_successor(head_node, edge);
+    graph_node_link_predecessor(tail_node, edge);
 
     return 0;
 }
@@ -526,35 +991,22 @@ int graph_remove_edge (struct _graph * graph,
                        uint64_t head_needle,
                        uint64_t tail_needle)
 {
-    struct _graph_edge edge;
     struct _graph_node * head_node;
     struct _graph_node * tail_node;
-    struct _graph_edge * edge_ptr;
 
     head_node = graph_fetch_node(graph, head_needle);
     tail_node = graph_fetch_node(graph, tail_needle);
     if ((head_node == NULL) || (tail_node == NULL))
         return -1;
 
-    edge.head = head_node->index;
-    edge.tail = tail_node->index;
-
-    struct _list_it * it;
-    for (it = list_iterator(head_node->edges); it != NULL; it = it->next) {
-        edge_ptr = (struct _graph_edge *) it->data;
-        if ((edge_ptr->head == edge.head) && (edge_ptr->tail == edge.tail)) {
-            list_remove(head_node->edges, it);
-            break;
-        }
-    }
+    struct _graph_edge * edge;
+    edge = graph_edge_table_remove(graph, head_node->index, tail_node->index);
+    if (edge == NULL)
+        return 0;
 
-    for (it = list_iterator(tail_node->edges); it != NULL; it = it->next) {
-        edge_ptr = (struct _graph_edge *) it->data;
-        if ((edge_ptr->head == edge.head) && (edge_ptr->tail == edge.tail)) {
-            list_remove(tail_node->edges, it);
-            break;
-        }
-    }
+    graph_node_unlink_successor(head_node, edge);
+    graph_node_unlink_predecessor(tail_node, edge);
+    object_delete(edge);
 
     return 0;
 }
@@ -567,98 +1019,334 @@ void graph_map (struct _graph * graph, void (* callback) (struct _graph_node *))
 }
 
 
-void graph_bfs (struct _graph * graph,
-                uint64_t        indx,
-                void  (* callback) (struct _graph *, struct _graph_node *))
+struct _graph_walk * graph_walk_create ()
 {
-    struct _queue       * queue   = queue_create();
-    struct _tree        * visited = tree_create();
-    struct _index * index;
+    struct _graph_walk * walk = malloc(sizeof(struct _graph_walk));
+    walk->object   = &graph_walk_object;
+    walk->graph    = NULL;
+    walk->stamps   = NULL;
+    walk->edges    = NULL;
+    walk->slots    = 0;
+    walk->epoch    = 1;
+    walk->stack    = NULL;
+    walk->nodes    = NULL;
+    walk->size     = 0;
+    walk->capacity = 0;
+    return walk;
+}
 
-    // add the first index to the graph
-    index = index_create(indx);
-    queue_push(queue, index);
-    object_delete(index);
 
-    while (queue->size > 0) {
-        index = object_copy(queue_peek(queue));
-        queue_pop(queue);
-        if (tree_fetch(visited, index) != NULL) {
-            object_delete(index);
-            continue;
-        }
-        tree_insert(visited, index);
+void graph_walk_delete (struct _graph_walk * walk)
+{
+    free(walk->stamps);
+    free(walk->edges);
+    free(walk->stack);
+    free(walk->nodes);
+    free(walk);
+}
 
-        struct _graph_node * node = graph_fetch_node(graph, index->index);
-        if (node == NULL) {
-            printf("graph_bfs didn't find node %llx\n",
-                   (unsigned long long) index->index);
-        }
-        object_delete(index);
 
-        callback(graph, node);
+void graph_walk_clear (struct _graph_walk * walk)
+{
+    // once the epoch wraps, stamps left from long ago would look current
+    if (++walk->epoch == 0) {
+        if (walk->slots > 0)
+            memset(walk->stamps, 0, sizeof(uint32_t) * walk->slots);
+        walk->epoch = 1;
+    }
+}
 
-        // add successors to the queue
-        struct _list * successors = graph_node_successors(node);
-        struct _list_it * it;
-        for (it = list_iterator(successors); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            index = index_create(edge->tail);
-            queue_push(queue, index);
-            object_delete(index);
+
+// starts the visited set over if graph is not the graph it was made for, or
+// graph's node table has been rehashed since. makes room on the stack and in
+// nodes for every node of graph
+void graph_walk_fit (struct _graph_walk * walk, struct _graph * graph)
+{
+    if ((walk->graph != graph) || (walk->slots != graph->node_table_slots)) {
+        free(walk->stamps);
+        free(walk->edges);
+        walk->graph  = graph;
+        walk->slots  = graph->node_table_slots;
+        walk->epoch  = 1;
+        walk->stamps = calloc(walk->slots, sizeof(uint32_t));
+        walk->edges  = malloc(sizeof(struct _graph_edge *) * walk->slots);
+    }
+
+    if (walk->capacity < graph->node_table_size) {
+        walk->capacity = graph->node_table_size;
+        walk->stack    = realloc(walk->stack,
+                            sizeof(struct _graph_walk_frame) * walk->capacity);
+        walk->nodes    = realloc(walk->nodes,
+                            sizeof(struct _graph_node *) * walk->capacity);
+    }
+
+    walk->size = 0;
+}
+
+
+struct _graph_edges * graph_walk_edges (struct _graph_node * node,
+                                        int                  predecessors)
+{
+    if (predecessors)
+        return &(node->predecessors);
+    return &(node->successors);
+}
+
+
+// returns the node at the far end of edge and marks it visited, or NULL if it
+// has already been visited
+struct _graph_node * graph_walk_follow (struct _graph_walk * walk,
+                                        struct _graph_edge * edge,
+                                        int                  predecessors)
+{
+    struct _graph * graph = walk->graph;
+    uint64_t index = predecessors ? edge->head : edge->tail;
+    size_t   slot  = graph_node_table_slot(graph, index);
+
+    if (    (walk->stamps[slot] == walk->epoch)
+         || (graph->node_table[slot] == NULL))
+        return NULL;
+
+    walk->stamps[slot] = walk->epoch;
+    walk->edges[slot]  = edge;
+    return graph->node_table[slot];
+}
+
+
+// appends node to nodes and passes it to callback
+int graph_walk_visit (struct _graph_walk * walk,
+                      struct _graph_node * node,
+                      int               (* callback) (struct _graph_node *, void *),
+                      void               * data)
+{
+    walk->nodes[walk->size++] = node;
+    if (callback == NULL)
+        return GRAPH_WALK_CONTINUE;
+    return callback(node, data);
+}
+
+
+// nodes doubles as the queue. everything before head has been expanded and
+// everything from head on is waiting to be
+int graph_walk_bfs (struct _graph_walk * walk,
+                    struct _graph_node * root,
+                    int                  predecessors,
+                    int               (* callback) (struct _graph_node *, void *),
+                    void               * data)
+{
+    size_t head = 0;
+
+    walk->nodes[walk->size++] = root;
+
+    while (head < walk->size) {
+        struct _graph_node * node = walk->nodes[head++];
+
+        if (callback != NULL) {
+            int action = callback(node, data);
+            if (action == GRAPH_WALK_STOP)
+                return GRAPH_WALK_STOP;
+            if (action == GRAPH_WALK_PRUNE)
+                continue;
+        }
+
+        struct _graph_edges * edges = graph_walk_edges(node, predecessors);
+        size_t i;
+        for (i = 0; i < edges->size; i++) {
+            struct _graph_node * next;
+            next = graph_walk_follow(walk, edges->edges[i], predecessors);
+            if (next != NULL)
+                walk->nodes[walk->size++] = next;
         }
-        object_delete(successors);
     }
-    object_delete(queue);
-    object_delete(visited);
+
+    return 0;
 }
 
 
-void graph_bfs_data (struct _graph * graph,
-                     uint64_t        indx,
-                     void          * data,
-                     void (* callback) (struct _graph_node *, void * data))
+// a node's frame stays on the stack until every edge leaving it has been
+// followed, so nodes are left in the same order a recursive walk would
+int graph_walk_dfs (struct _graph_walk * walk,
+                    struct _graph_node * root,
+                    int                  order,
+                    int                  predecessors,
+                    int               (* callback) (struct _graph_node *, void *),
+                    void               * data)
 {
-    struct _queue       * queue   = queue_create();
-    struct _tree        * visited = tree_create();
-    struct _index * index;
+    struct _graph_walk_frame * stack = walk->stack;
+    size_t depth = 0;
+    int action;
+
+    if (order == GRAPH_WALK_PREORDER) {
+        action = graph_walk_visit(walk, root, callback, data);
+        if (action == GRAPH_WALK_STOP)
+            return GRAPH_WALK_STOP;
+        if (action == GRAPH_WALK_PRUNE)
+            return 0;
+    }
 
-    // add the first index to the graph
-    index = index_create(indx);
-    queue_push(queue, index);
-    object_delete(index);
+    stack[depth].node = root;
+    stack[depth].edge = 0;
+    depth++;
+
+    while (depth > 0) {
+        struct _graph_walk_frame * frame = &(stack[depth - 1]);
+        struct _graph_edges      * edges;
+        edges = graph_walk_edges(frame->node, predecessors);
+
+        if (frame->edge < edges->size) {
+            struct _graph_node * next;
+            next = graph_walk_follow(walk,
+                                     edges->edges[frame->edge++],
+                                     predecessors);
+            if (next == NULL)
+                continue;
+
+            if (order == GRAPH_WALK_PREORDER) {
+                action = graph_walk_visit(walk, next, callback, data);
+                if (action == GRAPH_WALK_STOP)
+                    return GRAPH_WALK_STOP;
+                if (action == GRAPH_WALK_PRUNE)
+                    continue;
+            }
 
-    while (queue->size > 0) {
-        index = object_copy(queue_peek(queue));
-        queue_pop(queue);
-        if (tree_fetch(visited, index) != NULL) {
-            object_delete(index);
+            stack[depth].node = next;
+            stack[depth].edge = 0;
+            depth++;
             continue;
         }
-        tree_insert(visited, index);
 
-        struct _graph_node * node = graph_fetch_node(graph, index->index);
-        if (node == NULL) {
-            printf("graph_bfs didn't find node %llx\n",
-                   (unsigned long long) index->index);
+        depth--;
+        if (order == GRAPH_WALK_POSTORDER) {
+            action = graph_walk_visit(walk, frame->node, callback, data);
+            if (action == GRAPH_WALK_STOP)
+                return GRAPH_WALK_STOP;
         }
-        object_delete(index);
+        else if (order == GRAPH_WALK_REVERSE_POSTORDER)
+            walk->nodes[walk->size++] = frame->node;
+    }
 
-        callback(node, data);
+    if (order != GRAPH_WALK_REVERSE_POSTORDER)
+        return 0;
 
-        // add successors to the queue
-        struct _list * successors = graph_node_successors(node);
-        struct _list_it * it;
-        for (it = list_iterator(successors); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            index = index_create(edge->tail);
-            queue_push(queue, index);
-            object_delete(index);
-        }
-        object_delete(successors);
+    size_t i;
+    for (i = 0; i < walk->size / 2; i++) {
+        struct _graph_node * node = walk->nodes[i];
+        walk->nodes[i] = walk->nodes[walk->size - 1 - i];
+        walk->nodes[walk->size - 1 - i] = node;
     }
-    object_delete(queue);
-    object_delete(visited);
+
+    if (callback == NULL)
+        return 0;
+
+    for (i = 0; i < walk->size; i++) {
+        if (callback(walk->nodes[i], data) == GRAPH_WALK_STOP)
+            return GRAPH_WALK_STOP;
+    }
+
+    return 0;
+}
+
+
+int graph_walk (struct _graph_walk * walk,
+                struct _graph      * graph,
+                uint64_t             index,
+                int                  order,
+                int               (* callback) (struct _graph_node *, void *),
+                void               * data)
+{
+    int predecessors = order & GRAPH_WALK_PREDECESSORS;
+    order &= ~GRAPH_WALK_PREDECESSORS;
+
+    graph_walk_fit(walk, graph);
+
+    if (graph->node_table_slots == 0)
+        return -1;
+
+    size_t slot = graph_node_table_slot(graph, index);
+    struct _graph_node * root = graph->node_table[slot];
+    if (root == NULL)
+        return -1;
+
+    if (walk->stamps[slot] == walk->epoch)
+        return 0;
+    walk->stamps[slot] = walk->epoch;
+    walk->edges[slot]  = NULL;
+
+    if (order == GRAPH_WALK_BFS)
+        return graph_walk_bfs(walk, root, predecessors, callback, data);
+    return graph_walk_dfs(walk, root, order, predecessors, callback, data);
+}
+
+
+struct _graph_edge * graph_walk_edge (struct _graph_walk * walk,
+                                      struct _graph_node * node)
+{
+    struct _graph * graph = walk->graph;
+
+    if ((graph == NULL) || (walk->slots != graph->node_table_slots))
+        return NULL;
+    if (walk->slots == 0)
+        return NULL;
+
+    size_t slot = graph_node_table_slot(graph, node->index);
+    if (    (graph->node_table[slot] != node)
+         || (walk->stamps[slot] != walk->epoch))
+        return NULL;
+
+    return walk->edges[slot];
+}
+
+
+// graph_bfs and graph_bfs_data callbacks don't prune or stop, and take
+// different arguments, so they go through here
+struct _graph_bfs {
+    struct _graph * graph;
+    void         (* callback)      (struct _graph *, struct _graph_node *);
+    void         (* callback_data) (struct _graph_node *, void *);
+    void          * data;
+};
+
+
+int graph_bfs_visit (struct _graph_node * node, struct _graph_bfs * bfs)
+{
+    if (bfs->callback != NULL)
+        bfs->callback(bfs->graph, node);
+    else
+        bfs->callback_data(node, bfs->data);
+    return GRAPH_WALK_CONTINUE;
+}
+
+
+void graph_bfs_walk (struct _graph * graph, uint64_t indx, struct _graph_bfs * bfs)
+{
+    struct _graph_walk * walk = graph_walk_create();
+
+    if (graph_walk(walk, graph, indx, GRAPH_WALK_BFS,
+                   (int (*) (struct _graph_node *, void *)) graph_bfs_visit,
+                   bfs) < 0) {
+        printf("graph_bfs didn't find node %llx\n", (unsigned long long) indx);
+    }
+
+    object_delete(walk);
+}
+
+
+void graph_bfs (struct _graph * graph,
+                uint64_t        indx,
+                void  (* callback) (struct _graph *, struct _graph_node *))
+{
+    struct _graph_bfs bfs = {graph, callback, NULL, NULL};
+    graph_bfs_walk(graph, indx, &bfs);
+}
+
+
+void graph_bfs_data (struct _graph * graph,
+                     uint64_t        indx,
+                     void          * data,
+                     void (* callback) (struct _graph_node *, void * data))
+{
+    struct _graph_bfs bfs = {graph, NULL, callback, data};
+    graph_bfs_walk(graph, indx, &bfs);
 }
 
 
@@ -673,6 +1361,8 @@ struct _graph_edge * graph_edge_create (uint64_t head, uint64_t tail, void * dat
     edge->object = &graph_edge_object;
     edge->head = head;
     edge->tail = tail;
+    edge->successors_pos   = 0;
+    edge->predecessors_pos = 0;
     return edge;
 }
 
@@ -767,7 +1457,11 @@ struct _graph_node * graph_node_create (struct _graph * graph,
         node->data = NULL;
     else
         node->data = object_copy(data);
-    node->edges = list_create();
+    memset(&(node->successors),   0, sizeof(struct _graph_edges));
+    memset(&(node->predecessors), 0, sizeof(struct _graph_edges));
+    node->arena = NULL;
+    if ((graph != NULL) && (graph->arena != NULL))
+        node->arena = object_share(graph->arena);
 
     return node;
 }
@@ -778,7 +1472,18 @@ void graph_node_delete (struct _graph_node * node)
 {
     if (node->data != NULL)
         object_delete(node->data);
-    object_delete(node->edges);
+
+    // edges belong to the graph. a node outside of any graph has just been
+    // deserialized and still owns its successor edges
+    if (node->graph == NULL) {
+        size_t i;
+        for (i = 0; i < node->successors.size; i++)
+            object_delete(node->successors.edges[i]);
+    }
+    graph_edges_free(node->arena, &(node->successors));
+    graph_edges_free(node->arena, &(node->predecessors));
+    if (node->arena != NULL)
+        object_delete(node->arena);
     free(node);
 }
 
@@ -787,9 +1492,10 @@ void graph_node_delete (struct _graph_node * node)
 struct _graph_node * graph_node_copy (struct _graph_node * node)
 {
     struct _graph_node * new_node;
-    new_node = graph_node_create(node->graph, node->index, node->data);
-    object_delete(new_node->edges);
-    new_node->edges = object_copy(node->edges);
+    // copies do not use the arena of the graph they were copied from. edges
+    // belong to the graph, so graph_copy copies them separately
+    new_node = graph_node_create(NULL, node->index, node->data);
+    new_node->graph = node->graph;
     return new_node;
 }
 
@@ -809,9 +1515,21 @@ json_t * graph_node_serialize (struct _graph_node * node)
 {
     json_t * json = json_object();
 
+    // both arrays are written out as one list of edges, which is how nodes
+    // kept their edges before they were split
+    json_t * edges = json_object();
+    json_t * items = json_array();
+    size_t i;
+    for (i = 0; i < node->successors.size; i++)
+        json_array_append(items, object_serialize(node->successors.edges[i]));
+    for (i = 0; i < node->predecessors.size; i++)
+        json_array_append(items, object_serialize(node->predecessors.edges[i]));
+    json_object_set(edges, "ot",    json_integer(SERIALIZE_LIST));
+    json_object_set(edges, "items", items);
+
     json_object_set(json, "ot",    json_integer(SERIALIZE_GRAPH_NODE));
     json_object_set(json, "index", json_uint64_t(node->index));
-    json_object_set(json, "edges", object_serialize(node->edges));
+    json_object_set(json, "edges", edges);
     if (node->data == NULL) {
         json_t * data = json_object();
         json_object_set(data, "ot", json_integer(SERIALIZE_NULL));
@@ -852,8 +1570,21 @@ struct _graph_node * graph_node_deserialize (json_t * json)
     struct _graph_node * node = graph_node_create(NULL,
                                                   json_uint64_t_value(index),
                                                   data_object);
-    object_delete(node->edges);
-    node->edges = edges_object;
+
+    // every edge is listed by both of its nodes. keep the successors, which
+    // graph_deserialize links up once every node exists. a node has at most
+    // one loop to itself, and it is listed twice
+    int loops = 0;
+    struct _list_it * it;
+    for (it = list_iterator(edges_object); it != NULL; it = it->next) {
+        struct _graph_edge * edge = it->data;
+        if (edge->head != node->index)
+            continue;
+        if ((edge->tail == node->index) && (loops++ > 0))
+            continue;
+        graph_edges_append(NULL, &(node->successors), object_copy(edge));
+    }
+    object_delete(edges_object);
 
     if (data_object != NULL)
         object_delete(data_object);
@@ -862,42 +1593,18 @@ struct _graph_node * graph_node_deserialize (json_t * json)
 }
 
 
-inline size_t graph_node_successors_n (struct _graph_node * node)
+size_t graph_node_successors_n (struct _graph_node * node)
 {
-    struct _list_it * it;
-    size_t successors = 0;
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-        if (edge->head == node->index)
-            successors++;
-    }
-    return successors;
+    return node->successors.size;
 }
 
 
-/*
-*   It's very possible that a node will have two edges, both with head and tail
-*   set to itself. This is actually correct, as one edge is for predecessor to
-*   successor, and one is for successor to predecessor. We have to account for
-*   this and insure we only return one successor node.
-*/
 struct _list * graph_node_successors (struct _graph_node * node)
 {
-    int loop_count = 0;
-    struct _list_it * it;
     struct _list * successors = list_create();
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-        if (edge->head == node->index) {
-            if (edge->head == edge->tail) {
-                if (loop_count == 0)
-                    loop_count = 1;
-                else
-                    continue;
-            }
-            list_append(successors, edge);
-        }
-    }
+    size_t i;
+    for (i = 0; i < node->successors.size; i++)
+        list_append(successors, node->successors.edges[i]);
     return successors;
 }
 
@@ -905,37 +1612,16 @@ struct _list * graph_node_successors (struct _graph_node * node)
 
 size_t graph_node_predecessors_n (struct _graph_node * node)
 {
-    struct _list_it * it;
-    size_t predecessors = 0;
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-        if (edge->tail == node->index)
-            predecessors++;
-    }
-    return predecessors;
+    return node->predecessors.size;
 }
 
 
-/*
-*   See note for graph_node_predecessors
-*/
 struct _list * graph_node_predecessors (struct _graph_node * node)
 {
-    int loop_count = 0;
-    struct _list_it * it;
     struct _list * predecessors = list_create();
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-        if (edge->tail == node->index) {
-            if (edge->head == edge->tail) {
-                if (loop_count == 0)
-                    loop_count = 1;
-                else
-                    continue;
-            }
-            list_append(predecessors, edge);
-        }
-    }
+    size_t i;
+    for (i = 0; i < node->predecessors.size; i++)
+        list_append(predecessors, node->predecessors.edges[i]);
     return predecessors;
 }
 
@@ -943,77 +1629,43 @@ struct _list * graph_node_predecessors (struct _graph_node * node)
 
 struct _graph_it * graph_iterator (struct _graph * graph)
 {
-    struct _graph_it * it;
-
-    it = malloc(sizeof(struct _graph_it));
-
-    it->it = tree_iterator(graph->nodes);
-    if (it->it == NULL) {
-        free(it);
-        return NULL;
-    }
-    return it;
+    return (struct _graph_it *) tree_iterator(graph->nodes);
 }
 
 
 void graph_it_delete (struct _graph_it * graph_it)
 {
-    tree_it_delete(graph_it->it);
-    free(graph_it);
 }
 
 
 struct _graph_it * graph_it_next (struct _graph_it * graph_it)
 {
-    graph_it->it = tree_it_next(graph_it->it);
-    if (graph_it->it == NULL) {
-        free(graph_it);
-        return NULL;
-    }
-    return graph_it;
+    return (struct _graph_it *) tree_it_next((struct _tree_it *) graph_it);
 }
 
 
 void * graph_it_data  (struct _graph_it * graph_it)
 {
     struct _graph_node * node;
-    node = tree_it_data(graph_it->it);
-    if (node == NULL)
-        return NULL;
+    node = tree_it_data((struct _tree_it *) graph_it);
     return node->data;
 }
 
 
 struct _graph_node * graph_it_node  (struct _graph_it * graph_it)
 {
-    struct _graph_node * node;
-    node = tree_it_data(graph_it->it);
-    if (node == NULL)
-        return NULL;
-    return node;
+    return tree_it_data((struct _tree_it *) graph_it);
 }
 
 
 uint64_t graph_it_index (struct _graph_it * graph_it)
 {
     struct _graph_node * node;
-    node = tree_it_data(graph_it->it);
-    if (node == NULL)
-        return 0;
+    node = tree_it_data((struct _tree_it *) graph_it);
     return node->index;
 }
 
 
-struct _list * graph_it_edges (struct _graph_it * graph_it)
-{
-    struct _graph_node * node;
-    node = tree_it_data(graph_it->it);
-    if (node == NULL)
-        return NULL;
-    return node->edges;
-}
-
-
 int graph_cmp (void * a, void * b)
 {
     struct _graph_node * node_a = (struct _graph_node *) a;
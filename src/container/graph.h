@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 
+#include "arena.h"
 #include "list.h"
 #include "object.h"
 #include "serialize.h"
@@ -11,28 +12,60 @@
 // generic function pointers that need to be implemented for graph_node->data
 // delete, copy, merge
 
-struct _graph_it {
-    struct _tree_it * it;
-};
+// like tree iterators, graph iterators are the tree node holding the current
+// graph node and are never allocated
+struct _graph_it;
 
 struct _graph_edge {
     const struct _object * object;
     void   * data;
     uint64_t head;
     uint64_t tail;
+    // where this edge sits in head's successors and tail's predecessors
+    size_t   successors_pos;
+    size_t   predecessors_pos;
+};
+
+// a growable array of edges. walk it with a plain loop over edges[0 .. size)
+struct _graph_edges {
+    struct _graph_edge ** edges;
+    size_t                size;
+    size_t                capacity;
 };
 
+/*
+* edges are owned by the graph, which keeps one copy of each in its edge table.
+* nodes point to the edges leaving them from successors and to the edges
+* entering them from predecessors, so a loop from a node to itself is in both
+* of that node's arrays. the order of either array changes as edges are removed
+*/
 struct _graph_node {
     const struct _object * object;
     struct _graph * graph;
     uint64_t        index;
     void          * data;
-    struct _list  * edges;
+    struct _graph_edges successors;
+    struct _graph_edges predecessors;
+    // the edge arrays are allocated from here when not NULL
+    struct _arena * arena;
 };
 
 struct _graph {
     const struct _object * object;
     struct _tree         * nodes;
+    // node lookup and edge arrays are allocated from here when not NULL
+    struct _arena        * arena;
+    // every edge in the graph, hashed on head and tail with linear probing.
+    // empty slots are NULL
+    struct _graph_edge  ** edge_table;
+    size_t                 edge_table_size;
+    // always 0 or a power of two
+    size_t                 edge_table_slots;
+    // every node, hashed on index in the same way. exact lookups are answered
+    // here, ordered lookups and iteration by nodes
+    struct _graph_node  ** node_table;
+    size_t                 node_table_size;
+    size_t                 node_table_slots;
 };
 
 
@@ -43,6 +76,9 @@ void graph_debug (struct _graph * graph);
 * GRAPH OPERATOR INSTRUCTIONS
 */
 struct _graph * graph_create      ();
+// a graph whose node tree and edge arrays are allocated from arena. the graph
+// holds a reference to the arena. copies of the graph do not use it
+struct _graph * graph_create_arena (struct _arena * arena);
 void            graph_delete      (struct _graph * graph);
 int             graph_cmp         (void * a, void * b);
 struct _graph * graph_copy        (struct _graph * graph);
@@ -55,6 +91,14 @@ struct _graph * graph_deserialize (json_t * json);
 // merges graph rhs into graph (lhs)
 void graph_merge (struct _graph * graph, struct _graph * rhs);
 
+// like graph_merge, but rhs is consumed. its nodes and edges are moved into
+// graph instead of copied, and whatever graph already has is deleted. takes
+// time linear in the size of both graphs, or O(m log n) when rhs is much
+// smaller than graph. returns graph. moved nodes keep the arena they were
+// allocated from, which stays alive as long as they do, so graphs merged into
+// a long lived graph should not be built with an arena
+struct _graph * graph_merge_take (struct _graph * graph, struct _graph * rhs);
+
 // removes edges between nodes that are singly-linked and merges
 // their data
 void graph_reduce (struct _graph * graph);
@@ -63,24 +107,34 @@ void graph_reduce (struct _graph * graph);
 // index
 struct _graph * graph_family (struct _graph * graph, uint64_t index);
 
-void graph_add_node (struct _graph * graph,
-                     uint64_t        index,
-                     void *          data);
+// returns 0 on success, -1 if the graph already has a node at index
+int graph_add_node (struct _graph * graph,
+                    uint64_t        index,
+                    void *          data);
+
+// like graph_add_node, but the node adopts data instead of copying it. if the
+// graph already has a node at index data is deleted
+int graph_add_node_take (struct _graph * graph,
+                         uint64_t        index,
+                         void *          data);
 
 void graph_remove_node (struct _graph * graph, uint64_t index);
 
+// constant time
 struct _graph_node * graph_fetch_node  (struct _graph * graph,
                                         uint64_t        index);
 
 void               * graph_fetch_data  (struct _graph * graph,
                                         uint64_t        index);
 
-struct _list       * graph_fetch_edges (struct _graph * graph,
-                                        uint64_t        index);
-
 struct _graph_node * graph_fetch_node_max (struct _graph * graph,
                                            uint64_t        index);
 
+// constant time. returns NULL if there is no edge from head to tail
+struct _graph_edge * graph_fetch_edge  (struct _graph * graph,
+                                        uint64_t        head,
+                                        uint64_t        tail);
+
 // returns -1 on error, 0 on success
 int graph_add_edge (struct _graph * graph,
                     uint64_t        head_needle,
@@ -92,6 +146,8 @@ int graph_remove_edge (struct _graph * graph,
                        uint64_t tail_needle);
 
 void graph_map (struct _graph * graph, void (* callback) (struct _graph_node *));
+// breadth first walks built on graph_walk. each call sets up and tears down
+// its own walk, so prefer graph_walk when walking more than once
 void graph_bfs (struct _graph * graph,
                 uint64_t        index,
                 void (* callback) (struct _graph *, struct _graph_node *));
@@ -100,6 +156,82 @@ void graph_bfs_data (struct _graph * graph,
                      void          * data,
                      void (* callback) (struct _graph_node *, void * data));
 
+
+/*
+* GRAPH WALKS
+* A graph_walk holds the visited set, explicit stack and visit order of
+* iterative walks over a graph. They grow to fit the graph on the first walk,
+* so walks after that allocate nothing, and no walk recurses.
+*
+* The visited set outlives a walk. Nodes already visited are skipped, like the
+* visited sets of graph_csr walks, until graph_walk_clear empties it in
+* constant time. Edges may be added and removed between walks sharing a
+* visited set, but nodes may not, and the graph must not change at all during
+* a walk.
+*/
+
+// walk orders. GRAPH_WALK_PREDECESSORS may be or'd into any of them to walk
+// predecessors instead of successors
+#define GRAPH_WALK_BFS               0
+#define GRAPH_WALK_PREORDER          1
+#define GRAPH_WALK_POSTORDER         2
+#define GRAPH_WALK_REVERSE_POSTORDER 3
+#define GRAPH_WALK_PREDECESSORS      (1 << 4)
+
+// what a walk callback returns. PRUNE skips everything past this node and
+// only means something in BFS and preorder walks, where the node is seen
+// before what lies past it
+#define GRAPH_WALK_CONTINUE 0
+#define GRAPH_WALK_PRUNE    1
+#define GRAPH_WALK_STOP     2
+
+struct _graph_walk_frame {
+    struct _graph_node * node;
+    // the next edge of node to follow
+    size_t               edge;
+};
+
+struct _graph_walk {
+    const struct _object * object;
+    struct _graph        * graph;
+    // one stamp per slot of graph's node table. a node is visited when its
+    // stamp is epoch, and edges holds the edge it was reached along
+    uint32_t             * stamps;
+    struct _graph_edge  ** edges;
+    size_t                 slots;
+    uint32_t               epoch;
+    struct _graph_walk_frame * stack;
+    // the nodes visited by the last walk, in the order they were passed to
+    // the callback. BFS walks list nodes when they are queued, so after a
+    // stop this may hold nodes the callback never saw
+    struct _graph_node  ** nodes;
+    size_t                 size;
+    size_t                 capacity;
+};
+
+struct _graph_walk * graph_walk_create ();
+void                 graph_walk_delete (struct _graph_walk * walk);
+void                 graph_walk_clear  (struct _graph_walk * walk);
+
+/*
+* Walks graph from index in the given order, passing each node visited to
+* callback, which may be NULL. Reverse postorder walks find every node before
+* calling callback, so only GRAPH_WALK_STOP means anything to them.
+* Returns -1 if graph has no node at index, GRAPH_WALK_STOP if callback
+* stopped the walk, and 0 otherwise.
+*/
+int graph_walk (struct _graph_walk * walk,
+                struct _graph      * graph,
+                uint64_t             index,
+                int                  order,
+                int               (* callback) (struct _graph_node *, void *),
+                void               * data);
+
+// the edge the walk followed to reach node, or NULL for the node a walk
+// started at and nodes not visited
+struct _graph_edge * graph_walk_edge (struct _graph_walk * walk,
+                                      struct _graph_node * node);
+
 /*
 * GRAPH EDGE OPERATOR FUNCTIONS
 */
@@ -129,6 +261,9 @@ struct _graph_node * graph_node_deserialize (json_t * json);
 
 /*
 * GRAPH NODE EDGE ACCESSORS
+* The counts are stored, so these are constant time. Prefer looping over
+* node->successors and node->predecessors directly to the list versions, which
+* copy every edge into a new list.
 */
 size_t         graph_node_successors_n   (struct _graph_node * node);
 size_t         graph_node_predecessors_n (struct _graph_node * node);
@@ -139,9 +274,8 @@ struct _list * graph_node_predecessors   (struct _graph_node * node);
 
 /*
 * GRAPH ITERATION
-* Graph iterators are freed when graph_it_next returns free, so normally
-* you do not need to free them. If you need to manually free them, call
-* graph_it_delete
+* Graph iterators do not allocate, so there is nothing to free when you stop
+* iterating early. graph_it_delete is kept for older callers and does nothing.
 * DO NOT MODIFY THE GRAPH DURING ITERATION (jackass)
 */
 struct _graph_it *   graph_iterator  (struct _graph * graph);
@@ -150,7 +284,6 @@ struct _graph_it *   graph_it_next   (struct _graph_it * graph_it);
 void *               graph_it_data   (struct _graph_it * graph_it);
 uint64_t             graph_it_index  (struct _graph_it * graph_it);
 struct _graph_node * graph_it_node   (struct _graph_it * graph_it);
-struct _list *       graph_it_edges  (struct _graph_it * graph_it);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "graph_csr.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const struct _object graph_csr_object = {
+    (void   (*) (void *)) graph_csr_delete,
+    (void * (*) (void *)) graph_csr_copy,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+// while freezing, tails are translated to ids through a throwaway hash table
+// of ids keyed on index. it is sized to at least twice the node count and
+// empty slots are GRAPH_CSR_NONE
+size_t graph_csr_slot (struct _graph_csr * csr,
+                       uint32_t          * slots,
+                       size_t              mask,
+                       uint64_t            index)
+{
+    uint64_t hash = index * 0x9e3779b97f4a7c15ULL;
+    size_t   slot = (hash ^ (hash >> 32)) & mask;
+
+    while (    (slots[slot] != GRAPH_CSR_NONE)
+            && (csr->indexes[slots[slot]] != index))
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+
+struct _graph_csr * graph_freeze (struct _graph * graph)
+{
+    size_t size     = 0;
+    size_t capacity = 64;
+    size_t edges    = 0;
+    struct _graph_node ** nodes = malloc(sizeof(struct _graph_node *) * capacity);
+
+    // graph iterators walk the node tree in order, so ids follow indexes
+    struct _graph_it * it;
+    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
+        if (size == capacity) {
+            capacity *= 2;
+            nodes = realloc(nodes, sizeof(struct _graph_node *) * capacity);
+        }
+        nodes[size] = graph_it_node(it);
+        edges += nodes[size]->successors.size;
+        size++;
+    }
+
+    // GRAPH_CSR_NONE is reserved
+    if (size >= GRAPH_CSR_NONE) {
+        fprintf(stderr, "graph_freeze: too many nodes (%llu)\n",
+                (unsigned long long) size);
+        free(nodes);
+        return NULL;
+    }
+
+    struct _graph_csr * csr = malloc(sizeof(struct _graph_csr));
+    csr->object              = &graph_csr_object;
+    csr->refs                = 1;
+    csr->size                = size;
+    csr->indexes             = malloc(sizeof(uint64_t) * size);
+    csr->data                = malloc(sizeof(void *) * size);
+    csr->successors_offset   = malloc(sizeof(size_t) * (size + 1));
+    csr->predecessors_offset = calloc(size + 1, sizeof(size_t));
+    csr->successors          = malloc(sizeof(uint32_t) * edges);
+    csr->predecessors        = malloc(sizeof(uint32_t) * edges);
+
+    size_t mask = 15;
+    while (mask + 1 < size * 2)
+        mask = (mask << 1) | 1;
+    uint32_t * slots = malloc(sizeof(uint32_t) * (mask + 1));
+    memset(slots, 0xff, sizeof(uint32_t) * (mask + 1));
+
+    size_t id;
+    size_t offset = 0;
+    for (id = 0; id < size; id++) {
+        csr->indexes[id]           = nodes[id]->index;
+        csr->data[id]              = nodes[id]->data;
+        csr->successors_offset[id] = offset;
+        offset += nodes[id]->successors.size;
+        slots[graph_csr_slot(csr, slots, mask, nodes[id]->index)] = id;
+    }
+    csr->successors_offset[size] = offset;
+
+    // every node is numbered now, so edges can be translated to ids. count
+    // the predecessors of each node as we go
+    offset = 0;
+    for (id = 0; id < size; id++) {
+        struct _graph_edges * successors = &(nodes[id]->successors);
+        size_t i;
+        for (i = 0; i < successors->size; i++) {
+            uint64_t index = successors->edges[i]->tail;
+            uint32_t tail  = slots[graph_csr_slot(csr, slots, mask, index)];
+            csr->successors[offset++] = tail;
+            csr->predecessors_offset[tail + 1]++;
+        }
+    }
+
+    free(slots);
+    free(nodes);
+
+    for (id = 0; id < size; id++)
+        csr->predecessors_offset[id + 1] += csr->predecessors_offset[id];
+
+    // heads are visited in ascending order, so each node's predecessors end
+    // up sorted
+    size_t * fill = malloc(sizeof(size_t) * (size + 1));
+    memcpy(fill, csr->predecessors_offset, sizeof(size_t) * (size + 1));
+    for (id = 0; id < size; id++) {
+        size_t i;
+        for (i  = csr->successors_offset[id];
+             i  < csr->successors_offset[id + 1];
+             i++) {
+            csr->predecessors[fill[csr->successors[i]]++] = id;
+        }
+    }
+    free(fill);
+
+    return csr;
+}
+
+
+void graph_csr_delete (struct _graph_csr * csr)
+{
+    if (! object_release(csr))
+        return;
+
+    free(csr->indexes);
+    free(csr->data);
+    free(csr->successors_offset);
+    free(csr->predecessors_offset);
+    free(csr->successors);
+    free(csr->predecessors);
+    free(csr);
+}
+
+
+// snapshots never change, so copies are shared
+struct _graph_csr * graph_csr_copy (struct _graph_csr * csr)
+{
+    return object_share(csr);
+}
+
+
+uint32_t graph_csr_id (struct _graph_csr * csr, uint64_t index)
+{
+    size_t lo = 0;
+    size_t hi = csr->size;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (csr->indexes[mid] < index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ((lo < csr->size) && (csr->indexes[lo] == index))
+        return lo;
+    return GRAPH_CSR_NONE;
+}
+
+
+uint64_t * graph_csr_visited_create (struct _graph_csr * csr)
+{
+    // never hand out a zero sized allocation
+    return calloc(csr->size / 64 + 1, sizeof(uint64_t));
+}
+
+
+void graph_csr_visited_clear (uint64_t * visited, uint32_t * ids, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++)
+        visited[ids[i] >> 6] &= ~((uint64_t) 1 << (ids[i] & 63));
+}
+
+
+// ids doubles as the queue. everything before head has been expanded and
+// everything from head to tail is waiting to be
+size_t graph_csr_walk (struct _graph_csr * csr,
+                       uint32_t            root,
+                       uint64_t          * visited,
+                       uint32_t          * ids,
+                       int                 predecessors)
+{
+    size_t head = 0;
+    size_t tail = 0;
+
+    if (GRAPH_CSR_VISITED(visited, root))
+        return 0;
+    visited[root >> 6] |= (uint64_t) 1 << (root & 63);
+    ids[tail++] = root;
+
+    while (head < tail) {
+        uint32_t id = ids[head++];
+        size_t i;
+
+        for (i = csr->successors_offset[id];
+             i < csr->successors_offset[id + 1];
+             i++) {
+            uint32_t next = csr->successors[i];
+            if (GRAPH_CSR_VISITED(visited, next))
+                continue;
+            visited[next >> 6] |= (uint64_t) 1 << (next & 63);
+            ids[tail++] = next;
+        }
+
+        if (! predecessors)
+            continue;
+
+        for (i = csr->predecessors_offset[id];
+             i < csr->predecessors_offset[id + 1];
+             i++) {
+            uint32_t next = csr->predecessors[i];
+            if (GRAPH_CSR_VISITED(visited, next))
+                continue;
+            visited[next >> 6] |= (uint64_t) 1 << (next & 63);
+            ids[tail++] = next;
+        }
+    }
+
+    return tail;
+}
+
+
+size_t graph_csr_reachable (struct _graph_csr * csr,
+                            uint32_t            root,
+                            uint64_t          * visited,
+                            uint32_t          * ids)
+{
+    return graph_csr_walk(csr, root, visited, ids, 0);
+}
+
+
+size_t graph_csr_family (struct _graph_csr * csr,
+                         uint32_t            root,
+                         uint64_t          * visited,
+                         uint32_t          * ids)
+{
+    return graph_csr_walk(csr, root, visited, ids, 1);
+}
@@ -0,0 +1,84 @@
+#ifndef graph_csr_HEADER
+#define graph_csr_HEADER
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "graph.h"
+#include "object.h"
+
+/*
+* A graph_csr is a read only snapshot of a graph in compressed sparse row form,
+* for analysis passes which walk a whole graph and change nothing.
+*
+* Nodes are numbered 0 .. size - 1 in ascending order of their index, so
+* indexes[id] is the index of node id and graph_csr_id goes the other way with
+* a binary search. The successors of node id are the ids
+* successors[successors_offset[id] .. successors_offset[id + 1]), and
+* predecessors are laid out the same way. A loop from a node to itself is in
+* both of its ranges.
+*
+* data[id] is the data of node id, borrowed from the graph. The snapshot does
+* not follow the graph, and data is only valid until the graph is modified or
+* deleted, so freeze, walk and delete the snapshot in one go.
+*
+* Snapshots are reference counted and copies are shared.
+*/
+
+// graph_csr_id of an index which is not in the snapshot
+#define GRAPH_CSR_NONE UINT32_MAX
+
+// visited sets are bitsets holding one bit per node id
+#define GRAPH_CSR_VISITED(visited, id) \
+    ((visited)[(id) >> 6] & ((uint64_t) 1 << ((id) & 63)))
+
+struct _graph_csr {
+    const struct _object * object;
+    unsigned int refs;
+    uint32_t     size;
+    uint64_t   * indexes;
+    void      ** data;
+    // size + 1 entries each
+    size_t     * successors_offset;
+    size_t     * predecessors_offset;
+    uint32_t   * successors;
+    uint32_t   * predecessors;
+};
+
+
+// takes time linear in the nodes and edges of graph. returns NULL if graph
+// has more nodes than a node id can hold
+struct _graph_csr * graph_freeze     (struct _graph * graph);
+void                graph_csr_delete (struct _graph_csr * csr);
+struct _graph_csr * graph_csr_copy   (struct _graph_csr * csr);
+
+uint32_t            graph_csr_id     (struct _graph_csr * csr, uint64_t index);
+
+// returns an empty visited set for csr. release it with free
+uint64_t * graph_csr_visited_create (struct _graph_csr * csr);
+// clears the bits of the count nodes in ids, so a visited set can be reused
+// in time proportional to the last walk instead of to the whole graph
+void       graph_csr_visited_clear  (uint64_t * visited,
+                                     uint32_t * ids,
+                                     size_t     count);
+
+/*
+* Breadth first walks from root. Nodes already in visited are skipped, and
+* every node reached is added to visited and written to ids, root first. ids
+* must have room for csr->size entries. Returns the number of ids written,
+* which is 0 if root was already visited.
+*
+* graph_csr_reachable follows successors, like graph_bfs. graph_csr_family
+* follows successors and predecessors, and reaches the same nodes as
+* graph_family.
+*/
+size_t graph_csr_reachable (struct _graph_csr * csr,
+                            uint32_t            root,
+                            uint64_t          * visited,
+                            uint32_t          * ids);
+size_t graph_csr_family    (struct _graph_csr * csr,
+                            uint32_t            root,
+                            uint64_t          * visited,
+                            uint32_t          * ids);
+
+#endif
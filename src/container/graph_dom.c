@@ -0,0 +1,511 @@
+#include "graph_dom.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const struct _object graph_dom_object = {
+    (void   (*) (void *)) graph_dom_delete,
+    (void * (*) (void *)) graph_dom_copy,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+size_t graph_dom_slot (struct _graph_dom * dom, uint64_t index)
+{
+    uint64_t hash = index * 0x9e3779b97f4a7c15ULL;
+    size_t   slot = (hash ^ (hash >> 32)) & dom->mask;
+
+    while (    (dom->slots[slot] != GRAPH_DOM_NONE)
+            && (dom->indexes[dom->slots[slot]] != index))
+        slot = (slot + 1) & dom->mask;
+
+    return slot;
+}
+
+
+// the node number of index, or GRAPH_DOM_NONE
+uint32_t graph_dom_node (struct _graph_dom * dom, uint64_t index)
+{
+    return dom->slots[graph_dom_slot(dom, index)];
+}
+
+
+void graph_dom_rehash (struct _graph_dom * dom, size_t mask)
+{
+    free(dom->slots);
+    dom->mask  = mask;
+    dom->slots = malloc(sizeof(uint32_t) * (mask + 1));
+    memset(dom->slots, 0xff, sizeof(uint32_t) * (mask + 1));
+
+    uint32_t node;
+    for (node = 0; node < dom->size; node++)
+        dom->slots[graph_dom_slot(dom, dom->indexes[node])] = node;
+}
+
+
+/*
+* Numbers the nodes reachable from root in reverse postorder. The edges out of
+* node n are out[out_offset[n] .. out_offset[n + 1]). Fills order with the
+* nodes in reverse postorder and number with the position of each node in
+* order, or GRAPH_DOM_NONE for nodes not reached. Returns the number of nodes
+* reached.
+*/
+uint32_t graph_dom_order (uint32_t   count,
+                          uint32_t   root,
+                          size_t   * out_offset,
+                          uint32_t * out,
+                          uint32_t * order,
+                          uint32_t * number)
+{
+    // a node's position in out is kept in its stack entry while it is open
+    uint32_t * stack = malloc(sizeof(uint32_t) * count);
+    size_t   * edge  = malloc(sizeof(size_t) * count);
+    size_t     depth = 0;
+    uint32_t   done  = 0;
+    uint32_t   i;
+
+    // number doubles as the visited set while walking
+    for (i = 0; i < count; i++)
+        number[i] = GRAPH_DOM_NONE;
+
+    number[root] = 0;
+    stack[depth] = root;
+    edge[depth]  = out_offset[root];
+    depth++;
+
+    while (depth > 0) {
+        uint32_t node = stack[depth - 1];
+
+        if (edge[depth - 1] < out_offset[node + 1]) {
+            uint32_t next = out[edge[depth - 1]++];
+            if (number[next] != GRAPH_DOM_NONE)
+                continue;
+            number[next] = 0;
+            stack[depth] = next;
+            edge[depth]  = out_offset[next];
+            depth++;
+            continue;
+        }
+
+        depth--;
+        order[done++] = node;
+    }
+
+    free(stack);
+    free(edge);
+
+    for (i = 0; i < done / 2; i++) {
+        uint32_t node = order[i];
+        order[i] = order[done - 1 - i];
+        order[done - 1 - i] = node;
+    }
+    for (i = 0; i < done; i++)
+        number[order[i]] = i;
+
+    return done;
+}
+
+
+/*
+* Finds the immediate dominator of every node reachable from root, in a graph
+* laid out like the one graph_dom_order walks where in holds the edges into
+* each node. idom gets GRAPH_DOM_NONE for root and nodes not reached.
+*/
+void graph_dom_solve (uint32_t   count,
+                      uint32_t   root,
+                      size_t   * out_offset,
+                      uint32_t * out,
+                      size_t   * in_offset,
+                      uint32_t * in,
+                      uint32_t * idom)
+{
+    uint32_t * order  = malloc(sizeof(uint32_t) * count);
+    uint32_t * number = malloc(sizeof(uint32_t) * count);
+    uint32_t   done   = graph_dom_order(count, root, out_offset, out,
+                                        order, number);
+
+    // doms works in reverse postorder numbers, where a dominator always has a
+    // lower number than the nodes it dominates
+    uint32_t * doms = malloc(sizeof(uint32_t) * count);
+    uint32_t   i;
+    for (i = 0; i < done; i++)
+        doms[i] = GRAPH_DOM_NONE;
+    doms[0] = 0;
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (i = 1; i < done; i++) {
+            uint32_t node   = order[i];
+            uint32_t new_dom = GRAPH_DOM_NONE;
+            size_t   j;
+
+            for (j = in_offset[node]; j < in_offset[node + 1]; j++) {
+                uint32_t pred = number[in[j]];
+                if ((pred == GRAPH_DOM_NONE) || (doms[pred] == GRAPH_DOM_NONE))
+                    continue;
+                if (new_dom == GRAPH_DOM_NONE) {
+                    new_dom = pred;
+                    continue;
+                }
+                // walk both up the tree until they meet
+                while (pred != new_dom) {
+                    while (pred > new_dom)
+                        pred = doms[pred];
+                    while (new_dom > pred)
+                        new_dom = doms[new_dom];
+                }
+            }
+
+            if (doms[i] != new_dom) {
+                doms[i] = new_dom;
+                changed = 1;
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if ((number[i] == GRAPH_DOM_NONE) || (i == root))
+            idom[i] = GRAPH_DOM_NONE;
+        else
+            idom[i] = order[doms[number[i]]];
+    }
+
+    free(order);
+    free(number);
+    free(doms);
+}
+
+
+/*
+* Numbers the tree given by idom depth first from root, so a dominates b when
+* b's interval lies within a's. Nodes outside the tree have no parent and are
+* not root, and get an enter of GRAPH_DOM_NONE.
+*/
+void graph_dom_intervals (uint32_t   count,
+                          uint32_t   root,
+                          uint32_t * idom,
+                          uint32_t * enter,
+                          uint32_t * leave)
+{
+    size_t   * offset   = calloc(count + 1, sizeof(size_t));
+    uint32_t * children = malloc(sizeof(uint32_t) * count);
+    uint32_t   i;
+
+    for (i = 0; i < count; i++) {
+        if (idom[i] != GRAPH_DOM_NONE)
+            offset[idom[i] + 1]++;
+    }
+    for (i = 0; i < count; i++)
+        offset[i + 1] += offset[i];
+
+    size_t * fill = malloc(sizeof(size_t) * (count + 1));
+    memcpy(fill, offset, sizeof(size_t) * (count + 1));
+    for (i = 0; i < count; i++) {
+        if (idom[i] != GRAPH_DOM_NONE)
+            children[fill[idom[i]]++] = i;
+        enter[i] = GRAPH_DOM_NONE;
+        leave[i] = GRAPH_DOM_NONE;
+    }
+    free(fill);
+
+    uint32_t * stack  = malloc(sizeof(uint32_t) * count);
+    size_t   * edge   = malloc(sizeof(size_t) * count);
+    size_t     depth  = 0;
+    uint32_t   clock  = 0;
+
+    enter[root]  = clock++;
+    stack[depth] = root;
+    edge[depth]  = offset[root];
+    depth++;
+
+    while (depth > 0) {
+        uint32_t node = stack[depth - 1];
+
+        if (edge[depth - 1] < offset[node + 1]) {
+            uint32_t child = children[edge[depth - 1]++];
+            enter[child] = clock++;
+            stack[depth] = child;
+            edge[depth]  = offset[child];
+            depth++;
+            continue;
+        }
+
+        depth--;
+        leave[node] = clock++;
+    }
+
+    free(stack);
+    free(edge);
+    free(offset);
+    free(children);
+}
+
+
+// walks depth first from root, numbering nodes as they are found and
+// collecting their ids. the stack is never deeper than the nodes found, so it
+// grows along with ids
+uint32_t graph_dom_reach (struct _graph_dom * dom,
+                          struct _graph_csr * csr,
+                          uint32_t            root,
+                          uint32_t         ** ids)
+{
+    size_t     capacity = 64;
+    uint32_t * stack    = malloc(sizeof(uint32_t) * capacity);
+    size_t   * edge     = malloc(sizeof(size_t) * capacity);
+    size_t     depth    = 0;
+
+    *ids         = malloc(sizeof(uint32_t) * capacity);
+    dom->indexes = malloc(sizeof(uint64_t) * capacity);
+    dom->size    = 0;
+    dom->slots   = NULL;
+    graph_dom_rehash(dom, 15);
+
+    (*ids)[dom->size] = root;
+    dom->indexes[dom->size] = csr->indexes[root];
+    dom->slots[graph_dom_slot(dom, csr->indexes[root])] = dom->size;
+    dom->size++;
+
+    stack[depth] = root;
+    edge[depth]  = csr->successors_offset[root];
+    depth++;
+
+    while (depth > 0) {
+        uint32_t id = stack[depth - 1];
+
+        if (edge[depth - 1] >= csr->successors_offset[id + 1]) {
+            depth--;
+            continue;
+        }
+
+        uint32_t next  = csr->successors[edge[depth - 1]++];
+        uint64_t index = csr->indexes[next];
+        size_t   slot  = graph_dom_slot(dom, index);
+        if (dom->slots[slot] != GRAPH_DOM_NONE)
+            continue;
+
+        if (dom->size == capacity) {
+            capacity *= 2;
+            *ids         = realloc(*ids, sizeof(uint32_t) * capacity);
+            dom->indexes = realloc(dom->indexes, sizeof(uint64_t) * capacity);
+            stack        = realloc(stack, sizeof(uint32_t) * capacity);
+            edge         = realloc(edge, sizeof(size_t) * capacity);
+        }
+        (*ids)[dom->size] = next;
+        dom->indexes[dom->size] = index;
+        dom->slots[slot] = dom->size;
+        dom->size++;
+
+        // keep the table at most half full
+        if (dom->size * 2 > dom->mask + 1)
+            graph_dom_rehash(dom, (dom->mask << 1) | 1);
+
+        stack[depth] = next;
+        edge[depth]  = csr->successors_offset[next];
+        depth++;
+    }
+
+    free(stack);
+    free(edge);
+
+    return dom->size;
+}
+
+
+struct _graph_dom * graph_dom_create (struct _graph_csr * csr,
+                                      uint64_t            index,
+                                      int                 post)
+{
+    uint32_t root = graph_csr_id(csr, index);
+    if (root == GRAPH_CSR_NONE)
+        return NULL;
+
+    struct _graph_dom * dom = malloc(sizeof(struct _graph_dom));
+    dom->object  = &graph_dom_object;
+    dom->refs    = 1;
+    dom->post    = post;
+    dom->headers = NULL;
+
+    uint32_t * ids;
+    uint32_t   size = graph_dom_reach(dom, csr, root, &ids);
+    uint32_t   node;
+    size_t     i;
+
+    // successors of every reached node in reached numbers. everything a
+    // reached node leads to is reached too
+    size_t   * succ_offset = malloc(sizeof(size_t) * (size + 2));
+    size_t     edges = 0;
+    for (node = 0; node < size; node++)
+        edges += csr->successors_offset[ids[node] + 1]
+                 - csr->successors_offset[ids[node]];
+
+    // post-dominators need an exit node after the others, which every exit
+    // leads to
+    uint32_t   exit   = size;
+    uint32_t * succ   = malloc(sizeof(uint32_t) * (edges + size));
+    size_t     offset = 0;
+    for (node = 0; node < size; node++) {
+        succ_offset[node] = offset;
+        for (i  = csr->successors_offset[ids[node]];
+             i  < csr->successors_offset[ids[node] + 1];
+             i++) {
+            succ[offset++] = graph_dom_node(dom, csr->indexes[csr->successors[i]]);
+        }
+        if (post && (succ_offset[node] == offset))
+            succ[offset++] = exit;
+    }
+    succ_offset[size]     = offset;
+    succ_offset[size + 1] = offset;
+    free(ids);
+
+    // the same edges the other way around
+    uint32_t count       = post ? size + 1 : size;
+    size_t * pred_offset = calloc(count + 1, sizeof(size_t));
+    uint32_t * pred      = malloc(sizeof(uint32_t) * (offset + 1));
+    for (node = 0; node < count; node++) {
+        for (i = succ_offset[node]; i < succ_offset[node + 1]; i++)
+            pred_offset[succ[i] + 1]++;
+    }
+    for (node = 0; node < count; node++)
+        pred_offset[node + 1] += pred_offset[node];
+
+    size_t * fill = malloc(sizeof(size_t) * (count + 1));
+    memcpy(fill, pred_offset, sizeof(size_t) * (count + 1));
+    for (node = 0; node < count; node++) {
+        for (i = succ_offset[node]; i < succ_offset[node + 1]; i++)
+            pred[fill[succ[i]]++] = node;
+    }
+    free(fill);
+
+    uint32_t * idom  = malloc(sizeof(uint32_t) * count);
+    uint32_t * enter = malloc(sizeof(uint32_t) * count);
+    uint32_t * leave = malloc(sizeof(uint32_t) * count);
+
+    if (post) {
+        // post-dominators are dominators of the reversed graph, rooted at the
+        // exit node
+        graph_dom_solve(count, exit, pred_offset, pred, succ_offset, succ, idom);
+        graph_dom_intervals(count, exit, idom, enter, leave);
+        for (node = 0; node < size; node++) {
+            if (idom[node] == exit)
+                idom[node] = GRAPH_DOM_NONE;
+        }
+    }
+    else {
+        graph_dom_solve(count, 0, succ_offset, succ, pred_offset, pred, idom);
+        graph_dom_intervals(count, 0, idom, enter, leave);
+    }
+
+    dom->idom  = idom;
+    dom->enter = enter;
+    dom->leave = leave;
+
+    if (! post) {
+        dom->headers = calloc(size / 64 + 1, sizeof(uint64_t));
+        for (node = 0; node < size; node++) {
+            for (i = succ_offset[node]; i < succ_offset[node + 1]; i++) {
+                uint32_t tail = succ[i];
+                if (    (enter[tail] <= enter[node])
+                     && (leave[node] <= leave[tail]))
+                    dom->headers[tail >> 6] |= (uint64_t) 1 << (tail & 63);
+            }
+        }
+    }
+
+    free(succ_offset);
+    free(succ);
+    free(pred_offset);
+    free(pred);
+
+    return dom;
+}
+
+
+struct _graph_dom * graph_dominators (struct _graph_csr * csr, uint64_t index)
+{
+    return graph_dom_create(csr, index, 0);
+}
+
+
+struct _graph_dom * graph_post_dominators (struct _graph_csr * csr,
+                                           uint64_t            index)
+{
+    return graph_dom_create(csr, index, 1);
+}
+
+
+void graph_dom_delete (struct _graph_dom * dom)
+{
+    if (! object_release(dom))
+        return;
+
+    free(dom->indexes);
+    free(dom->idom);
+    free(dom->enter);
+    free(dom->leave);
+    free(dom->headers);
+    free(dom->slots);
+    free(dom);
+}
+
+
+// trees never change, so copies are shared
+struct _graph_dom * graph_dom_copy (struct _graph_dom * dom)
+{
+    return object_share(dom);
+}
+
+
+int graph_dom_contains (struct _graph_dom * dom, uint64_t index)
+{
+    return graph_dom_node(dom, index) != GRAPH_DOM_NONE;
+}
+
+
+int graph_dom_idom (struct _graph_dom * dom, uint64_t index, uint64_t * idom)
+{
+    uint32_t node = graph_dom_node(dom, index);
+    if ((node == GRAPH_DOM_NONE) || (dom->idom[node] == GRAPH_DOM_NONE))
+        return -1;
+
+    *idom = dom->indexes[dom->idom[node]];
+    return 0;
+}
+
+
+int graph_dom_dominates (struct _graph_dom * dom, uint64_t a, uint64_t b)
+{
+    uint32_t lhs = graph_dom_node(dom, a);
+    uint32_t rhs = graph_dom_node(dom, b);
+
+    if ((lhs == GRAPH_DOM_NONE) || (rhs == GRAPH_DOM_NONE))
+        return 0;
+    if ((dom->enter[lhs] == GRAPH_DOM_NONE) || (dom->enter[rhs] == GRAPH_DOM_NONE))
+        return 0;
+
+    return    (dom->enter[lhs] <= dom->enter[rhs])
+           && (dom->leave[rhs] <= dom->leave[lhs]);
+}
+
+
+int graph_dom_back_edge (struct _graph_dom * dom, uint64_t head, uint64_t tail)
+{
+    if (dom->post)
+        return 0;
+    return graph_dom_dominates(dom, tail, head);
+}
+
+
+int graph_dom_loop_header (struct _graph_dom * dom, uint64_t index)
+{
+    if (dom->headers == NULL)
+        return 0;
+
+    uint32_t node = graph_dom_node(dom, index);
+    if (node == GRAPH_DOM_NONE)
+        return 0;
+
+    return (dom->headers[node >> 6] >> (node & 63)) & 1;
+}
@@ -0,0 +1,83 @@
+#ifndef graph_dom_HEADER
+#define graph_dom_HEADER
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "graph_csr.h"
+#include "object.h"
+
+/*
+* A graph_dom is the dominator or post-dominator tree of the nodes of a
+* graph_csr reachable from one root, usually the entry of a function. Trees
+* are found with the iterative algorithm of Cooper, Harvey and Kennedy.
+*
+* a dominates b when every path from the root to b passes through a. a
+* post-dominates b when every path from b to an exit passes through a, where
+* exits are the reachable nodes without successors. Every node dominates and
+* post-dominates itself. Nodes which can not reach an exit are not in the
+* post-dominator tree.
+*
+* Trees copy what they need from the snapshot, so they stay valid after the
+* snapshot and its graph are gone, but they are not updated when the graph
+* changes. Every query takes constant time. Trees are reference counted and
+* copies are shared.
+*/
+
+#define GRAPH_DOM_NONE UINT32_MAX
+
+struct _graph_dom {
+    const struct _object * object;
+    unsigned int refs;
+    int          post;
+    // the nodes reachable from the root, in the order a depth first walk
+    // found them, so the root is node 0
+    uint32_t     size;
+    uint64_t   * indexes;
+    // idom[node] is the immediate dominator of node, or GRAPH_DOM_NONE for
+    // the root. in post-dominator trees it is also GRAPH_DOM_NONE for nodes
+    // post-dominated by nothing but the exits, and nodes outside the tree
+    uint32_t   * idom;
+    // a dominates b when b's interval lies within a's. enter is GRAPH_DOM_NONE
+    // for nodes outside the tree
+    uint32_t   * enter;
+    uint32_t   * leave;
+    // a bitset of the nodes which are the tail of a back edge, or NULL for
+    // post-dominator trees
+    uint64_t   * headers;
+    // node numbers hashed on index with linear probing, like the node table of
+    // graph. empty slots are GRAPH_DOM_NONE
+    uint32_t   * slots;
+    size_t       mask;
+};
+
+
+// return NULL if csr has no node at index
+struct _graph_dom * graph_dominators      (struct _graph_csr * csr,
+                                           uint64_t            index);
+struct _graph_dom * graph_post_dominators (struct _graph_csr * csr,
+                                           uint64_t            index);
+
+void                graph_dom_delete (struct _graph_dom * dom);
+struct _graph_dom * graph_dom_copy   (struct _graph_dom * dom);
+
+// whether index is reachable from the root of dom
+int graph_dom_contains (struct _graph_dom * dom, uint64_t index);
+
+// returns 0 and sets idom to the immediate dominator of index, or returns -1
+// if it has none
+int graph_dom_idom (struct _graph_dom * dom, uint64_t index, uint64_t * idom);
+
+// whether a dominates b, or post-dominates b in a post-dominator tree
+int graph_dom_dominates (struct _graph_dom * dom, uint64_t a, uint64_t b);
+
+/*
+* Dominator trees only, these are always 0 for post-dominator trees.
+* head -> tail is a back edge when tail dominates head, and a loop header is
+* the tail of a back edge. Only natural loops have back edges, so irreducible
+* loops are not found.
+*/
+int graph_dom_back_edge   (struct _graph_dom * dom, uint64_t head, uint64_t tail);
+int graph_dom_loop_header (struct _graph_dom * dom, uint64_t index);
+
+#endif
@@ -0,0 +1,102 @@
+#include "graph_view.h"
+
+static const struct _object graph_view_object = {
+    (void   (*) (void *)) graph_view_delete,
+    (void * (*) (void *)) graph_view_copy,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+int graph_view_id_cmp (const void * lhs, const void * rhs)
+{
+    uint32_t a = *((const uint32_t *) lhs);
+    uint32_t b = *((const uint32_t *) rhs);
+
+    if (a < b)
+        return -1;
+    else if (a > b)
+        return 1;
+    return 0;
+}
+
+
+struct _graph_view * graph_view_family (struct _graph     * graph,
+                                        struct _graph_csr * csr,
+                                        uint64_t            index)
+{
+    uint32_t root = graph_csr_id(csr, index);
+
+    if (root == GRAPH_CSR_NONE)
+        return NULL;
+
+    uint64_t * visited = graph_csr_visited_create(csr);
+    uint32_t * ids     = malloc(sizeof(uint32_t) * csr->size);
+    size_t     size    = graph_csr_family(csr, root, visited, ids);
+
+    // ids come out of the walk breadth first. ids follow indexes, so sorting
+    // them puts members in the order of the graph
+    qsort(ids, size, sizeof(uint32_t), graph_view_id_cmp);
+    ids = realloc(ids, sizeof(uint32_t) * size);
+
+    struct _graph_view * view = malloc(sizeof(struct _graph_view));
+    view->object  = &graph_view_object;
+    view->refs    = 1;
+    view->graph   = graph;
+    view->csr     = object_share(csr);
+    view->index   = index;
+    view->visited = visited;
+    view->ids     = ids;
+    view->size    = size;
+
+    return view;
+}
+
+
+void graph_view_delete (struct _graph_view * view)
+{
+    if (! object_release(view))
+        return;
+
+    object_delete(view->csr);
+    free(view->visited);
+    free(view->ids);
+    free(view);
+}
+
+
+// views never change, so copies are shared
+struct _graph_view * graph_view_copy (struct _graph_view * view)
+{
+    return object_share(view);
+}
+
+
+int graph_view_contains (struct _graph_view * view, uint64_t index)
+{
+    uint32_t id = graph_csr_id(view->csr, index);
+
+    if (id == GRAPH_CSR_NONE)
+        return 0;
+
+    return GRAPH_CSR_VISITED(view->visited, id) ? 1 : 0;
+}
+
+
+uint64_t graph_view_index (struct _graph_view * view, size_t i)
+{
+    return view->csr->indexes[view->ids[i]];
+}
+
+
+void * graph_view_data (struct _graph_view * view, size_t i)
+{
+    return view->csr->data[view->ids[i]];
+}
+
+
+struct _graph_node * graph_view_node (struct _graph_view * view, size_t i)
+{
+    return graph_fetch_node(view->graph, graph_view_index(view, i));
+}
@@ -0,0 +1,56 @@
+#ifndef graph_view_HEADER
+#define graph_view_HEADER
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "graph.h"
+#include "graph_csr.h"
+#include "object.h"
+
+/*
+* A graph_view is the family of a node, the nodes graph_family would copy out,
+* seen through the graph it came from instead of copied. Membership is a bitset
+* over the node ids of a graph_csr snapshot of the graph, and the members are
+* kept in ascending order of index, the order graph iterators visit them in.
+*
+* Nodes, their data and their edges are read from the graph itself. A family
+* is closed under successors and predecessors, so every edge of a member leads
+* to another member. Like the snapshot it shares, a view is only valid until
+* the graph is modified or deleted.
+*
+* Views are reference counted and copies are shared.
+*/
+
+struct _graph_view {
+    const struct _object * object;
+    unsigned int refs;
+    struct _graph     * graph;
+    struct _graph_csr * csr;
+    // the index the view was created from
+    uint64_t            index;
+    uint64_t          * visited;
+    // the csr ids of members, ascending
+    uint32_t          * ids;
+    size_t              size;
+};
+
+
+// csr must be a snapshot of graph. returns NULL if graph has no node at index.
+// takes time linear in the size of the family
+struct _graph_view * graph_view_family (struct _graph     * graph,
+                                        struct _graph_csr * csr,
+                                        uint64_t            index);
+void                 graph_view_delete (struct _graph_view * view);
+struct _graph_view * graph_view_copy   (struct _graph_view * view);
+
+int                  graph_view_contains (struct _graph_view * view,
+                                          uint64_t             index);
+
+// members are numbered 0 .. size - 1
+uint64_t             graph_view_index (struct _graph_view * view, size_t i);
+void *               graph_view_data  (struct _graph_view * view, size_t i);
+// constant time
+struct _graph_node * graph_view_node  (struct _graph_view * view, size_t i);
+
+#endif
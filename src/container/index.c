@@ -48,6 +48,16 @@ int index_cmp (struct _index * lhs, struct _index * rhs)
 }
 
 
+int index_cmp_key (uint64_t * key, struct _index * index)
+{
+    if (*key < index->index)
+        return -1;
+    else if (*key > index->index)
+        return 1;
+    return 0;
+}
+
+
 json_t * index_serialize (struct _index * index)
 {
     json_t * json = json_object();
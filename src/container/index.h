@@ -18,6 +18,8 @@ struct _index * index_create      (uint64_t index);
 void		    index_delete      (struct _index * index);
 struct _index * index_copy        (struct _index * index);
 int 			index_cmp         (struct _index * lhs, struct _index * rhs);
+// orders a raw uint64_t against an index, for tree_fetch_key
+int             index_cmp_key     (uint64_t * key, struct _index * index);
 json_t        * index_serialize   (struct _index * index);
 struct _index * index_deserialize (json_t * json);
 
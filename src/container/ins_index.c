@@ -0,0 +1,206 @@
+#include "ins_index.h"
+
+#include "list.h"
+
+static const struct _object ins_index_object = {
+    (void   (*) (void *)) ins_index_delete,
+    (void * (*) (void *)) ins_index_copy,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+int ins_index_entry_cmp (const void * lhs, const void * rhs)
+{
+    const struct _ins_index_entry * a = lhs;
+    const struct _ins_index_entry * b = rhs;
+
+    if (a->address < b->address)
+        return -1;
+    else if (a->address > b->address)
+        return 1;
+    else if (a->node < b->node)
+        return -1;
+    else if (a->node > b->node)
+        return 1;
+    return 0;
+}
+
+
+struct _ins_index * ins_index_create (struct _graph * graph)
+{
+    size_t size     = 0;
+    size_t capacity = 64;
+    struct _ins_index_entry * entries;
+    entries = malloc(sizeof(struct _ins_index_entry) * capacity);
+
+    // nodes come out of the iterator in order, and instructions within a node
+    // are in order, so entries are only out of order where blocks overlap
+    int sorted = 1;
+    struct _graph_it * it;
+    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
+        struct _graph_node * node = graph_it_node(it);
+        uint32_t slot = 0;
+
+        struct _list_it * lit;
+        for (lit = list_iterator(node->data); lit != NULL; lit = lit->next) {
+            struct _ins * ins = lit->data;
+
+            if (size == capacity) {
+                capacity *= 2;
+                entries = realloc(entries,
+                                  sizeof(struct _ins_index_entry) * capacity);
+            }
+
+            entries[size].address = ins->address;
+            entries[size].node    = node->index;
+            entries[size].size    = ins->size;
+            entries[size].slot    = slot++;
+
+            if ((size > 0) && (ins_index_entry_cmp(&(entries[size - 1]),
+                                                   &(entries[size])) > 0))
+                sorted = 0;
+            size++;
+        }
+    }
+
+    if (! sorted)
+        qsort(entries, size, sizeof(struct _ins_index_entry), ins_index_entry_cmp);
+
+    uint64_t reach = 0;
+    size_t i;
+    for (i = 0; i < size; i++) {
+        if (entries[i].address + entries[i].size > reach)
+            reach = entries[i].address + entries[i].size;
+        entries[i].reach = reach;
+    }
+
+    struct _ins_index * index = malloc(sizeof(struct _ins_index));
+    index->object  = &ins_index_object;
+    index->refs    = 1;
+    index->size    = size;
+    index->entries = entries;
+
+    return index;
+}
+
+
+void ins_index_delete (struct _ins_index * index)
+{
+    if (! object_release(index))
+        return;
+
+    free(index->entries);
+    free(index);
+}
+
+
+// indexes never change, so copies are shared
+struct _ins_index * ins_index_copy (struct _ins_index * index)
+{
+    return object_share(index);
+}
+
+
+// the number of entries starting at or before address
+size_t ins_index_upper (struct _ins_index * index, uint64_t address)
+{
+    size_t lo = 0;
+    size_t hi = index->size;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->entries[mid].address <= address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+// the entry of the instruction covering address, or NULL. reach stops the
+// walk back at the first entry which nothing before it can carry past address,
+// so without overlapping instructions it looks at one entry
+struct _ins_index_entry * ins_index_cover (struct _ins_index * index,
+                                           uint64_t            address)
+{
+    size_t i = ins_index_upper(index, address);
+
+    while ((i > 0) && (index->entries[i - 1].reach > address)) {
+        struct _ins_index_entry * entry = &(index->entries[i - 1]);
+        if (entry->address + entry->size > address)
+            return entry;
+        i--;
+    }
+
+    return NULL;
+}
+
+
+int ins_index_find (struct _ins_index * index,
+                    uint64_t            address,
+                    uint64_t          * node,
+                    size_t            * slot)
+{
+    struct _ins_index_entry * entry = ins_index_cover(index, address);
+    if (entry == NULL)
+        return -1;
+
+    *node = entry->node;
+    *slot = entry->slot;
+
+    return 0;
+}
+
+
+// the instruction entry points to, checked against the address it was
+// indexed at
+struct _ins * ins_index_ins (struct _graph           * graph,
+                             struct _ins_index_entry * entry)
+{
+    struct _graph_node * node = graph_fetch_node(graph, entry->node);
+    if (node == NULL)
+        return NULL;
+
+    struct _list_it * it = list_iterator(node->data);
+    uint32_t slot;
+    for (slot = 0; (it != NULL) && (slot < entry->slot); slot++)
+        it = it->next;
+
+    if (it == NULL)
+        return NULL;
+
+    struct _ins * ins = it->data;
+    if (ins->address != entry->address)
+        return NULL;
+
+    return ins;
+}
+
+
+struct _ins * ins_index_fetch (struct _ins_index * index,
+                               struct _graph     * graph,
+                               uint64_t            address)
+{
+    size_t i = ins_index_upper(index, address);
+
+    if ((i == 0) || (index->entries[i - 1].address != address))
+        return NULL;
+
+    return ins_index_ins(graph, &(index->entries[i - 1]));
+}
+
+
+struct _ins * ins_index_covering (struct _ins_index * index,
+                                  struct _graph     * graph,
+                                  uint64_t            address)
+{
+    struct _ins_index_entry * entry = ins_index_cover(index, address);
+    if (entry == NULL)
+        return NULL;
+
+    return ins_index_ins(graph, entry);
+}
@@ -0,0 +1,63 @@
+#ifndef ins_index_HEADER
+#define ins_index_HEADER
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "graph.h"
+#include "instruction.h"
+#include "object.h"
+
+/*
+* An ins_index maps byte addresses to the instructions of a graph whose node
+* data are lists of instructions, like loader graphs. Each instruction is kept
+* as the index of its node and its position in the node's list, sorted by
+* address, so lookups are a binary search and a walk down one node's list.
+*
+* The index is a snapshot. Instructions may be changed or replaced in their
+* lists, but once nodes or the instructions in them are added or removed the
+* index must be built again. Indexes are reference counted and copies are
+* shared.
+*/
+
+struct _ins_index_entry {
+    uint64_t address;
+    // the furthest any instruction up to and including this one reaches
+    uint64_t reach;
+    uint64_t node;
+    uint32_t size;
+    uint32_t slot;
+};
+
+struct _ins_index {
+    const struct _object * object;
+    unsigned int refs;
+    size_t       size;
+    // sorted by address, and then by node
+    struct _ins_index_entry * entries;
+};
+
+
+struct _ins_index * ins_index_create (struct _graph * graph);
+void                ins_index_delete (struct _ins_index * index);
+struct _ins_index * ins_index_copy   (struct _ins_index * index);
+
+// returns 0 and sets node and slot to the instruction covering address, or
+// returns -1 if no instruction covers it. where instructions overlap, the one
+// starting last wins
+int ins_index_find (struct _ins_index * index,
+                    uint64_t            address,
+                    uint64_t          * node,
+                    size_t            * slot);
+
+// the instruction starting at address, or NULL
+struct _ins * ins_index_fetch    (struct _ins_index * index,
+                                  struct _graph     * graph,
+                                  uint64_t            address);
+
+// the instruction covering address, or NULL
+struct _ins * ins_index_covering (struct _ins_index * index,
+                                  struct _graph     * graph,
+                                  uint64_t            address);
+
+#endif
@@ -7,7 +7,8 @@ static const struct _object ins_object = {
     (void * (*) (void *))         ins_copy,
     (int    (*) (void *, void *)) ins_cmp,
     NULL,
-    (json_t * (*) (void *))       ins_serialize
+    (json_t * (*) (void *))       ins_serialize,
+    (void * (*) (void *))         ins_clone
 };
 
 static const struct _object ins_edge_object = {
@@ -15,7 +16,8 @@ static const struct _object ins_edge_object = {
     (void * (*) (void *))         ins_edge_copy,
     NULL,
     NULL,
-    (json_t * (*) (void *))       ins_edge_serialize
+    (json_t * (*) (void *))       ins_edge_serialize,
+    (void * (*) (void *))         ins_edge_clone
 };
 
 struct _ins * ins_create  (uint64_t address,
@@ -29,6 +31,7 @@ struct _ins * ins_create  (uint64_t address,
     ins = (struct _ins *) malloc(sizeof(struct _ins));
 
     ins->object  = &ins_object;
+    ins->refs    = 1;
     ins->address = address;
     ins->target  = -1;
 
@@ -57,6 +60,8 @@ struct _ins * ins_create  (uint64_t address,
 
 void ins_delete (struct _ins * ins)
 {
+    if (! object_release(ins))
+        return;
     free(ins->bytes);
     if (ins->description != NULL)
         free(ins->description);
@@ -69,6 +74,12 @@ void ins_delete (struct _ins * ins)
 
 
 struct _ins * ins_copy (struct _ins * ins)
+{
+    return object_share(ins);
+}
+
+
+struct _ins * ins_clone (struct _ins * ins)
 {
     struct _ins * new_ins = ins_create(ins->address,
                                        ins->bytes,
@@ -77,6 +88,7 @@ struct _ins * ins_copy (struct _ins * ins)
                                        ins->comment);
     new_ins->target     = ins->target;
     new_ins->flags      = ins->flags;
+    object_delete(new_ins->references);
     new_ins->references = object_copy(ins->references);
 
     return new_ins;
@@ -221,13 +233,20 @@ void ins_add_reference (struct _ins * ins, struct _reference * reference)
 }
 
 
+void ins_add_reference_take (struct _ins * ins, struct _reference * reference)
+{
+    list_append_take(ins->references, reference);
+}
+
+
 struct _ins_edge * ins_edge_create (int type)
 {
     struct _ins_edge * ins_edge;
     ins_edge = (struct _ins_edge *) malloc(sizeof(struct _ins_edge));
 
     ins_edge->object = &ins_edge_object;
-    ins_edge->type = type;
+    ins_edge->refs   = 1;
+    ins_edge->type   = type;
 
     return ins_edge;
 }
@@ -235,11 +254,19 @@ struct _ins_edge * ins_edge_create (int type)
 
 void ins_edge_delete (struct _ins_edge * ins_edge)
 {
+    if (! object_release(ins_edge))
+        return;
     free(ins_edge);
 }
 
 
 struct _ins_edge * ins_edge_copy (struct _ins_edge * ins_edge)
+{
+    return object_share(ins_edge);
+}
+
+
+struct _ins_edge * ins_edge_clone (struct _ins_edge * ins_edge)
 {
     return ins_edge_create(ins_edge->type);
 }
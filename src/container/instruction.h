@@ -24,8 +24,10 @@ enum {
     INS_EDGE_JCC_FALSE
 };
 
+// instructions and instruction edges are reference counted, see object.h
 struct _ins {
     const struct _object * object;
+    unsigned int   refs;
     uint64_t       address;
     uint64_t       target; // -1 == not set
     uint8_t *      bytes;
@@ -39,6 +41,7 @@ struct _ins {
 
 struct _ins_edge {
     const struct _object * object;
+    unsigned int refs;
     int type;
 };
 
@@ -51,6 +54,7 @@ struct _ins * ins_create    (uint64_t address,
 
 void          ins_delete      (struct _ins * ins);
 struct _ins * ins_copy        (struct _ins * ins);
+struct _ins * ins_clone       (struct _ins * ins);
 int           ins_cmp         (struct _ins * lhs, struct _ins * rhs);
 json_t *      ins_serialize   (struct _ins * ins);
 struct _ins * ins_deserialize (json_t * json);
@@ -60,11 +64,14 @@ void          ins_s_description (struct _ins * ins, const char * description);
 void          ins_s_target      (struct _ins * ins, uint64_t target);
 void          ins_s_call        (struct _ins * ins);
 void          ins_add_reference (struct _ins * ins, struct _reference * reference);
+// adopts reference instead of copying it
+void          ins_add_reference_take (struct _ins * ins, struct _reference * reference);
 
 
 struct _ins_edge * ins_edge_create      (int type);
 void               ins_edge_delete      (struct _ins_edge * ins_edge);
 struct _ins_edge * ins_edge_copy        (struct _ins_edge * ins_edge);
+struct _ins_edge * ins_edge_clone       (struct _ins_edge * ins_edge);
 json_t *           ins_edge_serialize   (struct _ins_edge * ins_edge);
 struct _ins_edge * ins_edge_deserialize (json_t * json);
 
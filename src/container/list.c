@@ -18,11 +18,21 @@ struct _list * list_create ()
     list->first = NULL; 
     list->last  = NULL;
     list->size = 0;
+    list->arena = NULL;
 
     return list;
 }
 
 
+struct _list * list_create_arena (struct _arena * arena)
+{
+    struct _list * list = list_create();
+    if (arena != NULL)
+        list->arena = object_share(arena);
+    return list;
+}
+
+
 void list_delete (struct _list * list)
 {
     struct _list_it * current;
@@ -35,11 +45,14 @@ void list_delete (struct _list * list)
 
         object_delete(current->data);
 
-        free(current);
+        arena_free(list->arena, current, sizeof(struct _list_it));
         
         current = next;
     }
 
+    if (list->arena != NULL)
+        object_delete(list->arena);
+
     free(list);
 }
 
@@ -78,8 +91,7 @@ struct _list * list_deserialize (json_t * json)
             object_delete(list);
             return NULL;
         }
-        list_append(list, data);
-        object_delete(data);
+        list_append_take(list, data);
     }
 
     return list;
@@ -87,11 +99,17 @@ struct _list * list_deserialize (json_t * json)
 
 
 void list_append (struct _list * list, void * data)
+{
+    list_append_take(list, object_copy(data));
+}
+
+
+void list_append_take (struct _list * list, void * data)
 {
     struct _list_it * list_it;
 
-    list_it = (struct _list_it *) malloc(sizeof(struct _list_it));
-    list_it->data = object_copy(data);
+    list_it = arena_alloc(list->arena, sizeof(struct _list_it));
+    list_it->data = data;
     list_it->next = NULL;
     list_it->prev = list->last;
 
@@ -162,7 +180,7 @@ struct _list_it * list_remove (struct _list * list, struct _list_it * iterator)
         list->last = iterator->prev;
     
     object_delete(iterator->data);
-    free(iterator);
+    arena_free(list->arena, iterator, sizeof(struct _list_it));
 
     list->size--;
 
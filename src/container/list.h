@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 
+#include "arena.h"
 #include "object.h"
 #include "serialize.h"
 
@@ -17,14 +18,21 @@ struct _list {
     struct _list_it * first;
     struct _list_it * last;
     size_t size;
+    // list links come from here, or malloc when NULL
+    struct _arena * arena;
 };
 
 struct _list * list_create      ();
+// a list whose links are allocated from arena. the list holds a reference to
+// the arena. a NULL arena is the same as malloc
+struct _list * list_create_arena (struct _arena * arena);
 void           list_delete      (struct _list * list);
 json_t *       list_serialize   (struct _list * list);
 struct _list * list_deserialize (json_t * json);
 
 void              list_append      (struct _list * list, void * data);
+// like list_append, but the list adopts data instead of copying it
+void              list_append_take (struct _list * list, void * data);
 void              list_append_list (struct _list * list, struct _list * rhs);
 struct _list_it * list_iterator    (struct _list * list);
 struct _list    * list_copy        (struct _list * list);
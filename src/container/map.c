@@ -4,9 +4,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
 
 static const struct _object map_object = {
-    (void   (*) (void *))         map_delete, 
+    (void   (*) (void *))         map_delete,
     (void * (*) (void *))         map_copy,
     NULL,
     NULL,
@@ -14,7 +16,7 @@ static const struct _object map_object = {
 };
 
 static const struct _object map_node_object = {
-    (void   (*) (void *))         map_node_delete, 
+    (void   (*) (void *))         map_node_delete,
     (void * (*) (void *))         map_node_copy,
     (int    (*) (void *, void *)) map_node_cmp,
     NULL,
@@ -22,92 +24,916 @@ static const struct _object map_node_object = {
 };
 
 
-int map_insert (struct _map * map, uint64_t key, void * value)
+#define MAP_LEAF(XX)   ((struct _map_leaf *)   XX)
+#define MAP_BRANCH(XX) ((struct _map_branch *) XX)
+
+
+/*
+* B+TREE NODES
+*/
+
+struct _map_bnode * map_bnode_create (int leaf)
 {
-    int result = 0;
+    struct _map_bnode * bnode;
+
+    if (leaf)
+        bnode = (struct _map_bnode *) malloc(sizeof(struct _map_leaf));
+    else
+        bnode = (struct _map_bnode *) malloc(sizeof(struct _map_branch));
 
-    struct _map_node * map_node = map_node_create(key, value);
+    bnode->size = 0;
+    bnode->leaf = leaf;
+    bnode->refs = 1;
+
+    return bnode;
+}
+
+
+// node references are updated atomically, snapshots are handed to other
+// threads
+struct _map_bnode * map_bnode_share (struct _map_bnode * bnode)
+{
+    __sync_add_and_fetch(&(bnode->refs), 1);
+    return bnode;
+}
 
-    if (tree_fetch(map->tree, map_node) == NULL) {
-        tree_insert(map->tree, map_node);
-        map->size++;
+
+// drops a reference to bnode. the last reference deletes it, everything
+// beneath it and all values it holds
+void map_bnode_delete (struct _map_bnode * bnode)
+{
+    unsigned int i;
+
+    if (__sync_sub_and_fetch(&(bnode->refs), 1) != 0)
+        return;
+
+    if (bnode->leaf) {
+        for (i = 0; i < bnode->size; i++) {
+            if (MAP_LEAF(bnode)->values[i] != NULL)
+                object_delete(MAP_LEAF(bnode)->values[i]);
+        }
     }
-    else
-        result = -1;
+    else {
+        for (i = 0; i <= bnode->size; i++)
+            map_bnode_delete(MAP_BRANCH(bnode)->children[i]);
+    }
+
+    free(bnode);
+}
 
-    object_delete(map_node);
 
-    return result;
+// copies bnode itself. the copy shares bnode's children, or holds copies of
+// its values, so bnode may be released without affecting the copy
+struct _map_bnode * map_bnode_clone (struct _map_bnode * bnode)
+{
+    struct _map_bnode * new_bnode = map_bnode_create(bnode->leaf);
+    unsigned int i;
+
+    new_bnode->size = bnode->size;
+    memcpy(new_bnode->keys, bnode->keys, sizeof(uint64_t) * bnode->size);
+
+    if (bnode->leaf) {
+        for (i = 0; i < bnode->size; i++) {
+            void * value = MAP_LEAF(bnode)->values[i];
+            if (value == NULL)
+                MAP_LEAF(new_bnode)->values[i] = NULL;
+            else
+                MAP_LEAF(new_bnode)->values[i] = object_copy(value);
+        }
+    }
+    else {
+        for (i = 0; i <= bnode->size; i++) {
+            MAP_BRANCH(new_bnode)->children[i] =
+                map_bnode_share(MAP_BRANCH(bnode)->children[i]);
+        }
+    }
+
+    return new_bnode;
 }
 
 
+// gives up a reference to bnode in exchange for a node which may be modified
+struct _map_bnode * map_bnode_own (struct _map_bnode * bnode)
+{
+    // acquire pairs with the release of the last other reference, after which
+    // no other thread reads bnode
+    if (__atomic_load_n(&(bnode->refs), __ATOMIC_ACQUIRE) == 1)
+        return bnode;
 
-void * map_fetch (struct _map * map, uint64_t key)
+    struct _map_bnode * clone = map_bnode_clone(bnode);
+    map_bnode_delete(bnode);
+
+    return clone;
+}
+
+
+// makes sure the child at index in parent may be modified and returns it
+static inline struct _map_bnode * map_bnode_own_child (struct _map_branch * parent,
+                                                       unsigned int index)
 {
-    struct _map_node * needle = map_node_create(key, NULL);
-    struct _map_node * map_node;
+    parent->children[index] = map_bnode_own(parent->children[index]);
+    return parent->children[index];
+}
 
-    map_node = tree_fetch(map->tree, needle);
 
-    object_delete(needle);
+struct _map_bnode * map_bnode_copy (struct _map_bnode * bnode)
+{
+    struct _map_bnode * new_bnode = map_bnode_create(bnode->leaf);
+    unsigned int i;
+
+    new_bnode->size = bnode->size;
+    memcpy(new_bnode->keys, bnode->keys, sizeof(uint64_t) * bnode->size);
+
+    if (bnode->leaf) {
+        for (i = 0; i < bnode->size; i++) {
+            void * value = MAP_LEAF(bnode)->values[i];
+            if (value == NULL)
+                MAP_LEAF(new_bnode)->values[i] = NULL;
+            else
+                MAP_LEAF(new_bnode)->values[i] = object_copy(value);
+        }
+    }
+    else {
+        for (i = 0; i <= bnode->size; i++) {
+            MAP_BRANCH(new_bnode)->children[i] =
+                map_bnode_copy(MAP_BRANCH(bnode)->children[i]);
+        }
+    }
+
+    return new_bnode;
+}
 
-    if (map_node == NULL)
+
+// builds a tree bottom up from size strictly ascending keys, adopting values
+// without copying them. nodes on each level get an even share of the entries
+// below them, which keeps every non-root node at least half full
+struct _map_bnode * map_bnode_build (uint64_t * keys, void ** values, size_t size)
+{
+    struct _map_bnode ** level;
+    uint64_t           * lows;
+    struct _map_bnode  * root;
+    size_t n, i, j, pos;
+
+    if (size == 0)
         return NULL;
+
+    n     = (size + MAP_BNODE_KEYS - 1) / MAP_BNODE_KEYS;
+    level = malloc(sizeof(struct _map_bnode *) * n);
+    lows  = malloc(sizeof(uint64_t) * n);
+
+    pos = 0;
+    for (i = 0; i < n; i++) {
+        struct _map_bnode * leaf = map_bnode_create(1);
+        leaf->size = size / n + (i < size % n ? 1 : 0);
+        memcpy(leaf->keys, &(keys[pos]), sizeof(uint64_t) * leaf->size);
+        memcpy(MAP_LEAF(leaf)->values, &(values[pos]), sizeof(void *) * leaf->size);
+        level[i] = leaf;
+        lows[i]  = keys[pos];
+        pos += leaf->size;
+    }
+
+    // each pass replaces the nodes of one level with their parents, in place
+    while (n > 1) {
+        size_t parents = (n + MAP_BNODE_KEYS) / (MAP_BNODE_KEYS + 1);
+
+        pos = 0;
+        for (i = 0; i < parents; i++) {
+            struct _map_bnode * branch = map_bnode_create(0);
+            size_t children = n / parents + (i < n % parents ? 1 : 0);
+            uint64_t low    = lows[pos];
+
+            branch->size = children - 1;
+            for (j = 0; j < children; j++) {
+                MAP_BRANCH(branch)->children[j] = level[pos + j];
+                if (j > 0)
+                    branch->keys[j - 1] = lows[pos + j];
+            }
+
+            level[i] = branch;
+            lows[i]  = low;
+            pos += children;
+        }
+
+        n = parents;
+    }
+
+    root = level[0];
+    free(level);
+    free(lows);
+
+    return root;
+}
+
+
+// returns the index of the first key in bnode greater than key. in a branch
+// this is the child to descend into, in a leaf key sits just before it
+static inline unsigned int map_bnode_upper (struct _map_bnode * bnode,
+                                            uint64_t key)
+{
+    unsigned int lo = 0;
+    unsigned int hi = bnode->size;
+
+    while (lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        if (bnode->keys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+// finds the leaf key should live in. returns the index of key in that leaf,
+// or -1 if key is not in the map
+int map_bnode_find (struct _map * map, uint64_t key, struct _map_leaf ** leaf)
+{
+    struct _map_bnode * bnode = map->root;
+
+    if (bnode == NULL)
+        return -1;
+
+    while (! bnode->leaf)
+        bnode = MAP_BRANCH(bnode)->children[map_bnode_upper(bnode, key)];
+
+    *leaf = MAP_LEAF(bnode);
+
+    unsigned int index = map_bnode_upper(bnode, key);
+    if ((index > 0) && (bnode->keys[index - 1] == key))
+        return index - 1;
+
+    return -1;
+}
+
+
+// splits the full child at index in parent into two nodes
+void map_bnode_split (struct _map_branch * parent, unsigned int index)
+{
+    struct _map_bnode * child = map_bnode_own_child(parent, index);
+    struct _map_bnode * right = map_bnode_create(child->leaf);
+    unsigned int half = MAP_BNODE_KEYS / 2;
+    uint64_t separator;
+
+    if (child->leaf) {
+        right->size = child->size - half;
+        memcpy(right->keys, &(child->keys[half]), sizeof(uint64_t) * right->size);
+        memcpy(MAP_LEAF(right)->values,
+               &(MAP_LEAF(child)->values[half]),
+               sizeof(void *) * right->size);
+        separator = right->keys[0];
+    }
+    else {
+        // the middle key moves up into the parent
+        separator   = child->keys[half];
+        right->size = child->size - half - 1;
+        memcpy(right->keys, &(child->keys[half + 1]), sizeof(uint64_t) * right->size);
+        memcpy(MAP_BRANCH(right)->children,
+               &(MAP_BRANCH(child)->children[half + 1]),
+               sizeof(struct _map_bnode *) * (right->size + 1));
+    }
+    child->size = half;
+
+    memmove(&(parent->bnode.keys[index + 1]),
+            &(parent->bnode.keys[index]),
+            sizeof(uint64_t) * (parent->bnode.size - index));
+    memmove(&(parent->children[index + 2]),
+            &(parent->children[index + 1]),
+            sizeof(struct _map_bnode *) * (parent->bnode.size - index));
+
+    parent->bnode.keys[index]  = separator;
+    parent->children[index + 1] = right;
+    parent->bnode.size++;
+}
+
+
+// merges the child at index + 1 in parent into the child at index
+void map_bnode_merge (struct _map_branch * parent, unsigned int index)
+{
+    struct _map_bnode * left  = map_bnode_own_child(parent, index);
+    struct _map_bnode * right = map_bnode_own_child(parent, index + 1);
+
+    if (left->leaf) {
+        memcpy(&(left->keys[left->size]), right->keys, sizeof(uint64_t) * right->size);
+        memcpy(&(MAP_LEAF(left)->values[left->size]),
+               MAP_LEAF(right)->values,
+               sizeof(void *) * right->size);
+        left->size += right->size;
+    }
+    else {
+        left->keys[left->size] = parent->bnode.keys[index];
+        memcpy(&(left->keys[left->size + 1]),
+               right->keys,
+               sizeof(uint64_t) * right->size);
+        memcpy(&(MAP_BRANCH(left)->children[left->size + 1]),
+               MAP_BRANCH(right)->children,
+               sizeof(struct _map_bnode *) * (right->size + 1));
+        left->size += right->size + 1;
+    }
+
+    free(right);
+
+    memmove(&(parent->bnode.keys[index]),
+            &(parent->bnode.keys[index + 1]),
+            sizeof(uint64_t) * (parent->bnode.size - index - 1));
+    memmove(&(parent->children[index + 1]),
+            &(parent->children[index + 2]),
+            sizeof(struct _map_bnode *) * (parent->bnode.size - index - 1));
+    parent->bnode.size--;
+}
+
+
+// moves the last entry of the child at index - 1 to the front of the child
+// at index
+void map_bnode_borrow_left (struct _map_branch * parent, unsigned int index)
+{
+    struct _map_bnode * child = map_bnode_own_child(parent, index);
+    struct _map_bnode * left  = map_bnode_own_child(parent, index - 1);
+
+    memmove(&(child->keys[1]), child->keys, sizeof(uint64_t) * child->size);
+
+    if (child->leaf) {
+        memmove(&(MAP_LEAF(child)->values[1]),
+                MAP_LEAF(child)->values,
+                sizeof(void *) * child->size);
+        child->keys[0] = left->keys[left->size - 1];
+        MAP_LEAF(child)->values[0] = MAP_LEAF(left)->values[left->size - 1];
+        parent->bnode.keys[index - 1] = child->keys[0];
+    }
+    else {
+        memmove(&(MAP_BRANCH(child)->children[1]),
+                MAP_BRANCH(child)->children,
+                sizeof(struct _map_bnode *) * (child->size + 1));
+        child->keys[0] = parent->bnode.keys[index - 1];
+        MAP_BRANCH(child)->children[0] = MAP_BRANCH(left)->children[left->size];
+        parent->bnode.keys[index - 1] = left->keys[left->size - 1];
+    }
+
+    left->size--;
+    child->size++;
+}
+
+
+// moves the first entry of the child at index + 1 to the end of the child at
+// index
+void map_bnode_borrow_right (struct _map_branch * parent, unsigned int index)
+{
+    struct _map_bnode * child = map_bnode_own_child(parent, index);
+    struct _map_bnode * right = map_bnode_own_child(parent, index + 1);
+
+    if (child->leaf) {
+        child->keys[child->size] = right->keys[0];
+        MAP_LEAF(child)->values[child->size] = MAP_LEAF(right)->values[0];
+        memmove(MAP_LEAF(right)->values,
+                &(MAP_LEAF(right)->values[1]),
+                sizeof(void *) * (right->size - 1));
+        memmove(right->keys, &(right->keys[1]), sizeof(uint64_t) * (right->size - 1));
+        parent->bnode.keys[index] = right->keys[0];
+    }
+    else {
+        child->keys[child->size] = parent->bnode.keys[index];
+        MAP_BRANCH(child)->children[child->size + 1] = MAP_BRANCH(right)->children[0];
+        parent->bnode.keys[index] = right->keys[0];
+        memmove(right->keys, &(right->keys[1]), sizeof(uint64_t) * (right->size - 1));
+        memmove(MAP_BRANCH(right)->children,
+                &(MAP_BRANCH(right)->children[1]),
+                sizeof(struct _map_bnode *) * right->size);
+    }
+
+    right->size--;
+    child->size++;
+}
+
+
+// makes sure the child at index has more than MAP_BNODE_MIN keys so a key can
+// be removed beneath it. returns the index of the child now covering the
+// range the original child covered
+unsigned int map_bnode_fill (struct _map_branch * parent, unsigned int index)
+{
+    if ((index > 0) && (parent->children[index - 1]->size > MAP_BNODE_MIN)) {
+        map_bnode_borrow_left(parent, index);
+        return index;
+    }
+    if (    (index < parent->bnode.size)
+         && (parent->children[index + 1]->size > MAP_BNODE_MIN)) {
+        map_bnode_borrow_right(parent, index);
+        return index;
+    }
+    if (index > 0) {
+        map_bnode_merge(parent, index - 1);
+        return index - 1;
+    }
+    map_bnode_merge(parent, index);
+    return index;
+}
+
+
+// adds key to the map, taking ownership of value. key must not exist
+void map_bnode_insert (struct _map * map, uint64_t key, void * value)
+{
+    struct _map_bnode * bnode;
+    unsigned int index;
+
+    if (map->root == NULL)
+        map->root = map_bnode_create(1);
     else
-        return map_node->value;
+        map->root = map_bnode_own(map->root);
+
+    // split on the way down so there is always room for a separator. every
+    // node we pass through is copied first if a snapshot shares it
+    if (map->root->size == MAP_BNODE_KEYS) {
+        struct _map_bnode * root = map_bnode_create(0);
+        MAP_BRANCH(root)->children[0] = map->root;
+        map_bnode_split(MAP_BRANCH(root), 0);
+        map->root = root;
+    }
+
+    bnode = map->root;
+    while (! bnode->leaf) {
+        index = map_bnode_upper(bnode, key);
+        if (MAP_BRANCH(bnode)->children[index]->size == MAP_BNODE_KEYS) {
+            map_bnode_split(MAP_BRANCH(bnode), index);
+            if (key >= bnode->keys[index])
+                index++;
+        }
+        bnode = map_bnode_own_child(MAP_BRANCH(bnode), index);
+    }
+
+    index = map_bnode_upper(bnode, key);
+    memmove(&(bnode->keys[index + 1]),
+            &(bnode->keys[index]),
+            sizeof(uint64_t) * (bnode->size - index));
+    memmove(&(MAP_LEAF(bnode)->values[index + 1]),
+            &(MAP_LEAF(bnode)->values[index]),
+            sizeof(void *) * (bnode->size - index));
+    bnode->keys[index] = key;
+    MAP_LEAF(bnode)->values[index] = value;
+    bnode->size++;
+
+    map->size++;
 }
 
 
+/*
+* FROZEN MAPS
+*/
 
-void * map_fetch_max (struct _map * map, uint64_t key)
+struct _map_flat * map_flat_create (size_t size)
 {
-    struct _map_node * needle = map_node_create(key, NULL);
-    struct _map_node * map_node;
+    struct _map_flat * flat;
+
+    flat = (struct _map_flat *) malloc(sizeof(struct _map_flat));
+    flat->refs   = 1;
+    flat->size   = size;
+    flat->keys   = malloc(sizeof(uint64_t) * size);
+    flat->values = malloc(sizeof(void *) * size);
+
+    return flat;
+}
+
+
+// drops a reference to flat. the last reference deletes it and its values
+void map_flat_delete (struct _map_flat * flat)
+{
+    size_t i;
+
+    if (__sync_sub_and_fetch(&(flat->refs), 1) != 0)
+        return;
+
+    for (i = 0; i < flat->size; i++) {
+        if (flat->values[i] != NULL)
+            object_delete(flat->values[i]);
+    }
+
+    free(flat->keys);
+    free(flat->values);
+    free(flat);
+}
+
+
+// returns the index of the first key in flat greater than key
+size_t map_flat_upper (struct _map_flat * flat, uint64_t key)
+{
+    size_t lo = 0;
+    size_t hi = flat->size;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (flat->keys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+// returns the index of key in flat, or -1 if key is not there
+ssize_t map_flat_find (struct _map_flat * flat, uint64_t key)
+{
+    size_t index = map_flat_upper(flat, key);
+
+    if ((index > 0) && (flat->keys[index - 1] == key))
+        return index - 1;
+
+    return -1;
+}
+
+
+// positions map_it on the first key greater than key, which may be one past
+// the end of a leaf. returns -1 if the map is empty
+int map_it_seek (struct _map * map, struct _map_it * map_it, uint64_t key)
+{
+    struct _map_bnode * bnode = map->root;
+
+    if (map->flat != NULL) {
+        map_it->flat       = map->flat;
+        map_it->flat_index = map_flat_upper(map->flat, key);
+        return 0;
+    }
+
+    map_it->flat = NULL;
+
+    if (bnode == NULL)
+        return -1;
+
+    map_it->depth = 0;
+    while (1) {
+        map_it->path[map_it->depth].bnode = bnode;
+        map_it->path[map_it->depth].index = map_bnode_upper(bnode, key);
+        if (bnode->leaf)
+            break;
+        bnode = MAP_BRANCH(bnode)->children[map_it->path[map_it->depth].index];
+        map_it->depth++;
+    }
+
+    return 0;
+}
+
+
+// descends from the branch at map_it->depth, always taking the first
+// (leftmost) or last (rightmost) child
+void map_it_descend (struct _map_it * map_it, int rightmost)
+{
+    struct _map_bnode * bnode = map_it->path[map_it->depth].bnode;
+
+    while (! bnode->leaf) {
+        bnode = MAP_BRANCH(bnode)->children[map_it->path[map_it->depth].index];
+        map_it->depth++;
+        map_it->path[map_it->depth].bnode = bnode;
+        if (rightmost)
+            map_it->path[map_it->depth].index = bnode->leaf ? bnode->size - 1
+                                                            : bnode->size;
+        else
+            map_it->path[map_it->depth].index = 0;
+    }
+}
+
+
+// positions map_it on the first key in the map. returns -1 if the map is empty
+int map_it_first (struct _map * map, struct _map_it * map_it)
+{
+    if (map->flat != NULL) {
+        map_it->flat       = map->flat;
+        map_it->flat_index = 0;
+        return 0;
+    }
+
+    map_it->flat = NULL;
+
+    if (map->root == NULL)
+        return -1;
+
+    map_it->depth = 0;
+    map_it->path[0].bnode = map->root;
+    map_it->path[0].index = 0;
+    map_it_descend(map_it, 0);
+
+    return 0;
+}
+
+
+// moves map_it to the previous key. returns -1 if there is no previous key
+int map_it_prev (struct _map_it * map_it)
+{
+    if (map_it->flat != NULL) {
+        if (map_it->flat_index == 0)
+            return -1;
+        map_it->flat_index--;
+        return 0;
+    }
+
+    if (map_it->path[map_it->depth].index > 0) {
+        map_it->path[map_it->depth].index--;
+        return 0;
+    }
+
+    while (map_it->depth > 0) {
+        map_it->depth--;
+        if (map_it->path[map_it->depth].index > 0) {
+            map_it->path[map_it->depth].index--;
+            map_it_descend(map_it, 1);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+// if map_it sits one past the end of a leaf, moves it to the first key of the
+// next leaf. returns -1 if there is no next key
+int map_it_settle (struct _map_it * map_it)
+{
+    if (map_it->flat != NULL)
+        return map_it->flat_index < map_it->flat->size ? 0 : -1;
+
+    if (map_it->path[map_it->depth].index < map_it->path[map_it->depth].bnode->size)
+        return 0;
+
+    // climb until we find a branch with children left to visit
+    while (map_it->depth > 0) {
+        map_it->depth--;
+        map_it->path[map_it->depth].index++;
+        if (map_it->path[map_it->depth].index <= map_it->path[map_it->depth].bnode->size) {
+            map_it_descend(map_it, 0);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+// moves the entries beneath bnode into flat from pos on, and drops a
+// reference to bnode. values are adopted from nodes which only this map holds,
+// and copied from nodes which a snapshot also holds. copy is set while below
+// such a node. returns the position after the last entry moved
+size_t map_bnode_flatten (struct _map_bnode * bnode,
+                          struct _map_flat  * flat,
+                          size_t              pos,
+                          int                 copy)
+{
+    int shared = copy || (__atomic_load_n(&(bnode->refs), __ATOMIC_ACQUIRE) > 1);
+    unsigned int i;
+
+    if (bnode->leaf) {
+        memcpy(&(flat->keys[pos]), bnode->keys, sizeof(uint64_t) * bnode->size);
+        for (i = 0; i < bnode->size; i++) {
+            void * value = MAP_LEAF(bnode)->values[i];
+            if ((shared) && (value != NULL))
+                value = object_copy(value);
+            flat->values[pos++] = value;
+        }
+    }
+    else {
+        for (i = 0; i <= bnode->size; i++)
+            pos = map_bnode_flatten(MAP_BRANCH(bnode)->children[i], flat, pos, shared);
+    }
+
+    // nodes beneath a shared node belong to it
+    if (! copy) {
+        if (shared)
+            map_bnode_delete(bnode);
+        else
+            free(bnode);
+    }
+
+    return pos;
+}
+
+
+void map_freeze (struct _map * map)
+{
+    if ((map->flat != NULL) || (map->root == NULL))
+        return;
+
+    map->flat = map_flat_create(map->size);
+    map_bnode_flatten(map->root, map->flat, 0, 0);
+    map->root = NULL;
+}
+
+
+void map_thaw (struct _map * map)
+{
+    struct _map_flat * flat = map->flat;
+    size_t i;
+
+    if (flat == NULL)
+        return;
+
+    map->flat = NULL;
+
+    if (__atomic_load_n(&(flat->refs), __ATOMIC_ACQUIRE) == 1) {
+        map->root = map_bnode_build(flat->keys, flat->values, flat->size);
+        flat->size = 0;
+        map_flat_delete(flat);
+        return;
+    }
+
+    // a snapshot still holds these entries, so build from copies of them
+    void ** copies = malloc(sizeof(void *) * (flat->size + 1));
+    for (i = 0; i < flat->size; i++) {
+        if (flat->values[i] == NULL)
+            copies[i] = NULL;
+        else
+            copies[i] = object_copy(flat->values[i]);
+    }
+
+    map->root = map_bnode_build(flat->keys, copies, flat->size);
+
+    free(copies);
+    map_flat_delete(flat);
+}
+
+
+
+int map_insert_take (struct _map * map, uint64_t key, void * value)
+{
+    struct _map_leaf * leaf;
+
+    map_thaw(map);
+
+    if (map_bnode_find(map, key, &leaf) != -1) {
+        if (value != NULL)
+            object_delete(value);
+        return -1;
+    }
+
+    map_bnode_insert(map, key, value);
+
+    return 0;
+}
+
+
+
+int map_insert (struct _map * map, uint64_t key, void * value)
+{
+    struct _map_leaf * leaf;
+
+    map_thaw(map);
+
+    if (map_bnode_find(map, key, &leaf) != -1)
+        return -1;
+
+    if (value != NULL)
+        value = object_copy(value);
 
-    map_node = tree_fetch_max(map->tree, needle);
+    map_bnode_insert(map, key, value);
+
+    return 0;
+}
 
-    object_delete(needle);
 
-    if (map_node == NULL)
+
+void * map_fetch (struct _map * map, uint64_t key)
+{
+    if (map->flat != NULL) {
+        ssize_t index = map_flat_find(map->flat, key);
+        return index == -1 ? NULL : map->flat->values[index];
+    }
+
+    struct _map_leaf * leaf;
+    int index = map_bnode_find(map, key, &leaf);
+
+    if (index == -1)
         return NULL;
     else
-        return map_node->value;
+        return leaf->values[index];
 }
 
 
 
-uint64_t map_fetch_max_key (struct _map * map, uint64_t key)
+void * map_fetch_own (struct _map * map, uint64_t key)
 {
-    struct _map_node * needle = map_node_create(key, NULL);
-    struct _map_node * map_node;
+    // swapping a value for its own copy leaves the keys alone, so frozen maps
+    // stay frozen unless a snapshot shares their entries
+    if (    (map->flat != NULL)
+         && (__atomic_load_n(&(map->flat->refs), __ATOMIC_ACQUIRE) > 1))
+        map_thaw(map);
+
+    if (map->flat != NULL) {
+        ssize_t index = map_flat_find(map->flat, key);
+        if ((index == -1) || (map->flat->values[index] == NULL))
+            return NULL;
+        map->flat->values[index] = object_own(map->flat->values[index]);
+        return map->flat->values[index];
+    }
 
-    map_node = tree_fetch_max(map->tree, needle);
+    struct _map_leaf * leaf;
+    int index = map_bnode_find(map, key, &leaf);
 
-    object_delete(needle);
+    if ((index == -1) || (leaf->values[index] == NULL))
+        return NULL;
+
+    // copy every node down to the leaf which a snapshot shares
+    struct _map_bnode * bnode = map->root = map_bnode_own(map->root);
+    while (! bnode->leaf)
+        bnode = map_bnode_own_child(MAP_BRANCH(bnode), map_bnode_upper(bnode, key));
+    leaf = MAP_LEAF(bnode);
+
+    leaf->values[index] = object_own(leaf->values[index]);
+
+    return leaf->values[index];
+}
 
-    if (map_node == NULL)
+
+
+void * map_fetch_max (struct _map * map, uint64_t key)
+{
+    struct _map_it map_it;
+
+    if (map_it_seek(map, &map_it, key))
+        return NULL;
+    if (map_it_prev(&map_it))
+        return NULL;
+
+    return map_it_data(&map_it);
+}
+
+
+
+uint64_t map_fetch_max_key (struct _map * map, uint64_t key)
+{
+    struct _map_it map_it;
+
+    if (map_it_seek(map, &map_it, key))
         return -1;
-    else
-        return map_node->key;
+    if (map_it_prev(&map_it))
+        return -1;
+
+    return map_it_key(&map_it);
+}
+
+
+
+void * map_fetch_max_entry (struct _map * map, uint64_t key, uint64_t * max_key)
+{
+    struct _map_it map_it;
+
+    if (map_it_seek(map, &map_it, key))
+        return NULL;
+    if (map_it_prev(&map_it))
+        return NULL;
+
+    *max_key = map_it_key(&map_it);
+    return map_it_data(&map_it);
 }
 
 
 
 int map_remove (struct _map * map, uint64_t key)
 {
-    int result = 0;
+    struct _map_leaf  * leaf;
+    struct _map_bnode * bnode;
 
-    struct _map_node * needle = map_node_create(key, NULL);
+    map_thaw(map);
 
-    if (tree_fetch(map->tree, needle) == NULL)
-        result = -1;
-    else {
-        tree_remove(map->tree, needle);
-        map->size--;
+    if (map_bnode_find(map, key, &leaf) == -1)
+        return -1;
+
+    // fill children on the way down so removing from the leaf can never leave
+    // it, or any of its parents, underfull. every node we pass through is
+    // copied first if a snapshot shares it
+    map->root = map_bnode_own(map->root);
+    bnode = map->root;
+    while (! bnode->leaf) {
+        unsigned int index = map_bnode_upper(bnode, key);
+        if (MAP_BRANCH(bnode)->children[index]->size <= MAP_BNODE_MIN)
+            index = map_bnode_fill(MAP_BRANCH(bnode), index);
+
+        // the root lost its last separator to a merge
+        if ((bnode == map->root) && (bnode->size == 0)) {
+            map->root = MAP_BRANCH(bnode)->children[0];
+            free(bnode);
+            bnode = map->root;
+            continue;
+        }
+
+        bnode = map_bnode_own_child(MAP_BRANCH(bnode), index);
+    }
+
+    unsigned int index = map_bnode_upper(bnode, key) - 1;
+    if (MAP_LEAF(bnode)->values[index] != NULL)
+        object_delete(MAP_LEAF(bnode)->values[index]);
+
+    memmove(&(bnode->keys[index]),
+            &(bnode->keys[index + 1]),
+            sizeof(uint64_t) * (bnode->size - index - 1));
+    memmove(&(MAP_LEAF(bnode)->values[index]),
+            &(MAP_LEAF(bnode)->values[index + 1]),
+            sizeof(void *) * (bnode->size - index - 1));
+    bnode->size--;
+
+    if ((bnode == map->root) && (bnode->size == 0)) {
+        free(bnode);
+        map->root = NULL;
     }
 
-    object_delete(needle);
-    return result;
+    map->size--;
+
+    return 0;
 }
 
 
@@ -118,8 +944,9 @@ struct _map * map_create ()
 
     map = (struct _map *) malloc(sizeof(struct _map));
     map->object = &map_object;
-    map->tree = tree_create();
-    map->size = 0;
+    map->root   = NULL;
+    map->size   = 0;
+    map->flat   = NULL;
 
     return map;
 }
@@ -127,17 +954,37 @@ struct _map * map_create ()
 
 void map_delete (struct _map * map)
 {
-    object_delete(map->tree);
+    if (map->root != NULL)
+        map_bnode_delete(map->root);
+
+    if (map->flat != NULL)
+        map_flat_delete(map->flat);
+
     free(map);
 }
 
 
 json_t * map_serialize (struct _map * map)
 {
-    json_t * json = json_object();
+    json_t * json  = json_object();
+    json_t * tree  = json_object();
+    json_t * nodes = json_array();
+
+    // maps used to be trees of map_nodes, and are still serialized that way
+    struct _map_it * it;
+    for (it = map_iterator(map); it != NULL; it = map_it_next(it)) {
+        struct _map_node map_node;
+        map_node.object = &map_node_object;
+        map_node.key    = map_it_key(it);
+        map_node.value  = map_it_data(it);
+        json_array_append(nodes, map_node_serialize(&map_node));
+    }
+
+    json_object_set(tree, "ot",    json_integer(SERIALIZE_TREE));
+    json_object_set(tree, "nodes", nodes);
 
     json_object_set(json, "ot",   json_integer(SERIALIZE_MAP));
-    json_object_set(json, "tree", object_serialize(map->tree));
+    json_object_set(json, "tree", tree);
 
     return json;
 }
@@ -151,24 +998,85 @@ struct _map * map_deserialize (json_t * json)
         return NULL;
     }
 
-    // this is called _cheating_
     json_t * tree_nodes = json_object_get(tree, "nodes");
     if (! json_is_array(tree_nodes)) {
         serialize_error = SERIALIZE_MAP;
         return NULL;
     }
 
+    struct _map * map = map_create();
+
     size_t size = json_array_size(tree_nodes);
+    uint64_t * keys   = malloc(sizeof(uint64_t) * (size + 1));
+    void    ** values = malloc(sizeof(void *) * (size + 1));
+    int sorted = 1;
+
+    // the map takes the deserialized values as is
+    size_t i;
+    for (i = 0; i < size; i++) {
+        struct _map_node * map_node = deserialize(json_array_get(tree_nodes, i));
+        if (map_node == NULL) {
+            serialize_error = SERIALIZE_MAP;
+            while (i-- > 0) {
+                if (values[i] != NULL)
+                    object_delete(values[i]);
+            }
+            free(keys);
+            free(values);
+            map_delete(map);
+            return NULL;
+        }
+
+        keys[i]         = map_node->key;
+        values[i]       = map_node->value;
+        map_node->value = NULL;
+        object_delete(map_node);
 
-    struct _map * map = (struct _map *) malloc(sizeof(struct _map));
-    map->object = &map_object;
-    map->size   = size;
-    map->tree   = deserialize(tree);
-    if (map->tree == NULL) {
-        free(map);
-        return NULL;
+        if ((i > 0) && (keys[i - 1] >= keys[i]))
+            sorted = 0;
     }
 
+    // maps are serialized in order, so this should always be true
+    if (sorted) {
+        map->root = map_bnode_build(keys, values, size);
+        map->size = size;
+    }
+    else {
+        for (i = 0; i < size; i++)
+            map_insert_take(map, keys[i], values[i]);
+    }
+
+    free(keys);
+    free(values);
+
+    return map;
+}
+
+
+struct _map * map_create_sorted (uint64_t * keys, void ** values, size_t size)
+{
+    struct _map * map;
+    size_t i;
+
+    for (i = 1; i < size; i++) {
+        if (keys[i - 1] >= keys[i])
+            return NULL;
+    }
+
+    void ** copies = malloc(sizeof(void *) * (size + 1));
+    for (i = 0; i < size; i++) {
+        if (values[i] == NULL)
+            copies[i] = NULL;
+        else
+            copies[i] = object_copy(values[i]);
+    }
+
+    map = map_create();
+    map->root = map_bnode_build(keys, copies, size);
+    map->size = size;
+
+    free(copies);
+
     return map;
 }
 
@@ -176,8 +1084,38 @@ struct _map * map_deserialize (json_t * json)
 struct _map * map_copy (struct _map * map)
 {
     struct _map * new_map = map_create();
-    object_delete(new_map->tree);
-    new_map->tree = object_copy(map->tree);
+
+    if (map->root != NULL)
+        new_map->root = map_bnode_copy(map->root);
+    new_map->size = map->size;
+
+    // copies of frozen maps are frozen as well
+    if (map->flat != NULL) {
+        size_t i;
+        new_map->flat = map_flat_create(map->size);
+        memcpy(new_map->flat->keys, map->flat->keys, sizeof(uint64_t) * map->size);
+        for (i = 0; i < map->size; i++) {
+            if (map->flat->values[i] == NULL)
+                new_map->flat->values[i] = NULL;
+            else
+                new_map->flat->values[i] = object_copy(map->flat->values[i]);
+        }
+    }
+
+    return new_map;
+}
+
+
+struct _map * map_snapshot (struct _map * map)
+{
+    struct _map * new_map = map_create();
+
+    if (map->root != NULL)
+        new_map->root = map_bnode_share(map->root);
+    if (map->flat != NULL) {
+        __sync_add_and_fetch(&(map->flat->refs), 1);
+        new_map->flat = map->flat;
+    }
     new_map->size = map->size;
 
     return new_map;
@@ -260,6 +1198,7 @@ struct _map_node * map_node_deserialize (json_t * json)
 
     struct _map_node * map_node;
     map_node = map_node_create(json_uint64_t_value(key), value_object);
+    object_delete(value_object);
 
     return map_node;
 }
@@ -269,14 +1208,13 @@ struct _map_it * map_iterator (struct _map * map)
 {
     struct _map_it * map_it;
 
+    if ((map->root == NULL) && (map->flat == NULL))
+        return NULL;
+
     map_it = (struct _map_it *) malloc(sizeof(struct _map_it));
 
-    map_it->it = tree_iterator(map->tree);
-
-    if (map_it->it == NULL) {
-        free(map_it);
-        return NULL;
-    }
+    map_it->hi = UINT64_MAX;
+    map_it_first(map, map_it);
 
     return map_it;
 }
@@ -284,9 +1222,12 @@ struct _map_it * map_iterator (struct _map * map)
 
 struct _map_it * map_it_next (struct _map_it * map_it)
 {
-    map_it->it = tree_it_next(map_it->it);
+    if (map_it->flat != NULL)
+        map_it->flat_index++;
+    else
+        map_it->path[map_it->depth].index++;
 
-    if (map_it->it == NULL) {
+    if ((map_it_settle(map_it)) || (map_it_key(map_it) > map_it->hi)) {
         free(map_it);
         return NULL;
     }
@@ -297,28 +1238,73 @@ struct _map_it * map_it_next (struct _map_it * map_it)
 
 void * map_it_data (struct _map_it * map_it)
 {
-    struct _map_node * map_node = tree_it_data(map_it->it);
+    if (map_it->flat != NULL)
+        return map_it->flat->values[map_it->flat_index];
 
-    if (map_node == NULL)
-        return NULL;
+    struct _map_bnode * leaf = map_it->path[map_it->depth].bnode;
 
-    return map_node->value;
+    return MAP_LEAF(leaf)->values[map_it->path[map_it->depth].index];
 }
 
 
 uint64_t map_it_key (struct _map_it * map_it)
 {
-    struct _map_node * map_node = tree_it_data(map_it->it);
+    if (map_it->flat != NULL)
+        return map_it->flat->keys[map_it->flat_index];
 
-    if (map_node == NULL)
-        return -1;
+    struct _map_bnode * leaf = map_it->path[map_it->depth].bnode;
 
-    return map_node->key;
+    return leaf->keys[map_it->path[map_it->depth].index];
 }
 
 
 void map_it_delete (struct _map_it * map_it)
 {
-    tree_it_delete(map_it->it);
     free(map_it);
-}
\ No newline at end of file
+}
+
+
+struct _map_it * map_upper_bound (struct _map * map, uint64_t key)
+{
+    if (key == UINT64_MAX)
+        return NULL;
+    return map_range(map, key + 1, UINT64_MAX);
+}
+
+
+struct _map_it * map_lower_bound (struct _map * map, uint64_t key)
+{
+    return map_range(map, key, UINT64_MAX);
+}
+
+
+struct _map_it * map_range (struct _map * map, uint64_t lo, uint64_t hi)
+{
+    struct _map_it * map_it;
+
+    if (lo > hi)
+        return NULL;
+
+    map_it = (struct _map_it *) malloc(sizeof(struct _map_it));
+    map_it->hi = hi;
+
+    // seek past every key < lo, then step forward if we land past a leaf
+    if (lo == 0) {
+        if (map_it_first(map, map_it)) {
+            free(map_it);
+            return NULL;
+        }
+    }
+    else if (    (map_it_seek(map, map_it, lo - 1))
+              || (map_it_settle(map_it))) {
+        free(map_it);
+        return NULL;
+    }
+
+    if (map_it_key(map_it) > hi) {
+        free(map_it);
+        return NULL;
+    }
+
+    return map_it;
+}
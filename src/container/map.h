@@ -6,8 +6,56 @@
 #include <inttypes.h>
 
 #include "object.h"
-#include "tree.h"
 
+/*
+* maps are B+trees keyed directly on uint64_t. keys are kept inline in wide
+* nodes so a lookup touches a handful of cache lines instead of chasing one
+* small allocation (and one object_cmp call) per level.
+*
+* every node holds at most MAP_BNODE_KEYS keys. leaves hold one value per key,
+* branches hold one more child than they have keys. keys[i] in a branch is the
+* smallest key found under children[i + 1].
+*
+* tables which are read far more often than they are written can be frozen
+* with map_freeze. a frozen map keeps its keys and values in two flat sorted
+* arrays, which are binary searched and walked front to back. the first write
+* to a frozen map thaws it back into a B+tree in linear time, so callers never
+* need to know which form a map is in. values may still be modified in place
+* while a map is frozen.
+*
+* map_snapshot returns a second version of a map in constant time. the two
+* share their nodes, or their flat arrays when frozen, and shared nodes are
+* never modified. a write to either version first copies the O(log n) nodes on
+* the path to the key it changes. a value held by a shared leaf belongs to
+* every version holding the leaf, so a value which may have been snapshotted
+* must be modified through map_fetch_own, never through map_fetch.
+*/
+
+#define MAP_BNODE_KEYS 32
+#define MAP_BNODE_MIN  (MAP_BNODE_KEYS / 2 - 1)
+
+// deep enough for MAP_BNODE_MIN ^ MAP_MAX_HEIGHT keys
+#define MAP_MAX_HEIGHT 16
+
+struct _map_bnode {
+    unsigned int size;
+    unsigned int leaf;
+    // number of maps and parent branches holding this node
+    unsigned int refs;
+    uint64_t     keys[MAP_BNODE_KEYS];
+};
+
+struct _map_leaf {
+    struct _map_bnode   bnode;
+    void              * values[MAP_BNODE_KEYS];
+};
+
+struct _map_branch {
+    struct _map_bnode   bnode;
+    struct _map_bnode * children[MAP_BNODE_KEYS + 1];
+};
+
+// map_node is only used to (de)serialize maps
 struct _map_node {
     const struct _object * object;
     uint64_t key;
@@ -15,32 +63,77 @@ struct _map_node {
 };
 
 
+// the entries of a frozen map, shared by snapshots of that map
+struct _map_flat {
+    unsigned int refs;
+    size_t       size;
+    uint64_t   * keys;
+    void      ** values;
+};
+
+
 struct _map {
     const struct _object * object;
     size_t size;
-    struct _tree * tree;
+    struct _map_bnode * root;
+    // when frozen, root is NULL and the entries live here instead
+    struct _map_flat  * flat;
 };
 
 
+// iterators stop after the last key <= hi. map_iterator sets hi to
+// UINT64_MAX, map_range sets it to the top of the window
 struct _map_it {
-    struct _tree_it * it;
+    uint64_t hi;
+    // frozen maps are walked by position instead of by path
+    struct _map_flat * flat;
+    size_t             flat_index;
+    int depth;
+    struct {
+        struct _map_bnode * bnode;
+        unsigned int        index;
+    } path[MAP_MAX_HEIGHT];
 };
 
 
 // returns 0 on success, -1 on error (key already exists)
 int      map_insert        (struct _map *, uint64_t key, void * value);
+// like map_insert, but the map adopts value instead of copying it. if key
+// already exists value is deleted and -1 is returned
+int      map_insert_take   (struct _map *, uint64_t key, void * value);
 void *   map_fetch         (struct _map *, uint64_t key);
 void *   map_fetch_max     (struct _map *, uint64_t key);
 uint64_t map_fetch_max_key (struct _map *, uint64_t key);
 int      map_remove        (struct _map *, uint64_t key);
 
+// fetches the value for key so it may be modified. the value is first swapped
+// for a private copy if it is reference counted and shared, or if this map
+// shares the leaf holding it with a snapshot
+void *   map_fetch_own     (struct _map *, uint64_t key);
+
+// fetches the value with the greatest key <= key and stores that key in
+// *max_key with one descent. returns NULL if there is no such key
+void *   map_fetch_max_entry (struct _map *, uint64_t key, uint64_t * max_key);
+
 
 struct _map * map_create      ();
 void          map_delete      (struct _map *);
 struct _map * map_copy        (struct _map *);
+// a constant time copy which shares structure with map. see above
+struct _map * map_snapshot    (struct _map *);
 json_t      * map_serialize   (struct _map *);
 struct _map * map_deserialize (json_t * json);
 
+// builds a map in linear time from size keys in strictly ascending order and
+// their values. values are copied, as with map_insert. returns NULL if keys
+// are not strictly ascending
+struct _map * map_create_sorted (uint64_t * keys, void ** values, size_t size);
+
+// moves the map into its flat, read optimized form. any insert or remove
+// thaws it again. freezing or thawing invalidates open iterators
+void          map_freeze      (struct _map * map);
+void          map_thaw        (struct _map * map);
+
 struct _map_node * map_node_create      (uint64_t key, void * value);
 void               map_node_delete      (struct _map_node *);
 struct _map_node * map_node_copy        (struct _map_node *);
@@ -48,11 +141,21 @@ int                map_node_cmp         (struct _map_node *, struct _map_node *)
 json_t *           map_node_serialize   (struct _map_node * map_node);
 struct _map_node * map_node_deserialize (json_t * json);
 
-struct _map_it * map_iterator  (struct _map * map);
-struct _map_it * map_it_next   (struct _map_it * map_it);
-void *           map_it_data   (struct _map_it * map_it);
-uint64_t         map_it_key    (struct _map_it * map_it);
-void             map_it_delete (struct _map_it * map_it);
+struct _map_it * map_iterator    (struct _map * map);
+struct _map_it * map_it_next     (struct _map_it * map_it);
+void *           map_it_data     (struct _map_it * map_it);
+uint64_t         map_it_key      (struct _map_it * map_it);
+void             map_it_delete   (struct _map_it * map_it);
+
+// cursors over a slice of the map. each costs O(log n) to position and
+// returns NULL when there is nothing to visit. walk them with map_it_next,
+// and call map_it_delete if you stop early
+// first key >= key
+struct _map_it * map_lower_bound (struct _map * map, uint64_t key);
+// first key > key
+struct _map_it * map_upper_bound (struct _map * map, uint64_t key);
+// every key in [lo, hi], both bounds inclusive
+struct _map_it * map_range       (struct _map * map, uint64_t lo, uint64_t hi);
 
 
-#endif
\ No newline at end of file
+#endif
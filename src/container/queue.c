@@ -31,7 +31,7 @@ void queue_delete (struct _queue * queue)
     it = queue->front;
     while (it != NULL) {
         next = it->next;
-        object_delete(it);
+        object_delete(it->data);
         free(it);
         it = next;
     }
@@ -55,6 +55,13 @@ struct _queue * queue_copy (struct _queue * queue) {
 
 
 void queue_push (struct _queue * queue, void * data)
+{
+    queue_push_take(queue, object_copy(data));
+}
+
+
+
+void queue_push_take (struct _queue * queue, void * data)
 {
     struct _queue_it * it = queue_it_create(data);
 
@@ -106,7 +113,7 @@ struct _queue_it * queue_it_create (void * data)
     struct _queue_it * it;
 
     it = (struct _queue_it *) malloc(sizeof(struct _queue_it));
-    it->data = object_copy(data);
+    it->data = data;
     it->next = NULL;
 
     return it;
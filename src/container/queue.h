@@ -22,9 +22,12 @@ void            queue_delete (struct _queue * queue);
 struct _queue * queue_copy   (struct _queue * queue);
 
 void            queue_push   (struct _queue * queue, void * data);
+// like queue_push, but the queue adopts data instead of copying it
+void            queue_push_take (struct _queue * queue, void * data);
 void *          queue_peek   (struct _queue * queue);
 void            queue_pop    (struct _queue * queue);
 
+// adopts data
 struct _queue_it * queue_it_create (void * data);
 
 #endif
\ No newline at end of file
@@ -21,31 +21,61 @@ struct _tree * tree_create ()
     tree = (struct _tree *) malloc(sizeof(struct _tree));
     tree->object = &tree_object;
     tree->nodes = NULL;
+    tree->arena = NULL;
 
     return tree;
 }
 
 
+struct _tree * tree_create_arena (struct _arena * arena)
+{
+    struct _tree * tree = tree_create();
+    if (arena != NULL)
+        tree->arena = object_share(arena);
+    return tree;
+}
+
 
-void tree_delete_node_delete (struct _tree_node * node)
+
+void tree_delete_node_delete (struct _tree * tree, struct _tree_node * node)
 {
     if (node == NULL)
         return;
-    tree_delete_node_delete(node->left);
-    tree_delete_node_delete(node->right);
+    tree_delete_node_delete(tree, node->left);
+    tree_delete_node_delete(tree, node->right);
     object_delete(node->data);
-    free(node);
+    arena_free(tree->arena, node, sizeof(struct _tree_node));
 }
 
 
 
 void tree_delete (struct _tree * tree)
 {
-    tree_delete_node_delete(tree->nodes);
+    tree_delete_node_delete(tree, tree->nodes);
+    if (tree->arena != NULL)
+        object_delete(tree->arena);
     free(tree); 
 }
 
 
+void tree_detach_node (struct _tree * tree, struct _tree_node * node)
+{
+    if (node == NULL)
+        return;
+    tree_detach_node(tree, node->left);
+    tree_detach_node(tree, node->right);
+    arena_free(tree->arena, node, sizeof(struct _tree_node));
+}
+
+
+
+void tree_detach (struct _tree * tree)
+{
+    tree_detach_node(tree, tree->nodes);
+    tree->nodes = NULL;
+}
+
+
 json_t * tree_serialize (struct _tree * tree)
 {
     json_t * json = json_object();
@@ -74,18 +104,38 @@ struct _tree * tree_deserialize (json_t * json)
 
     struct _tree * tree = tree_create();
 
+    size_t size = json_array_size(nodes);
+    void ** data = malloc(sizeof(void *) * (size + 1));
+    int sorted = 1;
+
     size_t i;
-    for (i = 0; i < json_array_size(nodes); i++) {
-        void * data = deserialize(json_array_get(nodes, i));
-        if (data == NULL) {
+    for (i = 0; i < size; i++) {
+        data[i] = deserialize(json_array_get(nodes, i));
+        if (data[i] == NULL) {
             serialize_error = SERIALIZE_TREE;
+            while (i-- > 0)
+                object_delete(data[i]);
+            free(data);
             object_delete(tree);
             return NULL;
         }
-        tree_insert(tree, data);
-        object_delete(data);
+        if ((i > 0) && (object_cmp(data[i - 1], data[i]) > 0))
+            sorted = 0;
+    }
+
+    // trees are serialized in order, so this should always be true
+    if (sorted) {
+        tree->nodes = tree_node_build(tree, data, size);
+        if (tree->nodes != NULL)
+            tree->nodes->parent = NULL;
+    }
+    else {
+        for (i = 0; i < size; i++)
+            tree_insert_take(tree, data[i]);
     }
 
+    free(data);
+
     return tree;
 }
 
@@ -94,17 +144,50 @@ struct _tree * tree_copy (struct _tree * tree)
 {
     struct _tree    * new_tree;
     struct _tree_it * it;
+    size_t size = 0;
+
+    for (it = tree_iterator(tree); it != NULL; it = tree_it_next(it))
+        size++;
+
+    void ** data = malloc(sizeof(void *) * (size + 1));
+
+    size = 0;
+    for (it = tree_iterator(tree); it != NULL; it = tree_it_next(it))
+        data[size++] = object_copy(tree_it_data(it));
 
     new_tree = tree_create();
-    for (it = tree_iterator(tree); it != NULL; it = tree_it_next(it)) {
-        tree_insert(new_tree, tree_it_data(it));
-    }
+    new_tree->nodes = tree_node_build(new_tree, data, size);
+    if (new_tree->nodes != NULL)
+        new_tree->nodes->parent = NULL;
+
+    free(data);
 
     return new_tree;
 }
 
 
 
+struct _tree * tree_create_sorted (void ** data, size_t size)
+{
+    struct _tree * tree;
+    size_t i;
+
+    void ** copies = malloc(sizeof(void *) * (size + 1));
+    for (i = 0; i < size; i++)
+        copies[i] = object_copy(data[i]);
+
+    tree = tree_create();
+    tree->nodes = tree_node_build(tree, copies, size);
+    if (tree->nodes != NULL)
+        tree->nodes->parent = NULL;
+
+    free(copies);
+
+    return tree;
+}
+
+
+
 void tree_map (struct _tree * tree, void (* callback) (void *))
 {
     tree_node_map(tree->nodes, callback);
@@ -113,12 +196,20 @@ void tree_map (struct _tree * tree, void (* callback) (void *))
 
 
 void tree_insert (struct _tree * tree, void * data)
+{
+    tree_insert_take(tree, object_copy(data));
+}
+
+
+
+void tree_insert_take (struct _tree * tree, void * data)
 {
     struct _tree_node * node;
 
-    node = tree_node_create(data);
+    node = tree_node_create(tree, data);
 
     tree->nodes = tree_node_insert(tree, tree->nodes, node);
+    tree->nodes->parent = NULL;
 }
 
 
@@ -127,7 +218,10 @@ void * tree_fetch (struct _tree * tree, void * data)
 {
     struct _tree_node * node;
 
-    node = tree_node_fetch (tree, tree->nodes, data);
+    node = tree_node_fetch(tree,
+                           tree->nodes,
+                           data,
+                           ((struct _object_header *) data)->object->cmp);
     if (node == NULL)
         return NULL;
 
@@ -140,7 +234,10 @@ void * tree_fetch_max (struct _tree * tree, void * data)
 {
     struct _tree_node * node;
 
-    node = tree_node_fetch_max (tree, tree->nodes, data);
+    node = tree_node_fetch_max(tree,
+                               tree->nodes,
+                               data,
+                               ((struct _object_header *) data)->object->cmp);
     if (node == NULL)
         return NULL;
 
@@ -151,20 +248,93 @@ void * tree_fetch_max (struct _tree * tree, void * data)
 void tree_remove (struct _tree * tree, void * data)
 {
     tree->nodes = tree_node_delete(tree, tree->nodes, data);
+    if (tree->nodes != NULL)
+        tree->nodes->parent = NULL;
+}
+
+
+
+void * tree_fetch_key (struct _tree * tree,
+                       void * key,
+                       int (* cmp) (void *, void *))
+{
+    struct _tree_node * node;
+
+    node = tree_node_fetch(tree, tree->nodes, key, cmp);
+    if (node == NULL)
+        return NULL;
+
+    return node->data;
+}
+
+
+
+void * tree_fetch_max_key (struct _tree * tree,
+                           void * key,
+                           int (* cmp) (void *, void *))
+{
+    struct _tree_node * node;
+
+    node = tree_node_fetch_max(tree, tree->nodes, key, cmp);
+    if (node == NULL)
+        return NULL;
+
+    return node->data;
 }
 
 
 
-struct _tree_node * tree_node_create (void * data)
+struct _tree_node * tree_node_create (struct _tree * tree, void * data)
 {
     struct _tree_node * node;
 
-    node = (struct _tree_node *) malloc(sizeof(struct _tree_node));
-    node->data = object_copy(data);
+    node = arena_alloc(tree->arena, sizeof(struct _tree_node));
+    node->data = data;
 
     node->level     = 0;
     node->left      = NULL;
     node->right     = NULL;
+    node->parent    = NULL;
+
+    return node;
+}
+
+
+
+/*
+* A subtree of size nodes built by splitting at the middle is given the level
+* floor(log2(size + 1)) - 1. The left half always ends up exactly one level
+* below its parent, and the right half is either one level below or, when it
+* holds one more node than the left, on the same level with a right child one
+* level lower. Both are valid AA-tree shapes, so nothing needs rebalancing.
+*/
+struct _tree_node * tree_node_build (struct _tree * tree,
+                                     void ** data,
+                                     size_t size)
+{
+    struct _tree_node * node;
+    size_t middle;
+    unsigned int level = 0;
+
+    if (size == 0)
+        return NULL;
+
+    while ((size + 1) >> (level + 2))
+        level++;
+
+    middle = (size - 1) / 2;
+
+    node = arena_alloc(tree->arena, sizeof(struct _tree_node));
+    node->data   = data[middle];
+    node->level  = level;
+    node->parent = NULL;
+    node->left   = tree_node_build(tree, data, middle);
+    node->right  = tree_node_build(tree, &(data[middle + 1]), size - middle - 1);
+
+    if (node->left != NULL)
+        node->left->parent = node;
+    if (node->right != NULL)
+        node->right->parent = node;
 
     return node;
 }
@@ -188,10 +358,14 @@ struct _tree_node * tree_node_insert (struct _tree * tree,
 {
     if (node == NULL)
         return new_node;
-    else if (object_cmp(new_node->data, node->data) < 0)
+    else if (object_cmp(new_node->data, node->data) < 0) {
         node->left  = tree_node_insert(tree, node->left,  new_node);
-    else
+        node->left->parent = node;
+    }
+    else {
         node->right = tree_node_insert(tree, node->right, new_node);
+        node->right->parent = node;
+    }
 
     node = tree_node_skew (node);
     node = tree_node_split(node);
@@ -203,37 +377,42 @@ struct _tree_node * tree_node_insert (struct _tree * tree,
 
 struct _tree_node * tree_node_fetch   (struct _tree * tree,
                                        struct _tree_node * node,
-                                       void * data)
+                                       void * key,
+                                       int (* cmp) (void *, void *))
 {
-    if (node == NULL)
-        return NULL;
-    if (object_cmp(data, node->data) == 0)
-        return node;
-    else if (object_cmp(data, node->data) < 0)
-        return tree_node_fetch(tree, node->left, data);
-    else
-        return tree_node_fetch(tree, node->right, data);
+    while (node != NULL) {
+        int result = cmp(key, node->data);
+        if (result == 0)
+            return node;
+        else if (result < 0)
+            node = node->left;
+        else
+            node = node->right;
+    }
+    return NULL;
 }
 
 
 
+// the last node we stepped right from is the greatest node less than key
 struct _tree_node * tree_node_fetch_max (struct _tree * tree,
                                          struct _tree_node * node,
-                                         void * data)
+                                         void * key,
+                                         int (* cmp) (void *, void *))
 {
-    struct _tree_node * found;
-
-    if (node == NULL)
-        return NULL;
-    if (object_cmp(data, node->data) == 0)
-        return node;
-    else if (object_cmp(data, node->data) < 0)
-        found = tree_node_fetch_max(tree, node->left, data);
-    else
-        found = tree_node_fetch_max(tree, node->right, data);
-
-    if ((found == NULL) && (object_cmp(data, node->data) > 0))
-        return node;
+    struct _tree_node * found = NULL;
+
+    while (node != NULL) {
+        int result = cmp(key, node->data);
+        if (result == 0)
+            return node;
+        else if (result < 0)
+            node = node->left;
+        else {
+            found = node;
+            node  = node->right;
+        }
+    }
     return found;
 }
 
@@ -293,26 +472,42 @@ struct _tree_node * tree_node_delete (struct _tree * tree,
 
     if (node == NULL)
         return node;
-    if (object_cmp(data, node->data) < 0)
+    int result = object_cmp(data, node->data);
+    if (result < 0) {
         node->left = tree_node_delete(tree, node->left, data);
-    else if (object_cmp(data, node->data) > 0)
+        if (node->left != NULL)
+            node->left->parent = node;
+    }
+    else if (result > 0) {
         node->right = tree_node_delete(tree, node->right, data);
+        if (node->right != NULL)
+            node->right->parent = node;
+    }
     else {
+        // an inner node trades data with its successor (or predecessor) and
+        // the data is then deleted from that node's place further down. the
+        // neighbour's data is moved rather than copied, so pointers into the
+        // tree stay good, and the tree stays ordered throughout
+        void * deleted = node->data;
         if ((node->left == NULL) && (node->right == NULL)) {
-            tree_delete_node_delete(node);
+            tree_delete_node_delete(tree, node);
             return NULL;
         }
         else if (node->left == NULL) {
             tmp = tree_node_successor(node);
-            object_delete(node->data);
-            node->data = object_copy(tmp->data);
-            node->right = tree_node_delete(tree, node->right, tmp->data);
+            node->data = tmp->data;
+            tmp->data  = deleted;
+            node->right = tree_node_delete(tree, node->right, deleted);
+            if (node->right != NULL)
+                node->right->parent = node;
         }
         else {
             tmp = tree_node_predecessor(node);
-            object_delete(node->data);
-            node->data = object_copy(tmp->data);
-            node->left = tree_node_delete(tree, node->left, tmp->data);
+            node->data = tmp->data;
+            tmp->data  = deleted;
+            node->left = tree_node_delete(tree, node->left, deleted);
+            if (node->left != NULL)
+                node->left->parent = node;
         }
     }
 
@@ -340,7 +535,11 @@ struct _tree_node * tree_node_skew (struct _tree_node * node)
     if (node->level == node->left->level) {
         L = node->left;
         node->left = L->right;
+        if (node->left != NULL)
+            node->left->parent = node;
         L->right = node;
+        L->parent = node->parent;
+        node->parent = L;
         return L;
     }
     return node;
@@ -356,7 +555,11 @@ struct _tree_node * tree_node_split (struct _tree_node * node)
     if (node->level == node->right->right->level) {
         R = node->right;
         node->right = R->left;
+        if (node->right != NULL)
+            node->right->parent = node;
         R->left = node;
+        R->parent = node->parent;
+        node->parent = R;
         R->level++;
         return R;
     }
@@ -365,90 +568,46 @@ struct _tree_node * tree_node_split (struct _tree_node * node)
 
 
 
-struct _tree_it * tree_it_create (struct _tree_node * node)
-{
-    struct _tree_it * tree_it;
-
-    tree_it = (struct _tree_it *) malloc(sizeof(struct _tree_it));
-    tree_it->direction = TREE_LEFT;
-    tree_it->node      = node;
-    tree_it->parent    = NULL;
-
-    return tree_it;
-}
-
-
-
-// creates _tree_its all the way down the left side of this tree
-struct _tree_it * tree_it_left (struct _tree_it * top)
-{
-    struct _tree_it * parent = top;
-    struct _tree_it * it = top;
-    while (parent->node->left != NULL) {
-        it = tree_it_create(parent->node->left);
-        it->parent = parent;
-        parent = it;
-    }
-
-    it->direction = TREE_NEUTRAL;
-    
-    return it;
-}
-
-
 struct _tree_it * tree_iterator (struct _tree * tree)
 {
-    struct _tree_it * top;
+    struct _tree_node * node = tree->nodes;
 
-    if (tree->nodes == NULL)
+    if (node == NULL)
         return NULL;
 
-    top = tree_it_create(tree->nodes);
-    return tree_it_left(top);
+    while (node->left != NULL)
+        node = node->left;
+
+    return (struct _tree_it *) node;
 }
 
 
 struct _tree_it * tree_it_next (struct _tree_it * tree_it)
 {
-    struct _tree_it * it;
-    if (tree_it->direction == TREE_LEFT) {
-        tree_it->direction = TREE_NEUTRAL;
-        return tree_it;
-    }
-    else if (    (tree_it->direction == TREE_NEUTRAL)
-              && (tree_it->node->right != NULL)) {
-        tree_it->direction = TREE_RIGHT;
-        it = tree_it_create(tree_it->node->right);
-        it->parent = tree_it;
-        return tree_it_left(it);
-    }
-    else {
-        while (tree_it != NULL) {
-            it = tree_it->parent;
-            free(tree_it);
-            if (it == NULL)
-                return NULL;
-            if (it->direction == TREE_LEFT)
-                break;
-            tree_it = it;
-        }
+    struct _tree_node * node = (struct _tree_node *) tree_it;
 
-        it->direction = TREE_NEUTRAL;
-        return it;
+    if (node->right != NULL) {
+        node = node->right;
+        while (node->left != NULL)
+            node = node->left;
+        return (struct _tree_it *) node;
     }
+
+    // climb until we come up from a left child
+    while ((node->parent != NULL) && (node->parent->right == node))
+        node = node->parent;
+
+    return (struct _tree_it *) node->parent;
 }
 
 
 void * tree_it_data (struct _tree_it * tree_it)
 {
-    return tree_it->node->data;
+    return ((struct _tree_node *) tree_it)->data;
 }
 
 
+// iterators hold no resources, this exists for symmetry with other containers
 void tree_it_delete (struct _tree_it * tree_it)
 {
-    if (tree_it != NULL) {
-        tree_it_delete(tree_it->parent);
-        free(tree_it);
-    }
-}
\ No newline at end of file
+}
@@ -3,45 +3,75 @@
 
 #include <stdlib.h>
 
+#include "arena.h"
 #include "object.h"
 
-#define TREE_NEUTRAL 0
-#define TREE_LEFT    1
-#define TREE_RIGHT   2
+#define TREE_CMP(XX) ((int (*) (void *, void *)) XX)
 
-struct _tree_it {
-    struct _tree_it *   parent;
-    int                 direction;
-    struct _tree_node * node;
-};
+/*
+* Nodes know their parent, so a tree iterator is nothing more than the node it
+* currently points at. struct _tree_it is never defined, it only exists so
+* iterators are not confused with nodes. Walking a tree never allocates.
+*/
+struct _tree_it;
 
 struct _tree_node {
     unsigned int level;
     void * data;
     struct _tree_node * left;
     struct _tree_node * right;
+    struct _tree_node * parent;
 };
 
 struct _tree {
     const struct _object * object;
     struct _tree_node * nodes;
+    // nodes come from here, or malloc when NULL
+    struct _arena * arena;
 };
 
 
 struct _tree * tree_create      ();
+// a tree whose nodes are allocated from arena. the tree holds a reference to
+// the arena. a NULL arena is the same as malloc
+struct _tree * tree_create_arena (struct _arena * arena);
 void           tree_delete      (struct _tree * tree);
 struct _tree * tree_copy        (struct _tree * tree);
 json_t *       tree_serialize   (struct _tree * tree);
 struct _tree * tree_deserialize (json_t * json);
 
+// builds a balanced tree in linear time from size objects which are already in
+// ascending object_cmp order. objects are copied, as with tree_insert
+struct _tree * tree_create_sorted (void ** data, size_t size);
+
 void           tree_map (struct _tree * tree, void (* callback) (void *));
 
+// empties the tree without deleting its data, which the caller takes over
+void           tree_detach (struct _tree * tree);
+
 void           tree_insert      (struct _tree * tree, void * data);
+// like tree_insert, but the tree adopts data instead of copying it
+void           tree_insert_take (struct _tree * tree, void * data);
 void *         tree_fetch       (struct _tree * tree, void * data);
 void *         tree_fetch_max   (struct _tree * tree, void * data);
 void           tree_remove      (struct _tree * tree, void * data);
 
-struct _tree_node * tree_node_create  (void * data);
+// key based lookups. cmp(key, data) orders key against data in the tree the
+// way object_cmp would order a needle against it, so no needle has to be
+// created just to search
+void *         tree_fetch_key     (struct _tree * tree,
+                                   void * key,
+                                   int (* cmp) (void *, void *));
+void *         tree_fetch_max_key (struct _tree * tree,
+                                   void * key,
+                                   int (* cmp) (void *, void *));
+
+// adopts data. the node is allocated from tree's arena
+struct _tree_node * tree_node_create  (struct _tree * tree, void * data);
+// builds a balanced subtree from sorted data, adopting data without copying
+struct _tree_node * tree_node_build   (struct _tree * tree,
+                                       void ** data,
+                                       size_t size);
 void                tree_node_map     (struct _tree_node * node,
                                        void (* callback) (void *));
 
@@ -51,11 +81,13 @@ struct _tree_node * tree_node_insert  (struct _tree * tree,
 
 struct _tree_node * tree_node_fetch   (struct _tree * tree,
                                        struct _tree_node * node,
-                                       void * data);
+                                       void * key,
+                                       int (* cmp) (void *, void *));
 
 struct _tree_node * tree_node_fetch_max (struct _tree * tree,
                                          struct _tree_node * node,
-                                         void * data);
+                                         void * key,
+                                         int (* cmp) (void *, void *));
 
 // deletes a node from a tree
 struct _tree_node * tree_node_delete  (struct _tree * tree,
@@ -0,0 +1,111 @@
+#include "xref_index.h"
+
+#include <stdlib.h>
+
+static const struct _object xref_index_object = {
+    (void   (*) (void *)) xref_index_delete,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+struct _xref_index * xref_index_create ()
+{
+    struct _xref_index * index = malloc(sizeof(struct _xref_index));
+
+    index->object = &xref_index_object;
+    index->to     = map_create();
+    index->from   = map_create();
+
+    return index;
+}
+
+
+void xref_index_delete (struct _xref_index * index)
+{
+    objects_delete(index->to, index->from, NULL);
+    free(index);
+}
+
+
+// removes the references made by referencer from the list of references to
+// address, and the list itself once it is empty
+void xref_index_unlink (struct _xref_index * index,
+                        uint64_t             address,
+                        uint64_t             referencer)
+{
+    struct _list * to = map_fetch(index->to, address);
+    if (to == NULL)
+        return;
+
+    struct _list_it * it = list_iterator(to);
+    while (it != NULL) {
+        struct _reference * reference = it->data;
+        if (reference->referencer == referencer)
+            it = list_remove(to, it);
+        else
+            it = it->next;
+    }
+
+    // list sizes count each append twice, so look for an empty list instead
+    if (list_iterator(to) == NULL)
+        map_remove(index->to, address);
+}
+
+
+void xref_index_remove (struct _xref_index * index, uint64_t address)
+{
+    struct _list * from = map_fetch(index->from, address);
+    if (from == NULL)
+        return;
+
+    struct _list_it * it;
+    for (it = list_iterator(from); it != NULL; it = it->next) {
+        struct _reference * reference = it->data;
+        xref_index_unlink(index, reference->address, reference->referencer);
+    }
+
+    map_remove(index->from, address);
+}
+
+
+void xref_index_set (struct _xref_index * index,
+                     uint64_t             address,
+                     struct _list       * references)
+{
+    xref_index_remove(index, address);
+
+    if (list_iterator(references) == NULL) {
+        object_delete(references);
+        return;
+    }
+
+    struct _list_it * it;
+    for (it = list_iterator(references); it != NULL; it = it->next) {
+        struct _reference * reference = it->data;
+
+        struct _list * to = map_fetch(index->to, reference->address);
+        if (to == NULL) {
+            map_insert_take(index->to, reference->address, list_create());
+            to = map_fetch(index->to, reference->address);
+        }
+
+        list_append(to, reference);
+    }
+
+    map_insert_take(index->from, address, references);
+}
+
+
+struct _list * xref_index_to (struct _xref_index * index, uint64_t address)
+{
+    return map_fetch(index->to, address);
+}
+
+
+struct _list * xref_index_from (struct _xref_index * index, uint64_t address)
+{
+    return map_fetch(index->from, address);
+}
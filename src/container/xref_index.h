@@ -0,0 +1,50 @@
+#ifndef xref_index_HEADER
+#define xref_index_HEADER
+
+#include <inttypes.h>
+
+#include "list.h"
+#include "map.h"
+#include "object.h"
+#include "reference.h"
+
+/*
+* An xref_index holds the references made by instructions, both by the address
+* they refer to and by the instruction making them. Instructions are added and
+* removed one at a time, so the index can follow changes to a graph without
+* being built again.
+*
+* Lists handed out belong to the index. They must not be modified, and are
+* only good until the index next changes.
+*/
+
+struct _xref_index {
+    const struct _object * object;
+    // address -> struct _list of struct _reference made to address. walk this
+    // to see every referenced address in order
+    struct _map * to;
+    // instruction address -> struct _list of struct _reference made by that
+    // instruction
+    struct _map * from;
+};
+
+
+struct _xref_index * xref_index_create ();
+void                 xref_index_delete (struct _xref_index * index);
+
+// replaces the references made by the instruction at address with references,
+// which the index adopts. an empty list removes them
+void xref_index_set    (struct _xref_index * index,
+                        uint64_t             address,
+                        struct _list       * references);
+
+// removes the references made by the instruction at address
+void xref_index_remove (struct _xref_index * index, uint64_t address);
+
+// the references made to address, or NULL if there are none
+struct _list * xref_index_to   (struct _xref_index * index, uint64_t address);
+
+// the references made by the instruction at address, or NULL if there are none
+struct _list * xref_index_from (struct _xref_index * index, uint64_t address);
+
+#endif
@@ -292,7 +292,7 @@ void funcwindow_edited (GtkCellRendererText * renderer,
                        -1);
 
     // update this label
-    struct _label * label = map_fetch(funcwindow->gui->rdis->labels, index);
+    struct _label * label = map_fetch_own(funcwindow->gui->rdis->labels, index);
     if (label == NULL) {
         printf("failed to find label for %llx\n",
                (unsigned long long) index);
@@ -357,11 +357,8 @@ uint64_t funcwindow_selected_item (struct _funcwindow * funcwindow)
 
 void funcwindow_launch_graph (struct _funcwindow * funcwindow, uint64_t index)
 {
-    struct _graph * graph = graph_family(funcwindow->gui->rdis->graph, index);
-    if (graph != NULL) {
-        gui_rdgwindow(funcwindow->gui, graph, RDGWINDOW_INS_GRAPH, index);
-        object_delete(graph);
-    }
+    if (rdis_graph_view(funcwindow->gui->rdis, index) != NULL)
+        gui_rdgwindow(funcwindow->gui, NULL, RDGWINDOW_INS_GRAPH, index);
     else {
         char tmp[128];
         snprintf(tmp, 128, "Could not create graph family for %llx\n",
@@ -43,6 +43,43 @@ GtkWidget * tipwindow (const char * text)
 }
 
 
+// instruction graphs are drawn from the family of top_index, read straight out
+// of rdis
+struct _rdg * rdgwindow_ins_rdg (struct _rdgwindow * rdgwindow)
+{
+    struct _rdis       * rdis = rdgwindow->gui->rdis;
+    struct _graph_view * view = rdis_graph_view(rdis, rdgwindow->top_index);
+
+    if (view != NULL)
+        return rdg_create_view(rdgwindow->top_index, view, rdis->labels);
+
+    struct _graph * graph = graph_create();
+    struct _rdg   * rdg   = rdg_create(rdgwindow->top_index, graph, rdis->labels);
+    object_delete(graph);
+
+    return rdg;
+}
+
+
+// the graph the nodes of this window come from
+struct _graph * rdgwindow_graph (struct _rdgwindow * rdgwindow)
+{
+    if (rdgwindow->graph != NULL)
+        return rdgwindow->graph;
+    return rdgwindow->gui->rdis->graph;
+}
+
+
+struct _ins_index * rdgwindow_ins_index (struct _rdgwindow * rdgwindow)
+{
+    if (rdgwindow->graph == NULL)
+        return rdis_ins_index(rdgwindow->gui->rdis);
+    if (rdgwindow->ins_index == NULL)
+        rdgwindow->ins_index = ins_index_create(rdgwindow->graph);
+    return rdgwindow->ins_index;
+}
+
+
 
 struct _rdgwindow * rdgwindow_create (struct _gui * gui,
                                       struct _graph * graph,
@@ -61,7 +98,10 @@ struct _rdgwindow * rdgwindow_create (struct _gui * gui,
     rdgwindow->gui            = gui;
     rdgwindow->gui_identifier = gui_add_window(rdgwindow->gui, rdgwindow->window);
 
-    rdgwindow->graph          = object_copy(graph);
+    rdgwindow->graph          = NULL;
+    if (graph != NULL)
+        rdgwindow->graph      = object_copy(graph);
+    rdgwindow->ins_index      = NULL;
 
     rdgwindow->image_drag_x   = 0;
     rdgwindow->image_drag_y   = 0;
@@ -77,9 +117,12 @@ struct _rdgwindow * rdgwindow_create (struct _gui * gui,
     rdgwindow->type           = type;
     rdgwindow->top_index      = top_index;
 
-    rdgwindow->rdg = rdg_create(rdgwindow->top_index,
-                                rdgwindow->graph,
-                                rdgwindow->gui->rdis->labels);
+    if (rdgwindow->graph == NULL)
+        rdgwindow->rdg = rdgwindow_ins_rdg(rdgwindow);
+    else
+        rdgwindow->rdg = rdg_create(rdgwindow->top_index,
+                                    rdgwindow->graph,
+                                    rdgwindow->gui->rdis->labels);
 
     // popup menu stuff
     GtkWidget * menuItem = gtk_menu_item_new_with_label(LANG_USERFUNCTION);
@@ -182,6 +225,9 @@ void rdgwindow_delete (struct _rdgwindow * rdgwindow)
     if (rdgwindow->graph != NULL)
         object_delete(rdgwindow->graph);
 
+    if (rdgwindow->ins_index != NULL)
+        object_delete(rdgwindow->ins_index);
+
     if (rdgwindow->node_colors != NULL)
         object_delete(rdgwindow->node_colors);
 
@@ -261,7 +307,9 @@ gboolean rdgwindow_image_motion_notify_event (GtkWidget * widget,
                                                image_x, image_y);
 
     if (hover_ins != -1) {
-        struct _ins * ins = graph_fetch_ins(rdgwindow->graph, hover_ins);
+        struct _ins * ins = ins_index_fetch(rdgwindow_ins_index(rdgwindow),
+                                            rdgwindow_graph(rdgwindow),
+                                            hover_ins);
         if (ins == NULL) {
             printf("could not get hover_ins %llx\n",
             (unsigned long long) hover_ins);
@@ -466,19 +514,16 @@ gboolean rdgwindow_image_button_press_event  (GtkWidget * widget,
 
         // if this ins is a call and the target is set
         if ((ins->flags & INS_CALL) && (ins->flags & INS_TARGET_SET)) {
-            struct _graph * family = graph_family(rdgwindow->gui->rdis->graph,
-                                                  ins->target);
-            if (family == NULL) {
+            if (rdis_graph_view(rdgwindow->gui->rdis, ins->target) == NULL) {
                 printf("could not find graph family for call target (call at %llx\n",
                        (unsigned long long) rdgwindow->selected_ins);
                 return FALSE;
             }
 
             gui_rdgwindow(rdgwindow->gui,
-                          family,
+                          NULL,
                           RDGWINDOW_INS_GRAPH,
                           ins->target);
-            object_delete(family);
         }
     }
 
@@ -522,6 +567,9 @@ gboolean rdgwindow_image_key_press_event (GtkWidget * widget,
                 if (ins->address != rdgwindow->selected_ins)
                     continue;
 
+                // don't write through to other graphs sharing this ins
+                it->data = ins = object_own(ins);
+
                 char tmpc[4];
                 sprintf(tmpc, "%c", event->keyval);
                 if (ins->comment == NULL) {
@@ -553,6 +601,8 @@ gboolean rdgwindow_image_key_press_event (GtkWidget * widget,
                 if (strlen(ins->comment) == 0)
                     break;
 
+                it->data = ins = object_own(ins);
+
                 char * tmp = strdup(ins->comment);
                 tmp[strlen(tmp) - 1] = '\0';
                 ins_s_comment(ins, tmp);
@@ -626,14 +676,13 @@ void rdgwindow_reset_node_colors (struct _rdgwindow * rdgwindow)
 
             struct _rdg_node_color * new;
             new = rdg_node_color_create(rdg_node_color->index, RDG_NODE_BG_COLOR);
-            list_append(node_colors, new);
-            object_delete(new);
+            list_append_take(node_colors, new);
         }
         object_delete(rdgwindow->node_colors);
     }
 
     rdg_custom_nodes(rdgwindow->rdg,
-                     rdgwindow->graph,
+                     rdgwindow_graph(rdgwindow),
                      rdgwindow->gui->rdis->labels,
                      node_colors,
                      rdgwindow->selected_ins);
@@ -653,7 +702,7 @@ void rdgwindow_color_node (struct _rdgwindow * rdgwindow)
     list_append(rdgwindow->node_colors, rdg_node_color);
 
     rdg_custom_nodes(rdgwindow->rdg,
-                     rdgwindow->graph,
+                     rdgwindow_graph(rdgwindow),
                      rdgwindow->gui->rdis->labels,
                      rdgwindow->node_colors,
                      rdgwindow->selected_ins);
@@ -671,8 +720,7 @@ void rdgwindow_color_node_predecessors (struct _rdgwindow * rdgwindow)
 
     // add currently selected node to queue
     struct _index * index = index_create(rdgwindow->selected_node);
-    queue_push(queue, index);
-    object_delete(index);
+    queue_push_take(queue, index);
 
     // add predecessors to the queue
     while (queue->size > 0) {
@@ -688,10 +736,9 @@ void rdgwindow_color_node_predecessors (struct _rdgwindow * rdgwindow)
 
         struct _graph_node * node = graph_fetch_node(rdgwindow->gui->rdis->graph,
                                                      index->index);
-        struct _list * predecessors = graph_node_predecessors(node);
-        struct _list_it * it;
-        for (it = list_iterator(predecessors); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
+        size_t i;
+        for (i = 0; i < node->predecessors.size; i++) {
+            struct _graph_edge * edge = node->predecessors.edges[i];
             index = index_create(edge->head);
             queue_push(queue, index);
             index_delete(index);
@@ -712,14 +759,13 @@ void rdgwindow_color_node_predecessors (struct _rdgwindow * rdgwindow)
         struct _rdg_node_color * rdg_node_color;
         rdg_node_color = rdg_node_color_create(index->index,
                                                RDGWINDOW_NODE_COLOR_PRE);
-        list_append(rdgwindow->node_colors, rdg_node_color);
-        object_delete(rdg_node_color);
+        list_append_take(rdgwindow->node_colors, rdg_node_color);
     }
 
     object_delete(pre_tree);
 
     rdg_color_nodes(rdgwindow->rdg,
-                    rdgwindow->graph,
+                    rdgwindow_graph(rdgwindow),
                     rdgwindow->gui->rdis->labels,
                     rdgwindow->node_colors);
     rdgwindow_image_update(rdgwindow);
@@ -729,18 +775,10 @@ void rdgwindow_color_node_predecessors (struct _rdgwindow * rdgwindow)
 void rdgwindow_rdis_callback (struct _rdgwindow * rdgwindow)
 {
     printf("rdgwindow_rdis_callback\n");
-    // reconstruct graph family from top index
+    // redraw graph family from top index
     if (rdgwindow->type == RDGWINDOW_INS_GRAPH) {
-        struct _graph * graph = graph_family(rdgwindow->gui->rdis->graph,
-                                             rdgwindow->top_index);
-        if (graph == NULL)
-            graph = graph_create();
-        object_delete(rdgwindow->graph);
-        rdgwindow->graph = graph;
         object_delete(rdgwindow->rdg);
-        rdgwindow->rdg = rdg_create(rdgwindow->top_index,
-                                    rdgwindow->graph,
-                                    rdgwindow->gui->rdis->labels);
+        rdgwindow->rdg = rdgwindow_ins_rdg(rdgwindow);
         rdgwindow_image_update(rdgwindow);
     }
     else
@@ -779,6 +817,13 @@ void rdgwindow_remove_all_after (GtkMenuItem * menuItem,
         struct _graph_node * node;
         node = graph_fetch_node(rdgwindow->gui->rdis->graph, rdgwindow->selected_node);
         if (node != NULL) {
+            // every node in this node's function may be cut short or removed
+            struct _graph_view * family = rdis_graph_view(rdgwindow->gui->rdis,
+                                                          node->index);
+            size_t i;
+            for (i = 0; i < family->size; i++)
+                rdis_node_changed(rdgwindow->gui->rdis,
+                                  graph_view_index(family, i));
             remove_all_after(node, rdgwindow->selected_ins);
             rdis_callback(rdgwindow->gui->rdis, RDIS_CALLBACK_GRAPH | RDIS_CALLBACK_GRAPH_NODE);
         }
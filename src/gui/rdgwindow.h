@@ -6,6 +6,7 @@
 
 #include "graph.h"
 #include "gui.h"
+#include "ins_index.h"
 #include "rdg.h"
 #include "tree.h"
 
@@ -39,7 +40,12 @@ struct _rdgwindow {
     
     struct _rdg       * rdg;
 
+    // NULL for RDGWINDOW_INS_GRAPH windows, which are drawn from a view of
+    // rdis->graph
     struct _graph     * graph;
+    // instructions of graph by address, built on the first hover. unused when
+    // graph is NULL, as rdis keeps one for rdis->graph
+    struct _ins_index * ins_index;
 
     double image_drag_x;
     double image_drag_y;
@@ -57,6 +63,8 @@ struct _rdgwindow {
 
 
 
+// graph is copied. pass NULL for RDGWINDOW_INS_GRAPH windows, which draw the
+// family of top_index in the rdis graph
 struct _rdgwindow * rdgwindow_create (struct _gui * gui,
                                       struct _graph * graph,
                                       int type,
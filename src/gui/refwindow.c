@@ -118,9 +118,9 @@ void refwindow_refresh (struct _refwindow * refwindow)
 {
     gtk_list_store_clear(refwindow->listStore);
 
-    struct _map * references = rdis_g_references(refwindow->gui->rdis);
+    struct _xref_index * xrefs = rdis_xrefs(refwindow->gui->rdis);
     struct _map_it * it;
-    for (it = map_iterator(references); it != NULL; it = map_it_next(it)) {
+    for (it = map_iterator(xrefs->to); it != NULL; it = map_it_next(it)) {
         uint64_t address = map_it_key(it);
         char address_str[32];
         snprintf(address_str, 32, "%04llx", (unsigned long long) address);
@@ -161,8 +161,6 @@ void refwindow_refresh (struct _refwindow * refwindow)
                            COL_REFERENCERS, referencers_str,
                            -1);
     }
-
-    object_delete(references);
 }
 
 
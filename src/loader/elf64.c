@@ -389,39 +389,7 @@ struct _map * elf64_functions_wqueue (struct _elf64 * elf64,
                                       struct _map *   memory,
                                       struct _list *  entries)
 {
-    struct _map * functions = map_create();
-    struct _wqueue * wqueue = wqueue_create();
-    struct _list_it * it;
-    for (it = list_iterator(entries); it != NULL; it = it->next) {
-        struct _function * function = it->data;
-
-        if (map_fetch(functions, function->address) == NULL)
-            map_insert(functions, function->address, function);
-
-        struct _x8664_wqueue * x8664w;
-        x8664w = x8664_wqueue_create(function->address, memory);
-
-        wqueue_push(wqueue, WQUEUE_CALLBACK(x8664_functions_wqueue), x8664w);
-        object_delete(x8664w);
-    }
-
-    wqueue_wait(wqueue);
-
-    struct _map * fmap;
-    while ((fmap = wqueue_peek(wqueue)) != NULL) {
-        struct _map_it * mit;
-        for (mit = map_iterator(fmap); mit != NULL; mit = map_it_next(mit)) {
-            struct _function * function = map_it_data(mit);
-
-            if (map_fetch(functions, function->address) == NULL)
-                map_insert(functions, function->address, function);
-        }
-        wqueue_pop(wqueue);
-    }
-
-    object_delete(wqueue);
-
-    return functions;
+    return udis86_discover(entries, memory, 64);
 }
 
 
@@ -434,8 +402,7 @@ struct _map * elf64_functions (struct _elf64 * elf64, struct _map * memory)
 
     // add the entry point
     struct _function * function = function_create(elf64_entry(elf64));
-    list_append(entries, function);
-    object_delete(function);
+    list_append_take(entries, function);
 
     // check for __libc_start_main loader
     uint64_t target_offset = elf64_entry(elf64) - elf64_base_address(elf64) + 0x1d;
@@ -457,8 +424,7 @@ struct _map * elf64_functions (struct _elf64 * elf64, struct _map * memory)
             // add main to function tree
             struct _function * function;
             function = function_create(udis86_sign_extend_lval(&(ud_obj.operand[1])));
-            list_append(entries, function);
-            object_delete(function);
+            list_append_take(entries, function);
         }
         else
             printf("disassembled: %s\n disassembled at %llx\n",
@@ -502,8 +468,7 @@ struct _map * elf64_functions (struct _elf64 * elf64, struct _map * memory)
                 continue;
 
             struct _function * function = function_create(sym->st_value);
-            list_append(entries, function);
-            object_delete(function);
+            list_append_take(entries, function);
         }
     }
 
@@ -543,7 +508,6 @@ struct _graph * elf64_graph_address (struct _elf64 * elf64,
 
     graph = x8664_graph(address, memory);
 
-    graph_reduce(graph);
     return graph;
 }
 
@@ -557,8 +521,7 @@ struct _map * elf64_memory_map (struct _elf64 * elf64)
 
     if (elf64->ehdr->e_phnum == 0) {
         struct _buffer * buffer = buffer_create(elf64->data, elf64->data_size);
-        map_insert(map, 0, buffer);
-        object_delete(buffer);
+        map_insert_take(map, 0, buffer);
         return map;
     }
 
@@ -579,8 +542,7 @@ struct _map * elf64_memory_map (struct _elf64 * elf64)
         struct _buffer * buffer;
         uint64_t key;
         // do we already have a buffer that this section overlaps?
-        buffer = map_fetch_max(map, phdr->p_vaddr + phdr->p_memsz);
-        key    = map_fetch_max_key(map, phdr->p_vaddr + phdr->p_memsz);
+        buffer = map_fetch_max_entry(map, phdr->p_vaddr + phdr->p_memsz, &key);
 
         if (    (buffer != NULL)
              && (    ((bottom <= key) && (top >= key))
@@ -603,8 +565,7 @@ struct _map * elf64_memory_map (struct _elf64 * elf64)
                 memcpy(tmp2, tmp, phdr->p_memsz);
                 struct _buffer * new_buffer = buffer_create(tmp2, new_size);
                 map_remove(map, key);
-                map_insert(map, bottom, new_buffer);
-                object_delete(new_buffer);
+                map_insert_take(map, bottom, new_buffer);
                 free(tmp2);
             }
             // if this section overlaps previous section but starts after
@@ -616,8 +577,7 @@ struct _map * elf64_memory_map (struct _elf64 * elf64)
                 memcpy(&(tmp2[bottom - key]), tmp, phdr->p_memsz);
                 struct _buffer * new_buffer = buffer_create(tmp2, new_size);
                 map_remove(map, key);
-                map_insert(map, key, new_buffer);
-                object_delete(new_buffer);
+                map_insert_take(map, key, new_buffer);
                 free(tmp2);
             }
 
@@ -625,8 +585,7 @@ struct _map * elf64_memory_map (struct _elf64 * elf64)
         // we don't have a previous section that this buffer overlaps
         else {
             struct _buffer * new_buffer = buffer_create(tmp, top - bottom);
-            map_insert(map, bottom, new_buffer);
-            object_delete(new_buffer);
+            map_insert_take(map, bottom, new_buffer);
         }
 
         free(tmp);
@@ -717,31 +676,37 @@ struct _graph * elf64_graph_functions (struct _elf64 * elf64,
                                        struct _map *   memory,
                                        struct _map *   functions)
 {
-    struct _graph  * graph  = graph_create();
+    struct _graph  * graph = graph_create();
     struct _wqueue * wqueue = wqueue_create();
 
+    // every task reads memory in place, and the tasks' contexts are freed
+    // all at once when they are done
+    struct _x8664_task * tasks = malloc(sizeof(struct _x8664_task)
+                                        * functions->size);
+    size_t tasks_n = 0;
+
     struct _map_it * it;
 
     for (it  = map_iterator(functions); it != NULL; it  = map_it_next(it)) {
         struct _function * function = map_it_data(it);
 
-        struct _x8664_wqueue * x8664w;
-        x8664w = x8664_wqueue_create(function->address, memory);
-        wqueue_push(wqueue, WQUEUE_CALLBACK(x8664_graph_wqueue), x8664w);
-        object_delete(x8664w);
+        struct _x8664_task * task = &(tasks[tasks_n++]);
+        task->address   = function->address;
+        task->memory    = memory;
+        task->discovery = NULL;
+        wqueue_task(wqueue, WQUEUE_CALLBACK(x8664_graph_task), task, NULL);
     }
 
-    wqueue_wait(wqueue);
-
-    while (wqueue_peek(wqueue) != NULL) {
-        graph_merge(graph, wqueue_peek(wqueue));
-        wqueue_pop(wqueue);
-    }
+    // merge each function's graph while the rest are still disassembling
+    struct _graph * function_graph;
+    while ((function_graph = wqueue_next_result(wqueue, -1)) != NULL)
+        graph_merge_take(graph, function_graph);
 
     object_delete(wqueue);
+    free(tasks);
 
+    truncate_blocks(graph);
     remove_function_predecessors(graph, functions);
-    graph_reduce(graph);
 
     return graph;
 }
@@ -759,8 +724,7 @@ struct _map * elf64_labels_functions (struct _elf64 * elf64,
         struct _function * function = map_it_data(it);
 
         struct _label * label = elf64_label_address(elf64, memory, function->address);
-        map_insert(labels_map, function->address, label);
-        object_delete(label);
+        map_insert_take(labels_map, function->address, label);
     }
 
     return labels_map;
@@ -168,10 +168,7 @@ struct _map * lua_loader_functions_table (lua_State * L)
         uint64_t address = rl_check_uint64(L, -1);
         printf("lua_loader_functions: %llx\n", (unsigned long long) address);
 
-        struct _function * function = function_create(address);
-        if (map_fetch(functions, address) == 0)
-            map_insert(functions, address, function);
-        object_delete(function);
+        map_insert_take(functions, address, function_create(address));
 
         lua_pop(L, 1);
     }
@@ -311,8 +308,7 @@ struct _graph * lua_loader_graph_address (struct _lua_loader * ll,
     int error                  = 0;
 
     struct _index * index = index_create(addr);
-    queue_push(queue, index);
-    object_delete(index);
+    queue_push_take(queue, index);
 
     while (queue->size > 0) {
         struct _index * index = queue_peek(queue);
@@ -348,8 +344,7 @@ struct _graph * lua_loader_graph_address (struct _lua_loader * ll,
         // create the graph node
         struct _list * ins_list = list_create();
         list_append(ins_list, ins);
-        graph_add_node(graph, ins->address, ins_list);
-        object_delete(ins_list);
+        graph_add_node_take(graph, ins->address, ins_list);
 
         // get the successors
         lua_pushstring(L, "successors");
@@ -362,8 +357,7 @@ struct _graph * lua_loader_graph_address (struct _lua_loader * ll,
                 uint64_t successor = rl_check_uint64(L, -1);
 
                 struct _index * sindex = index_create(successor);
-                queue_push(queue, sindex);
-                object_delete(sindex);
+                queue_push_take(queue, sindex);
 
                 struct _ins_edge * ins_edge = ins_edge_create(INS_EDGE_NORMAL);
                 struct _graph_edge * edge;
@@ -457,8 +451,7 @@ struct _map * lua_loader_memory_map (struct _lua_loader * ll)
 
         struct _buffer * buffer = buffer_create(tmpbuf, size);
         free(tmpbuf);
-        map_insert(memory_map, base_address, buffer);
-        object_delete(buffer);
+        map_insert_take(memory_map, base_address, buffer);
         // pop value
         lua_pop(L, 1);
     }
@@ -574,8 +567,7 @@ struct _map * lua_loader_labels_functions (struct _lua_loader * ll,
             objects_delete(functions, labels, NULL);
             return NULL;
         }
-        map_insert(labels, function->address, label);
-        object_delete(label);
+        map_insert_take(labels, function->address, label);
     }
 
     return labels;
@@ -413,10 +413,8 @@ struct _map * pe_functions (struct _pe * pe, struct _map * memory)
 
     struct _map * functions = pe_function_address(pe, memory, entry_address);
 
-    struct _function * function = function_create(entry_address);
-    if (map_fetch(functions, function->address) == NULL)
-        map_insert(functions, function->address, function);
-    object_delete(function);
+    // does nothing if the entry address is already a function
+    map_insert_take(functions, entry_address, function_create(entry_address));
 
     return functions;
 }
@@ -445,9 +443,6 @@ struct _graph * pe_graph_address (struct _pe  * pe,
     else if (pfh->Machine == IMAGE_FILE_MACHINE_I386)
         graph = x86_graph(address, memory);
 
-    if (graph != NULL)
-        graph_reduce(graph);
-
     return graph;
 }
 
@@ -572,40 +567,42 @@ struct _graph * pe_graph_functions (struct _pe  * pe,
                                     struct _map * memory,
                                     struct _map * functions)
 {
-    struct _graph * graph   = graph_create();
+    struct _graph  * graph = graph_create();
     struct _wqueue * wqueue = wqueue_create();
 
     Pe_FileHeader * pfh = pe_fh(pe);
 
+    // every task reads memory in place, and the tasks' contexts are freed
+    // all at once when they are done
+    struct _x8664_task * tasks = malloc(sizeof(struct _x8664_task)
+                                        * functions->size);
+    size_t tasks_n = 0;
+
     struct _map_it * it;
     for (it = map_iterator(functions); it != NULL; it = map_it_next(it)) {
         struct _function * function = map_it_data(it);
 
-        if (pfh->Machine == IMAGE_FILE_MACHINE_AMD64) {
-            struct _x8664_wqueue * x8664w;
-            x8664w = x8664_wqueue_create(function->address, memory);
-            wqueue_push(wqueue, WQUEUE_CALLBACK(x8664_graph_wqueue), x8664w);
-            object_delete(x8664w);
-        }
-        else {
-            struct _x86_wqueue * x86w;
-            x86w = x86_wqueue_create(function->address, memory);
-            wqueue_push(wqueue, WQUEUE_CALLBACK(x86_graph_wqueue), x86w);
-            object_delete(x86w);
-        }
-    }
-
-    wqueue_wait(wqueue);
+        struct _x8664_task * task = &(tasks[tasks_n++]);
+        task->address   = function->address;
+        task->memory    = memory;
+        task->discovery = NULL;
 
-    while (wqueue_peek(wqueue) != NULL) {
-        graph_merge(graph, wqueue_peek(wqueue));
-        wqueue_pop(wqueue);
+        if (pfh->Machine == IMAGE_FILE_MACHINE_AMD64)
+            wqueue_task(wqueue, WQUEUE_CALLBACK(x8664_graph_task), task, NULL);
+        else
+            wqueue_task(wqueue, WQUEUE_CALLBACK(x86_graph_task), task, NULL);
     }
 
+    // merge each function's graph while the rest are still disassembling
+    struct _graph * function_graph;
+    while ((function_graph = wqueue_next_result(wqueue, -1)) != NULL)
+        graph_merge_take(graph, function_graph);
+
     object_delete(wqueue);
+    free(tasks);
 
+    truncate_blocks(graph);
     remove_function_predecessors(graph, functions);
-    graph_reduce(graph);
 
     return graph;
 }
@@ -623,8 +620,7 @@ struct _map * pe_labels_functions (struct _pe  * pe,
 
         struct _label * label = pe_label_address(pe, memory, function->address);
         if (label != NULL)
-            map_insert(labels, function->address, label);
-        object_delete(label);
+            map_insert_take(labels, function->address, label);
     }
 
     return labels;
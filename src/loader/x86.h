@@ -8,13 +8,9 @@
 #include "map.h"
 #include "x8664.h"
 
-#define _x86_wqueue _x8664_wqueue
-#define x86_wqueue_create x8664_wqueue_create
-#define x86_wqueue_delete x8664_wqueue_delete
-#define x86_wqueue_copy   x8664_wqueue_copy
+#define _x86_task _x8664_task
 
-void * x86_graph_wqueue     (struct _x86_wqueue * x86_wqueue);
-void * x86_functions_wqueue (struct _x86_wqueue * x86_wqueue);
+void * x86_graph_task (struct _x86_task * task);
 
 struct _ins *   x86_ins   (uint64_t address, ud_t * ud_obj);
 
@@ -4,50 +4,14 @@
 #include "function.h"
 #include "index.h"
 #include "reference.h"
+#include "wqueue.h"
 
-
-static const struct _object x8664_wqueue_object = {
-    (void   (*) (void *)) x8664_wqueue_delete, 
-    (void * (*) (void *)) x8664_wqueue_copy,
-    NULL,
-    NULL
-};
-
-
-struct _x8664_wqueue * x8664_wqueue_create (uint64_t address, struct _map * memory)
-{
-    struct _x8664_wqueue * xgw;
-
-    xgw = (struct _x8664_wqueue *) malloc(sizeof(struct _x8664_wqueue));
-    xgw->object    = &x8664_wqueue_object;
-    xgw->address   = address;
-    xgw->memory    = memory;
-
-    return xgw;
-}
-
-
-void x8664_wqueue_delete (struct _x8664_wqueue * x8664_wqueue)
-{
-    free(x8664_wqueue);
-}
+#include <string.h>
 
 
-struct _x8664_wqueue * x8664_wqueue_copy (struct _x8664_wqueue * x8664_wqueue)
+void * x8664_graph_task (struct _x8664_task * task)
 {
-    return x8664_wqueue_create(x8664_wqueue->address, x8664_wqueue->memory);
-}
-
-
-void * x8664_graph_wqueue (struct _x8664_wqueue * x8664_wqueue)
-{
-    return x8664_graph(x8664_wqueue->address, x8664_wqueue->memory);
-}
-
-
-void * x8664_functions_wqueue (struct _x8664_wqueue * x8664_wqueue)
-{
-    return x8664_functions(x8664_wqueue->address, x8664_wqueue->memory);
+    return x8664_graph(task->address, task->memory);
 }
 
 
@@ -99,8 +63,7 @@ struct _ins * x8664_ins (uint64_t address, ud_t * ud_obj)
         else {
             struct _reference * reference;
             reference = reference_create(REFERENCE_STORE, address, destination);
-            ins_add_reference(ins, reference);
-            object_delete(reference);
+            ins_add_reference_take(ins, reference);
         }
     }
     else if (udis86_target(address, &(ud_obj->operand[1])) != -1) {
@@ -109,8 +72,7 @@ struct _ins * x8664_ins (uint64_t address, ud_t * ud_obj)
         destination += udis86_target(address, &(ud_obj->operand[1]));
         struct _reference * reference;
         reference = reference_create(REFERENCE_LOAD, address, destination);
-        ins_add_reference(ins, reference);
-        object_delete(reference);
+        ins_add_reference_take(ins, reference);
     }
     else if (    (ud_obj->operand[1].type == UD_OP_IMM)
               && (ud_obj->operand[1].size >= 32)) {
@@ -120,8 +82,7 @@ struct _ins * x8664_ins (uint64_t address, ud_t * ud_obj)
             reference = reference_create(REFERENCE_CONSTANT,
                                          address,
                                          udis86_sign_extend_lval(&(ud_obj->operand[1])));
-            ins_add_reference(ins, reference);
-            object_delete(reference);
+            ins_add_reference_take(ins, reference);
         }
     }
 
@@ -179,24 +140,182 @@ uint64_t udis86_rip_offset (uint64_t address, struct ud_operand * operand)
 
 
 /*
-* This is the initial phase, used to populate the graph with all reachable
-* nodes. We will worry about fixing edges from jmp-like mnemonics later.
+* Basic blocks are built directly as we disassemble. A block is started at
+* every address we are asked to disassemble, which are the entry address, the
+* targets of jumps and the instructions following conditional jumps, and runs
+* until a jump, ret or hlt, or until it runs into an instruction we have
+* already disassembled. When a jump lands in the middle of a block, the block
+* is split in two at the target.
+*
+* Every instruction disassembled is hashed on its address to the block holding
+* it, so finding the block to split never walks the graph. Edges leave from the
+* last instruction of a block, and splitting moves that instruction, so edges
+* are kept by instruction address while disassembling and added at the end.
 */
-void x8664_graph_0 (struct _graph * graph,
-                    uint64_t        address,
-                    struct _map *   memory)
+struct _udis86_slot {
+    uint64_t address;
+    uint64_t block;
+};
+
+struct _udis86_edge {
+    uint64_t address;
+    uint64_t tail;
+    int      type;
+};
+
+struct _udis86_blocks {
+    struct _graph * graph;
+    struct _map   * memory;
+    uint8_t         mode;
+    struct _ins * (* ins) (uint64_t, ud_t *);
+
+    // empty slots have an address of -1
+    struct _udis86_slot * slots;
+    size_t                slots_size;
+    size_t                slots_mask;
+
+    // addresses waiting to be disassembled
+    uint64_t * addresses;
+    size_t     addresses_size;
+    size_t     addresses_capacity;
+
+    struct _udis86_edge * edges;
+    size_t                edges_size;
+    size_t                edges_capacity;
+};
+
+
+size_t udis86_blocks_slot (struct _udis86_blocks * blocks, uint64_t address)
 {
-    ud_t            ud_obj;
-    int             continue_disassembling = 1;
-    uint64_t        last_address = -1;
-    int             edge_type = INS_EDGE_NORMAL;
+    uint64_t hash = address * 0x9e3779b97f4a7c15ULL;
+    size_t   slot = (hash ^ (hash >> 32)) & blocks->slots_mask;
 
-    struct _buffer * buffer = map_fetch_max(memory, address);
+    while (    (blocks->slots[slot].address != -1)
+            && (blocks->slots[slot].address != address))
+        slot = (slot + 1) & blocks->slots_mask;
 
-    if (buffer == NULL)
+    return slot;
+}
+
+
+// returns the address of the block holding the instruction at address, or -1
+uint64_t udis86_blocks_block (struct _udis86_blocks * blocks, uint64_t address)
+{
+    return blocks->slots[udis86_blocks_slot(blocks, address)].block;
+}
+
+
+void udis86_blocks_set (struct _udis86_blocks * blocks,
+                        uint64_t                address,
+                        uint64_t                block)
+{
+    // keep the table at most half full
+    if ((blocks->slots_size + 1) * 2 > blocks->slots_mask + 1) {
+        struct _udis86_slot * slots = blocks->slots;
+        size_t                mask  = blocks->slots_mask;
+        size_t                i;
+
+        blocks->slots_mask = (mask << 1) | 1;
+        blocks->slots = malloc(sizeof(struct _udis86_slot)
+                               * (blocks->slots_mask + 1));
+        memset(blocks->slots, 0xff, sizeof(struct _udis86_slot)
+                                    * (blocks->slots_mask + 1));
+
+        for (i = 0; i <= mask; i++) {
+            if (slots[i].address == -1)
+                continue;
+            blocks->slots[udis86_blocks_slot(blocks, slots[i].address)] = slots[i];
+        }
+        free(slots);
+    }
+
+    size_t slot = udis86_blocks_slot(blocks, address);
+    if (blocks->slots[slot].address == -1)
+        blocks->slots_size++;
+    blocks->slots[slot].address = address;
+    blocks->slots[slot].block   = block;
+}
+
+
+void udis86_blocks_push (struct _udis86_blocks * blocks, uint64_t address)
+{
+    if (blocks->addresses_size == blocks->addresses_capacity) {
+        blocks->addresses_capacity *= 2;
+        blocks->addresses = realloc(blocks->addresses,
+                                    sizeof(uint64_t)
+                                    * blocks->addresses_capacity);
+    }
+    blocks->addresses[blocks->addresses_size++] = address;
+}
+
+
+void udis86_blocks_edge (struct _udis86_blocks * blocks,
+                         uint64_t                address,
+                         uint64_t                tail,
+                         int                     type)
+{
+    if (blocks->edges_size == blocks->edges_capacity) {
+        blocks->edges_capacity *= 2;
+        blocks->edges = realloc(blocks->edges,
+                                sizeof(struct _udis86_edge)
+                                * blocks->edges_capacity);
+    }
+    blocks->edges[blocks->edges_size].address = address;
+    blocks->edges[blocks->edges_size].tail    = tail;
+    blocks->edges[blocks->edges_size].type    = type;
+    blocks->edges_size++;
+}
+
+
+// splits the block holding the instruction at address so that a new block
+// starts there. the old block falls through to the new one
+void udis86_blocks_split (struct _udis86_blocks * blocks, uint64_t address)
+{
+    uint64_t block = udis86_blocks_block(blocks, address);
+
+    if ((block == -1) || (block == address))
+        return;
+
+    struct _list    * ins_list = graph_fetch_data(blocks->graph, block);
+    struct _list    * new_ins_list = list_create();
+    struct _list_it * it = list_iterator(ins_list);
+    uint64_t          last = -1;
+
+    while (((struct _ins *) it->data)->address != address) {
+        last = ((struct _ins *) it->data)->address;
+        it = it->next;
+    }
+
+    while (it != NULL) {
+        struct _ins * ins = it->data;
+        list_append(new_ins_list, ins);
+        udis86_blocks_set(blocks, ins->address, address);
+        it = list_remove(ins_list, it);
+    }
+
+    graph_add_node_take(blocks->graph, address, new_ins_list);
+    udis86_blocks_edge(blocks, last, address, INS_EDGE_NORMAL);
+}
+
+
+void udis86_blocks_disassemble (struct _udis86_blocks * blocks,
+                                uint64_t                address)
+{
+    ud_t ud_obj;
+
+    // already disassembled, but this address must start a block
+    if (udis86_blocks_block(blocks, address) != -1) {
+        udis86_blocks_split(blocks, address);
         return;
+    }
+
+    uint64_t base_address;
+    struct _buffer * buffer = map_fetch_max_entry(blocks->memory,
+                                                  address,
+                                                  &base_address);
 
-    uint64_t base_address   = map_fetch_max_key(memory, address);
+    if (buffer == NULL)
+        return;
 
     if (base_address + buffer->size < address)
         return;
@@ -204,47 +323,42 @@ void x8664_graph_0 (struct _graph * graph,
     uint64_t offset = address - base_address;
 
     ud_init      (&ud_obj);
-    ud_set_mode  (&ud_obj, 64);
+    ud_set_mode  (&ud_obj, blocks->mode);
     ud_set_syntax(&ud_obj, UD_SYN_INTEL);
     ud_set_input_buffer(&ud_obj, &(buffer->bytes[offset]), buffer->size - offset);
 
-    while (continue_disassembling == 1) {
+    uint64_t       block    = address;
+    uint64_t       last     = -1;
+    struct _list * ins_list = NULL;
+
+    while (1) {
         size_t bytes_disassembled = ud_disassemble(&ud_obj);
-        if (bytes_disassembled == 0) {
+        if (bytes_disassembled == 0)
             break;
-        }
 
-        // even if we have already added this node, make sure we add the edge
-        // from the preceeding node, in case this node was added from a jump
-        // previously. otherwise we won't have an edge from its preceeding
-        // instruction
-        if (graph_fetch_node(graph, address) != NULL) {
-            if (last_address != -1) {
-                // not concerned if this call fails
-                struct _ins_edge * ins_edge = ins_edge_create(edge_type);
-                graph_add_edge(graph, last_address, address, ins_edge);
-                object_delete(ins_edge);
-            }
+        // we ran into code we already have. it starts a block now, and we
+        // fall through to it
+        if (udis86_blocks_block(blocks, address) != -1) {
+            udis86_blocks_split(blocks, address);
+            udis86_blocks_edge(blocks, last, address, INS_EDGE_NORMAL);
             break;
         }
 
-        // create graph node for this instruction
-        struct _ins * ins = x8664_ins(address, &ud_obj);
-        struct _list * ins_list = list_create();
-        list_append(ins_list, ins);
-        graph_add_node(graph, address, ins_list);
-        object_delete(ins_list);
-        object_delete(ins);
-
-        // add edge from previous instruction to this instruction
-        if (last_address != -1) {
-            struct _ins_edge * ins_edge = ins_edge_create(edge_type);
-            graph_add_edge(graph, last_address, address, ins_edge);
-            object_delete(ins_edge);
+        // nothing may disassemble here, so the block is not added until its
+        // first instruction is
+        if (ins_list == NULL) {
+            ins_list = list_create();
+            graph_add_node_take(blocks->graph, block, ins_list);
         }
 
-        // these mnemonics cause us to continue disassembly somewhere else
-        struct ud_operand * operand;
+        list_append_take(ins_list, blocks->ins(address, &ud_obj));
+        udis86_blocks_set(blocks, address, block);
+
+        uint64_t next = address + bytes_disassembled;
+
+        // these mnemonics end the block and continue disassembly elsewhere
+        struct ud_operand * operand = &(ud_obj.operand[0]);
+        uint64_t            target  = next + udis86_sign_extend_lval(operand);
         switch (ud_obj.mnemonic) {
         case UD_Ijo   :
         case UD_Ijno  :
@@ -262,152 +376,146 @@ void x8664_graph_0 (struct _graph * graph,
         case UD_Ijge  :
         case UD_Ijle  :
         case UD_Ijg   :
-        case UD_Ijmp  :
         case UD_Iloop :
-        //case UD_Icall :
-            operand = &(ud_obj.operand[0]);
-
             if (operand->type != UD_OP_JIMM)
                 break;
-
-            if (ud_obj.mnemonic == UD_Icall)
-                edge_type = INS_EDGE_NORMAL;
-            else if (ud_obj.mnemonic == UD_Ijmp)
-                edge_type = INS_EDGE_NORMAL; // not important, will terminate
-            else
-                edge_type = INS_EDGE_JCC_FALSE;
-
+            udis86_blocks_push(blocks, target);
+            udis86_blocks_edge(blocks, address, target, INS_EDGE_JCC_TRUE);
+            udis86_blocks_push(blocks, next);
+            udis86_blocks_edge(blocks, address, next, INS_EDGE_JCC_FALSE);
+            return;
+        case UD_Ijmp  :
             if (operand->type == UD_OP_JIMM) {
-                x8664_graph_0(graph,
-                              address
-                                + ud_insn_len(&ud_obj)
-                                + udis86_sign_extend_lval(operand),
-                              memory);
+                udis86_blocks_push(blocks, target);
+                udis86_blocks_edge(blocks, address, target, INS_EDGE_JUMP);
             }
-            break;
-        default :
-            edge_type = INS_EDGE_NORMAL;
-            break;
-        }
-
-        // these mnemonics cause disassembly to stop
-        switch (ud_obj.mnemonic) {
+            return;
         case UD_Iret :
         case UD_Ihlt :
-        case UD_Ijmp :
-            continue_disassembling = 0;
-            break;
+            return;
         default :
             break;
         }
 
-        last_address = address;
-        address += bytes_disassembled;
+        last    = address;
+        address = next;
     }
 }
 
 
-/*
-* In this pass, we are fixing the edges from jmp-like instructions and their
-* targets
-*/
-void x8664_graph_1 (struct _graph * graph,
-                    uint64_t        address)
+struct _graph * udis86_graph (uint64_t        address,
+                              struct _map   * memory,
+                              uint8_t         mode,
+                              struct _ins * (* ins) (uint64_t, ud_t *))
 {
-    struct _graph_it * it;
-    ud_t               ud_obj;
-
-    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
-        struct _list * ins_list = graph_it_data(it);
-        struct _ins  * ins = list_first(ins_list);
-
-        ud_init      (&ud_obj);
-        ud_set_mode  (&ud_obj, 64);
-        ud_set_input_buffer(&ud_obj, ins->bytes, ins->size);
-        ud_disassemble(&ud_obj);
+    struct _udis86_blocks blocks;
+
+    // function graphs are merged into one long lived graph, and merged nodes
+    // keep their arena alive, so this graph is built without one
+    blocks.graph = graph_create();
+
+    blocks.memory = memory;
+    blocks.mode   = mode;
+    blocks.ins    = ins;
+
+    blocks.slots_size = 0;
+    blocks.slots_mask = 255;
+    blocks.slots = malloc(sizeof(struct _udis86_slot) * (blocks.slots_mask + 1));
+    memset(blocks.slots, 0xff, sizeof(struct _udis86_slot) * (blocks.slots_mask + 1));
+
+    blocks.addresses_size     = 0;
+    blocks.addresses_capacity = 64;
+    blocks.addresses = malloc(sizeof(uint64_t) * blocks.addresses_capacity);
+
+    blocks.edges_size     = 0;
+    blocks.edges_capacity = 64;
+    blocks.edges = malloc(sizeof(struct _udis86_edge) * blocks.edges_capacity);
+
+    udis86_blocks_push(&blocks, address);
+    while (blocks.addresses_size > 0)
+        udis86_blocks_disassemble(&blocks,
+                                  blocks.addresses[--blocks.addresses_size]);
+
+    // every block is in place. tails which were never disassembled, because
+    // they are outside of memory, have no node and their edges are dropped
+    size_t i;
+    for (i = 0; i < blocks.edges_size; i++) {
+        struct _udis86_edge * edge = &(blocks.edges[i]);
+        struct _ins_edge * ins_edge = ins_edge_create(edge->type);
+        graph_add_edge(blocks.graph,
+                       udis86_blocks_block(&blocks, edge->address),
+                       edge->tail,
+                       ins_edge);
+        object_delete(ins_edge);
+    }
 
-        struct ud_operand * operand;
-        switch (ud_obj.mnemonic) {
-        case UD_Ijmp  :
-        case UD_Ijo   :
-        case UD_Ijno  :
-        case UD_Ijb   :
-        case UD_Ijae  :
-        case UD_Ijz   :
-        case UD_Ijnz  :
-        case UD_Ijbe  :
-        case UD_Ija   :
-        case UD_Ijs   :
-        case UD_Ijns  :
-        case UD_Ijp   :
-        case UD_Ijnp  :
-        case UD_Ijl   :
-        case UD_Ijge  :
-        case UD_Ijle  :
-        case UD_Ijg   :
-            operand = &(ud_obj.operand[0]);
+    free(blocks.slots);
+    free(blocks.addresses);
+    free(blocks.edges);
 
-            if (operand->type != UD_OP_JIMM)
-                break;
-            
-            uint64_t head = graph_it_index(it);
-            uint64_t tail = head
-                             + ud_insn_len(&ud_obj)
-                             + udis86_sign_extend_lval(operand);
-
-            int type = INS_EDGE_JCC_TRUE;
-            if (ud_obj.mnemonic == UD_Ijmp)
-                type = INS_EDGE_JUMP;
-
-            struct _ins_edge * ins_edge = ins_edge_create(type);
-            graph_add_edge(graph, head, tail, ins_edge);
-            object_delete(ins_edge);
-            break;
-        default :
-            break;
-        }
-    }
+    return blocks.graph;
 }
 
 
-
 struct _graph * x8664_graph (uint64_t address,
                              struct _map * memory)
 {
-    struct _graph * graph;
+    return udis86_graph(address, memory, 64, x8664_ins);
+}
 
-    graph = graph_create();
 
-    x8664_graph_0(graph, address, memory);
-    x8664_graph_1(graph, address);
 
-    return graph;
-}
+struct _udis86_functions {
+    struct _map  * functions;
+    struct _tree * disassembled;
+    struct _map  * memory;
+    uint8_t        mode;
+    // when 0 call targets are recorded, but not disassembled
+    int            calls;
 
+    // branch targets waiting to be disassembled
+    uint64_t * addresses;
+    size_t     addresses_size;
+    size_t     addresses_capacity;
+};
+
+
+void udis86_functions_push (struct _udis86_functions * functions,
+                            uint64_t                   address)
+{
+    if (functions->addresses_size == functions->addresses_capacity) {
+        functions->addresses_capacity *= 2;
+        functions->addresses = realloc(functions->addresses,
+                                       sizeof(uint64_t)
+                                       * functions->addresses_capacity);
+    }
+    functions->addresses[functions->addresses_size++] = address;
+}
 
 
-void x8664_functions_r (struct _map  * functions,
-                        struct _tree * disassembled,
-                        uint64_t       address,
-                        struct _map  * memory)
+// disassembles from address until disassembly stops or reaches something
+// already disassembled. branch targets are pushed instead of followed
+void udis86_functions_disassemble (struct _udis86_functions * functions,
+                                   uint64_t                   address)
 {
     ud_t            ud_obj;
     int             continue_disassembling = 1;
 
-    struct _buffer * buffer = map_fetch_max(memory, address);
+    uint64_t base_address;
+    struct _buffer * buffer = map_fetch_max_entry(functions->memory,
+                                                  address,
+                                                  &base_address);
 
     if (buffer == NULL)
         return;
 
-    uint64_t base_address   = map_fetch_max_key(memory, address);
-
     if (base_address + buffer->size < address)
         return;
 
     uint64_t offset = address - base_address;
 
     ud_init      (&ud_obj);
-    ud_set_mode  (&ud_obj, 64);
+    ud_set_mode  (&ud_obj, functions->mode);
     ud_set_syntax(&ud_obj, UD_SYN_INTEL);
     ud_set_input_buffer(&ud_obj, &(buffer->bytes[offset]), buffer->size - offset);
 
@@ -424,20 +532,18 @@ void x8664_functions_r (struct _map  * functions,
                                    + ud_insn_len(&ud_obj)
                                    + udis86_sign_extend_lval(&(ud_obj.operand[0]));
 
-            if (map_fetch(functions, target_addr) == NULL) {
+            if (map_fetch(functions->functions, target_addr) == NULL) {
                 struct _function * function = function_create(target_addr);
-                map_insert(functions, target_addr, function);
-                object_delete(function);
+                map_insert_take(functions->functions, target_addr, function);
             }
         }
 
-        struct _index * index = index_create(address);
-        if (tree_fetch(disassembled, index) != NULL) {
-            object_delete(index);
+        if (tree_fetch_key(functions->disassembled,
+                           &address,
+                           TREE_CMP(index_cmp_key)) != NULL)
             return;
-        }
-        tree_insert(disassembled, index);
-        object_delete(index);
+        struct _index * index = index_create(address);
+        tree_insert_take(functions->disassembled, index);
 
         // these mnemonics cause us to continue disassembly somewhere else
         struct ud_operand * operand;
@@ -463,13 +569,12 @@ void x8664_functions_r (struct _map  * functions,
         case UD_Icall :
             operand = &(ud_obj.operand[0]);
 
-            if (operand->type == UD_OP_JIMM) {
-                x8664_functions_r(functions,
-                                  disassembled,
-                                  address
-                                   + ud_insn_len(&ud_obj)
-                                   + udis86_sign_extend_lval(operand),
-                                  memory);
+            if (    (operand->type == UD_OP_JIMM)
+                 && ((ud_obj.mnemonic != UD_Icall) || functions->calls)) {
+                udis86_functions_push(functions,
+                                      address
+                                       + ud_insn_len(&ud_obj)
+                                       + udis86_sign_extend_lval(operand));
             }
             break;
         default :
@@ -492,16 +597,141 @@ void x8664_functions_r (struct _map  * functions,
 }
 
 
+struct _map * udis86_functions_walk (uint64_t      address,
+                                     struct _map * memory,
+                                     uint8_t       mode,
+                                     int           calls)
+{
+    struct _udis86_functions functions;
+
+    functions.functions          = map_create();
+    functions.disassembled       = tree_create();
+    functions.memory             = memory;
+    functions.mode               = mode;
+    functions.calls              = calls;
+    functions.addresses_size     = 0;
+    functions.addresses_capacity = 64;
+    functions.addresses          = malloc(sizeof(uint64_t)
+                                          * functions.addresses_capacity);
+
+    udis86_functions_push(&functions, address);
+    while (functions.addresses_size > 0) {
+        address = functions.addresses[--functions.addresses_size];
+        udis86_functions_disassemble(&functions, address);
+    }
 
-struct _map * x8664_functions (uint64_t address, struct _map * memory)
+    free(functions.addresses);
+    object_delete(functions.disassembled);
+
+    return functions.functions;
+}
+
+
+struct _map * udis86_functions (uint64_t      address,
+                                struct _map * memory,
+                                uint8_t       mode)
+{
+    return udis86_functions_walk(address, memory, mode, 1);
+}
+
+
+// adds function to discovery. returns 1 if the caller is the first to find
+// it, and so must see it disassembled, or 0
+int udis86_discover_claim (struct _udis86_discovery * discovery,
+                           struct _function         * function)
 {
+    pthread_mutex_lock(&(discovery->lock));
+    int found = map_fetch(discovery->functions, function->address) == NULL;
+    if (found)
+        map_insert(discovery->functions, function->address, function);
+    pthread_mutex_unlock(&(discovery->lock));
 
-    struct _map  * functions    = map_create();
-    struct _tree * disassembled = tree_create();
+    return found;
+}
+
+
+// a task of discovery which disassembles the function at address, and which
+// the wqueue frees once it has run
+struct _x8664_task * udis86_discover_task_create (struct _udis86_discovery * discovery,
+                                                  uint64_t                   address,
+                                                  struct _map              * memory)
+{
+    struct _x8664_task * task = malloc(sizeof(struct _x8664_task));
+
+    task->address   = address;
+    task->memory    = memory;
+    task->discovery = discovery;
+
+    return task;
+}
+
+
+void * udis86_discover_task (struct _x8664_task * task)
+{
+    struct _udis86_discovery * discovery = task->discovery;
+
+    // call targets are left to tasks of their own
+    struct _map * callees = udis86_functions_walk(task->address,
+                                                  task->memory,
+                                                  discovery->mode,
+                                                  0);
+
+    struct _map_it * it;
+    for (it = map_iterator(callees); it != NULL; it = map_it_next(it)) {
+        struct _function * function = map_it_data(it);
+        if (! udis86_discover_claim(discovery, function))
+            continue;
+
+        wqueue_spawn_task(WQUEUE_CALLBACK(udis86_discover_task),
+                          udis86_discover_task_create(discovery,
+                                                      function->address,
+                                                      task->memory),
+                          free);
+    }
 
-    x8664_functions_r(functions, disassembled, address, memory);
+    object_delete(callees);
 
-    object_delete(disassembled);
+    return NULL;
+}
 
-    return functions;
+
+struct _map * udis86_discover (struct _list * entries,
+                               struct _map  * memory,
+                               uint8_t        mode)
+{
+    struct _udis86_discovery discovery;
+    pthread_mutex_init(&(discovery.lock), NULL);
+    discovery.functions = map_create();
+    discovery.mode      = mode;
+
+    struct _wqueue * wqueue = wqueue_create();
+
+    struct _list_it * it;
+    for (it = list_iterator(entries); it != NULL; it = it->next) {
+        struct _function * function = it->data;
+
+        // tasks pushed earlier may have found this entry already
+        if (! udis86_discover_claim(&discovery, function))
+            continue;
+
+        wqueue_task(wqueue,
+                    WQUEUE_CALLBACK(udis86_discover_task),
+                    udis86_discover_task_create(&discovery,
+                                                function->address,
+                                                memory),
+                    free);
+    }
+
+    wqueue_wait(wqueue);
+    object_delete(wqueue);
+
+    pthread_mutex_destroy(&(discovery.lock));
+
+    return discovery.functions;
+}
+
+
+struct _map * x8664_functions (uint64_t address, struct _map * memory)
+{
+    return udis86_functions(address, memory, 64);
 }
\ No newline at end of file
@@ -1,39 +1,75 @@
 #ifndef x8664_HEADER
 #define x8664_HEADER
 
+#include <pthread.h>
 #include <udis86.h>
 
 #include "instruction.h"
 #include "graph.h"
+#include "list.h"
 #include "map.h"
 #include "object.h"
 
-struct _x8664_wqueue {
-    const struct _object * object;
-    uint64_t address;
-    struct _map * memory;
-};
-
+struct _udis86_discovery;
 
 /*
-*  Objects in rdis COPY data. However, in this specific case, objects of type
-*  _x8664_wqueue maintain a POINTER to memory, and do not copy the data. As
-*  long as the _x8664_wqueue object exists, the pointer must point to a valid
-*  loader memory map.
+* The context of a loader task, see wqueue_task. Nothing is copied, so memory,
+* and discovery when it is set, must outlive the task. A batch of tasks can
+* share one array of contexts, and every task reads the same memory map.
 */
-struct _x8664_wqueue * x8664_wqueue_create (uint64_t address, struct _map * memory);
-
-void                   x8664_wqueue_delete     (struct _x8664_wqueue * x8664_wqueue);
-struct _x8664_wqueue * x8664_wqueue_copy       (struct _x8664_wqueue * x8664_wqueue);
+struct _x8664_task {
+    uint64_t                   address;
+    struct _map              * memory;
+    // the discovery this task belongs to, or NULL
+    struct _udis86_discovery * discovery;
+};
 
-void * x8664_graph_wqueue     (struct _x8664_wqueue * x8664_wqueue);
-void * x8664_functions_wqueue (struct _x8664_wqueue * x8664_wqueue);
+void * x8664_graph_task (struct _x8664_task * task);
 
 struct _ins *   x8664_ins   (uint64_t address, ud_t * ud_obj);
 
 struct _graph * x8664_graph     (uint64_t address, struct _map * memory);
 struct _map *   x8664_functions (uint64_t address, struct _map * memory);
 
+/*
+* Disassembles everything reachable from address into a graph of basic blocks,
+* decoding in the given udis86 mode and creating instructions with ins. Shared
+* by x86_graph and x8664_graph.
+*/
+struct _graph * udis86_graph (uint64_t        address,
+                              struct _map   * memory,
+                              uint8_t         mode,
+                              struct _ins * (* ins) (uint64_t, ud_t *));
+
+// finds the targets of every direct call reachable from address, decoding in
+// the given udis86 mode. shared by x86_functions and x8664_functions
+struct _map * udis86_functions (uint64_t      address,
+                                struct _map * memory,
+                                uint8_t       mode);
+
+// shared by the work items of one udis86_discover
+struct _udis86_discovery {
+    pthread_mutex_t lock;
+    // every function found so far
+    struct _map *   functions;
+    uint8_t         mode;
+};
+
+/*
+* Finds the targets of every direct call reachable from entries, a list of
+* struct _function, like udis86_functions run on each entry. Each function is
+* disassembled by a work item of its own, which spawns a work item for every
+* call target no other work item has found yet, so functions are disassembled
+* once, and in parallel as soon as they are found. The returned map holds the
+* entries as well.
+*/
+struct _map * udis86_discover (struct _list * entries,
+                               struct _map  * memory,
+                               uint8_t        mode);
+
+// disassembles one function of a discovery, see udis86_discover
+void * udis86_discover_task (struct _x8664_task * task);
+
 uint64_t udis86_target           (uint64_t address, struct ud_operand * operand);
 uint64_t udis86_sign_extend_lval (struct ud_operand * operand);
 uint64_t udis86_rip_offset       (uint64_t address,
@@ -26,4 +26,32 @@ void objects_delete (void * first, ...)
     }
 
     va_end(ap);
-}
\ No newline at end of file
+}
+
+
+// reference counts are updated atomically, shared objects cross wqueue threads
+void * object_share (void * object)
+{
+    __sync_add_and_fetch(&(((struct _object_header *) object)->refs), 1);
+    return object;
+}
+
+
+int object_release (void * object)
+{
+    if (__sync_sub_and_fetch(&(((struct _object_header *) object)->refs), 1) == 0)
+        return 1;
+    return 0;
+}
+
+
+void * object_own (void * object)
+{
+    if (! object_shared(object))
+        return object;
+
+    void * clone = OBJECT_VTABLE(object)->clone(object);
+    object_delete(object);
+
+    return clone;
+}
@@ -3,16 +3,30 @@
 
 #include <jansson.h>
 
+/*
+* Objects may opt in to reference counting by setting clone in their vtable and
+* placing an unsigned int refs directly after their object pointer. For these
+* objects copy shares the object (object_share) and delete drops a reference
+* (object_release), so containers hold one shared, immutable payload instead
+* of a deep copy each. clone makes a real copy.
+*
+* Anything which modifies a reference counted object held by a container must
+* first swap it for the result of object_own, which clones the object only if
+* someone else is still holding it.
+*/
 struct _object {
     void     (* delete)      (void *);
     void *   (* copy)        (void *);
     int      (* cmp)         (void *, void *);
     void     (* merge)       (void *, void *);
     json_t * (* serialize)   (void *);
+    void *   (* clone)       (void *);
 };
 
 struct _object_header {
     struct _object * object;
+    // only valid for objects with a clone method
+    unsigned int     refs;
 };
 
 #define object_delete(XYX) \
@@ -25,7 +39,20 @@ struct _object_header {
     (((struct _object_header *) XYX)->object->merge(XYX, YXY))
 #define object_serialize(XYX) \
     ((struct _object_header *) XYX)->object->serialize(XYX)
+#define object_shared(XYX) \
+    (    (((struct _object_header *) XYX)->object->clone != NULL) \
+      && (((struct _object_header *) XYX)->refs > 1))
 
 void objects_delete (void * first, ...);
 
+// adds a reference to a reference counted object and returns it
+void * object_share   (void * object);
+// drops a reference. returns 1 if that was the last one and the object should
+// now be freed, 0 otherwise
+int    object_release (void * object);
+// gives up the caller's reference to object in exchange for an object which
+// only the caller holds and may modify. this is object itself unless it is
+// shared, in which case it is a clone
+void * object_own     (void * object);
+
 #endif
\ No newline at end of file
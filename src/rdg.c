@@ -1,6 +1,8 @@
 #include "rdg.h"
 
 #include "graph.h"
+#include "graph_csr.h"
+#include "graph_view.h"
 #include "instruction.h"
 #include "label.h"
 #include "list.h"
@@ -47,9 +49,7 @@ void rdg_debug (struct _rdg * rdg) {
 }
 
 
-struct _rdg * rdg_create (uint64_t        top_index,
-                          struct _graph * graph,
-                          struct _map   * labels)
+struct _rdg * rdg_alloc (uint64_t top_index)
 {
     struct _rdg * rdg;
 
@@ -62,50 +62,56 @@ struct _rdg * rdg_create (uint64_t        top_index,
     rdg->width       = 0;
     rdg->height      = 0;
 
-    // add nodes to rdg->graph and acyclic graph
-    struct _graph * acyclic_graph = graph_create();
-    struct _graph_it * graph_it;
-    for (graph_it = graph_iterator(graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _graph_node * node = graph_it_node(graph_it);
+    return rdg;
+}
 
-        cairo_surface_t * surface;
-        surface = rdg_node_draw(node, labels);
-        struct _rdg_node * rdg_node = rdg_node_create(node->index, surface);
-        graph_add_node(rdg->graph, node->index, rdg_node);
-        object_delete(rdg_node);
 
-        rdg_node = rdg_node_create(node->index, NULL);
-        graph_add_node(acyclic_graph, node->index, rdg_node);
-        object_delete(rdg_node);
+// adds node to rdg->graph and acyclic graph
+void rdg_add_node (struct _rdg        * rdg,
+                   struct _graph      * acyclic_graph,
+                   struct _graph_node * node,
+                   struct _map        * labels)
+{
+    cairo_surface_t * surface;
+    surface = rdg_node_draw(node, labels);
+    struct _rdg_node * rdg_node = rdg_node_create(node->index, surface);
+    graph_add_node_take(rdg->graph, node->index, rdg_node);
 
-        cairo_surface_destroy(surface);
-    }
+    rdg_node = rdg_node_create(node->index, NULL);
+    graph_add_node_take(acyclic_graph, node->index, rdg_node);
 
-    // add edges
-    for (graph_it = graph_iterator(graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _graph_node * node = graph_it_node(graph_it);
+    cairo_surface_destroy(surface);
+}
 
-        struct _list_it * list_it;
-        for (list_it = list_iterator(node->edges);
-             list_it != NULL;
-             list_it = list_it->next) {
-            struct _graph_edge * edge = list_it->data;
 
-            graph_add_edge(rdg->graph, edge->head, edge->tail, edge->data);
-            graph_add_edge(acyclic_graph, edge->head, edge->tail, edge->data);
-        }
+void rdg_add_edges (struct _rdg        * rdg,
+                    struct _graph      * acyclic_graph,
+                    struct _graph_node * node)
+{
+    size_t i;
+    for (i = 0; i < node->successors.size; i++) {
+        struct _graph_edge * edge = node->successors.edges[i];
+
+        graph_add_edge(rdg->graph, edge->head, edge->tail, edge->data);
+        graph_add_edge(acyclic_graph, edge->head, edge->tail, edge->data);
     }
+}
+
+
+// lays out rdg once every node and edge is in. consumes acyclic_graph
+void rdg_layout (struct _rdg * rdg, struct _graph * acyclic_graph)
+{
+    uint64_t top_index = rdg->top_index;
 
     // acyclicize and assign levels
-    rdg_acyclicize(acyclic_graph, top_index);
-    rdg_acyclicize_pre(acyclic_graph, top_index);
+    struct _graph_walk * walk = graph_walk_create();
+    rdg_acyclicize(acyclic_graph, walk, top_index);
+    rdg_acyclicize_pre(acyclic_graph, walk, top_index);
+    object_delete(walk);
     rdg_assign_levels(acyclic_graph, top_index);
 
     // copy over levels
+    struct _graph_it * graph_it;
     for (graph_it = graph_iterator(acyclic_graph);
          graph_it != NULL;
          graph_it = graph_it_next(graph_it)) {
@@ -123,6 +129,50 @@ struct _rdg * rdg_create (uint64_t        top_index,
     //rdg_remove_virtual_nodes(rdg);
 
     rdg_reduce_and_draw (rdg);
+}
+
+
+struct _rdg * rdg_create (uint64_t        top_index,
+                          struct _graph * graph,
+                          struct _map   * labels)
+{
+    struct _rdg * rdg = rdg_alloc(top_index);
+
+    // add nodes to rdg->graph and acyclic graph
+    struct _graph * acyclic_graph = graph_create();
+    struct _graph_it * graph_it;
+    for (graph_it = graph_iterator(graph);
+         graph_it != NULL;
+         graph_it = graph_it_next(graph_it))
+        rdg_add_node(rdg, acyclic_graph, graph_it_node(graph_it), labels);
+
+    // add edges
+    for (graph_it = graph_iterator(graph);
+         graph_it != NULL;
+         graph_it = graph_it_next(graph_it))
+        rdg_add_edges(rdg, acyclic_graph, graph_it_node(graph_it));
+
+    rdg_layout(rdg, acyclic_graph);
+
+    return rdg;
+}
+
+
+struct _rdg * rdg_create_view (uint64_t             top_index,
+                               struct _graph_view * view,
+                               struct _map        * labels)
+{
+    struct _rdg * rdg = rdg_alloc(top_index);
+
+    struct _graph * acyclic_graph = graph_create();
+    size_t i;
+    for (i = 0; i < view->size; i++)
+        rdg_add_node(rdg, acyclic_graph, graph_view_node(view, i), labels);
+
+    for (i = 0; i < view->size; i++)
+        rdg_add_edges(rdg, acyclic_graph, graph_view_node(view, i));
+
+    rdg_layout(rdg, acyclic_graph);
 
     return rdg;
 }
@@ -453,44 +503,72 @@ int rdg_node_sink_y (struct _rdg * rdg,
 * Code to Acyclicize the graph                  *
 ************************************************/
 
-void rdg_acyclicize (struct _graph * graph, uint64_t index)
+void rdg_acyclicize_remove (struct _graph * graph, struct _queue * queue)
 {
-    struct _graph_node * node = graph_fetch_node(graph, index);
-    if (node == NULL) {
-        printf("acyclicize NULL node error, index: %llx\n",
-               (unsigned long long) index);
-        return;
+    while (queue->size > 0) {
+        struct _graph_edge * edge = queue_peek(queue);
+        graph_remove_edge(graph, edge->head, edge->tail);
+        queue_pop(queue);
     }
-    struct _rdg_node * rdg_node = node->data;
-    struct _queue * queue = queue_create();
+}
 
-    rdg_node->flags |= RDG_NODE_ACYCLIC;
 
-    struct _list_it * it;
-    struct _list * successors = graph_node_successors(node);
-    for (it = list_iterator(successors); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
+// removes the edges the last walk could have followed out of the nodes it
+// reached, but did not. nodes are done in the order the walk left them and
+// edges in the order they were found, so edge arrays end up in the same order
+// the recursive walks this replaced left them in
+void rdg_acyclicize_edges (struct _graph      * graph,
+                           struct _graph_walk * walk,
+                           int                  predecessors)
+{
+    struct _queue * queue = queue_create();
 
-        struct _rdg_node * rdg_suc_node;
-        rdg_suc_node = graph_fetch_data(graph, edge->tail);
-        if (rdg_suc_node->flags & RDG_NODE_ACYCLIC)
-            queue_push(queue, edge);
+    size_t i;
+    for (i = 0; i < walk->size; i++) {
+        struct _graph_node  * node = walk->nodes[i];
+        struct _graph_edges * edges;
+        if (predecessors)
+            edges = &(node->predecessors);
         else
-            rdg_acyclicize(graph, edge->tail);
-    }
-    object_delete(successors);
+            edges = &(node->successors);
+
+        size_t j;
+        for (j = 0; j < edges->size; j++) {
+            struct _graph_edge * edge = edges->edges[j];
+            uint64_t index = predecessors ? edge->head : edge->tail;
+            if (graph_walk_edge(walk, graph_fetch_node(graph, index)) != edge)
+                queue_push(queue, edge);
+        }
 
-    while (queue->size > 0) {
-        struct _graph_edge * edge = queue_peek(queue);
-        graph_remove_edge(graph, edge->head, edge->tail);
-        queue_pop(queue);
+        rdg_acyclicize_remove(graph, queue);
     }
 
     object_delete(queue);
 }
 
 
-void rdg_acyclicize_pre (struct _graph * graph, uint64_t index)
+// keeps only the edges a depth first walk from index follows, so what is
+// reachable from index becomes a tree
+void rdg_acyclicize (struct _graph      * graph,
+                     struct _graph_walk * walk,
+                     uint64_t             index)
+{
+    graph_walk_clear(walk);
+    if (graph_walk(walk, graph, index, GRAPH_WALK_POSTORDER, NULL, NULL) < 0) {
+        printf("acyclicize NULL node error, index: %llx\n",
+               (unsigned long long) index);
+        return;
+    }
+
+    rdg_acyclicize_edges(graph, walk, 0);
+}
+
+
+// does the same for the nodes which lead to index but which rdg_acyclicize
+// did not reach. walk must still hold what rdg_acyclicize reached
+void rdg_acyclicize_pre (struct _graph      * graph,
+                         struct _graph_walk * walk,
+                         uint64_t             index)
 {
     struct _graph_node * node = graph_fetch_node(graph, index);
     if (node == NULL) {
@@ -498,35 +576,27 @@ void rdg_acyclicize_pre (struct _graph * graph, uint64_t index)
                (unsigned long long) index);
         return;
     }
-    struct _rdg_node * rdg_node = node->data;
+
     struct _queue * queue = queue_create();
 
-    // mark this node with acyclic flag
-    rdg_node->flags |= RDG_NODE_ACYCLIC;
+    // the walks only remove edges entering other nodes, so this node's
+    // predecessors do not change underneath us
+    size_t i;
+    for (i = 0; i < node->predecessors.size; i++) {
+        struct _graph_edge * edge = node->predecessors.edges[i];
 
-    struct _list_it * it;
-    struct _list * predecessors = graph_node_predecessors(node);
-    for (it = list_iterator(predecessors); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-
-        struct _rdg_node * rdg_suc_node;
-        // get predecessor node
-        rdg_suc_node = graph_fetch_data(graph, edge->head);
-        // if this node is acyclic
-        if (rdg_suc_node->flags & RDG_NODE_ACYCLIC)
-            // mark this edge for deletion
+        graph_walk(walk, graph, edge->head,
+                   GRAPH_WALK_POSTORDER | GRAPH_WALK_PREDECESSORS,
+                   NULL, NULL);
+
+        // nothing is walked from a node which has been reached before
+        if (walk->size == 0)
             queue_push(queue, edge);
         else
-            // otherwise, perform recursive call on this node
-            rdg_acyclicize_pre(graph, edge->head);
+            rdg_acyclicize_edges(graph, walk, 1);
     }
-    object_delete(predecessors);
 
-    while (queue->size > 0) {
-        struct _graph_edge * edge = queue_peek(queue);
-        graph_remove_edge(graph, edge->head, edge->tail);
-        queue_pop(queue);
-    }
+    rdg_acyclicize_remove(graph, queue);
 
     object_delete(queue);
 }
@@ -548,148 +618,54 @@ void rdg_node_level_zero (struct _graph_node * node)
 
 void rdg_assign_levels2 (struct _graph * graph, uint64_t top_index)
 {
-    struct _queue * queue = queue_create();
-
-    struct _index * index = index_create(top_index);
-    queue_push(queue, index);
-    object_delete(index);
-
-    while (queue->size > 0) {
-        struct _index * index = queue_peek(queue);
-
-        struct _graph_node * node = graph_fetch_node(graph, index->index);
-        if (node == NULL) {
-            queue_pop(queue);
-            continue;
-        }
-        struct _rdg_node * rdg_node = node->data;
-
-        struct _list_it * it;
-        for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-
-            if (edge->head == rdg_node->index) {
-                struct _rdg_node * tail_node;
-                tail_node = graph_fetch_data(graph, edge->tail);
-                if (rdg_node->level + 1 > tail_node->level) {
-                    tail_node->level = rdg_node->level + 1;
-                }
-                if ((tail_node->flags & RDG_NODE_LEVEL_SET) == 0) {
-                    index = index_create(tail_node->index);
-                    queue_push(queue, index);
-                    object_delete(index);
-                }
-                tail_node->flags |= RDG_NODE_LEVEL_SET;
-            }
-
-            if (edge->tail == rdg_node->index) {
-                struct _rdg_node * head_node;
-                head_node = graph_fetch_data(graph, edge->head);
-                if ((head_node->flags & RDG_NODE_LEVEL_SET) == 0) {
-                    head_node->level = rdg_node->level - 1;
-                    index = index_create(head_node->index);
-                    queue_push(queue, index);
-                    object_delete(index);
-                }
-                head_node->flags |= RDG_NODE_LEVEL_SET;
-            }
-
-        }
-        queue_pop(queue);
-    }
-
-    object_delete(queue);
-}
-
-
-void rdg_node_assign_level (struct _graph * graph, struct _graph_node * node)
-{
-    struct _rdg_node * rdg_node = node->data;
-    struct _graph_edge * edge;
-    struct _list_it * it;
-    int new_level = -9000;
-
-    printf("rdg_node_assign_level %llx\n", (unsigned long long) node->index);
+    struct _graph_csr * csr = graph_freeze(graph);
 
-    if (rdg_node->flags & RDG_NODE_LEVEL_SET)
+    uint32_t top = graph_csr_id(csr, top_index);
+    if (top == GRAPH_CSR_NONE) {
+        object_delete(csr);
         return;
+    }
 
-    // get highest level of predecessors
-    struct _list * predecessors = graph_node_predecessors(node);
-    for (it = list_iterator(predecessors); it != NULL; it = it->next) {
-        edge = it->data;
-        struct _rdg_node * pre_node = graph_fetch_data(graph, edge->head);
-
-        // loops don't count
-        if (edge->head == edge->tail)
-            continue;
-
-        // if this predecessor has not had its level assigned yet, conduct a
-        // recursive call to assign its predecessors and then itself
-        if ((pre_node->flags & RDG_NODE_LEVEL_SET) == 0) {
-            rdg_node_assign_level(graph, graph_fetch_node(graph, edge->head));
-        }
-
-        if (pre_node->flags & RDG_NODE_LEVEL_SET) {
-            if ((rdg_node->flags & RDG_NODE_LEVEL_SET) == 0) {
-                new_level = pre_node->level + 1;
-                rdg_node->flags |= RDG_NODE_LEVEL_SET;
+    // a node is queued when its level is first set, and the top node may be
+    // queued once more before that, so size + 1 ids always fit
+    uint32_t * queue = malloc(sizeof(uint32_t) * (csr->size + 1));
+    size_t head = 0;
+    size_t tail = 0;
+
+    queue[tail++] = top;
+
+    while (head < tail) {
+        uint32_t id = queue[head++];
+        struct _rdg_node * rdg_node = csr->data[id];
+
+        size_t i;
+        for (i = csr->successors_offset[id];
+             i < csr->successors_offset[id + 1];
+             i++) {
+            struct _rdg_node * tail_node = csr->data[csr->successors[i]];
+            if (rdg_node->level + 1 > tail_node->level) {
+                tail_node->level = rdg_node->level + 1;
             }
-            else if (pre_node->level + 1 > new_level) {
-                new_level = pre_node->level + 1;
+            if ((tail_node->flags & RDG_NODE_LEVEL_SET) == 0) {
+                queue[tail++] = csr->successors[i];
             }
-        }
-    }
-    object_delete(predecessors);
-
-    if (rdg_node->flags & RDG_NODE_LEVEL_SET) {
-        rdg_node->level = new_level;
-    }
-}
-
-
-void rdg_node_assign_level_by_successor (struct _graph_node * node)
-{
-    struct _rdg_node * rdg_node = node->data;
-    struct _graph_edge * edge;
-    struct _list_it * it;
-    int new_level = -3;
-
-    printf("rdg_node_assign_level_by_successor %llx\n", 
-           (unsigned long long) node->index);
-
-    if (rdg_node->flags & RDG_NODE_LEVEL_SET)
-        return;
-
-    // get lowest level of predecessors
-    struct _list * successors = graph_node_successors(node);
-    for (it = list_iterator(successors); it != NULL; it = it->next) {
-        edge = it->data;
-        struct _rdg_node * suc_node = graph_fetch_data(node->graph, edge->tail);
-
-        printf("%llx (%d) -> %llx (%d)\n",
-               (unsigned long long) rdg_node->index, rdg_node->flags,
-               (unsigned long long) suc_node->index, suc_node->flags);
-
-        // loops don't count
-        if (edge->head == edge->tail)
-            continue;
-
-        // if this successor has not had its level assigned yet, conduct a
-        // recursive call to assign its sucessors and then itself
-        if ((suc_node->flags & RDG_NODE_LEVEL_SET) == 0) {
-            rdg_node_assign_level_by_successor(
-                                    graph_fetch_node(node->graph, edge->tail));
+            tail_node->flags |= RDG_NODE_LEVEL_SET;
         }
 
-        if (suc_node->flags & RDG_NODE_LEVEL_SET) {
-            new_level = suc_node->level - 1;
-            rdg_node->flags |= RDG_NODE_LEVEL_SET;
+        for (i = csr->predecessors_offset[id];
+             i < csr->predecessors_offset[id + 1];
+             i++) {
+            struct _rdg_node * head_node = csr->data[csr->predecessors[i]];
+            if ((head_node->flags & RDG_NODE_LEVEL_SET) == 0) {
+                head_node->level = rdg_node->level - 1;
+                queue[tail++] = csr->predecessors[i];
+            }
+            head_node->flags |= RDG_NODE_LEVEL_SET;
         }
     }
-    object_delete(successors);
 
-    rdg_node->level = new_level;
+    free(queue);
+    object_delete(csr);
 }
 
 
@@ -699,12 +675,6 @@ void rdg_assign_levels (struct _graph * graph, uint64_t top_index)
 
     // set level of entry
     rdg_assign_levels2(graph, top_index);
-    //rdg_node = graph_fetch_data(graph, top_index);
-    //rdg_node->flags |= RDG_NODE_LEVEL_SET;
-
-    // set node levels
-    //graph_bfs(graph, top_index, rdg_node_assign_level);
-    //graph_map(graph, rdg_node_assign_level_by_successor);
 
     // adjust for negative levels
     int lowest_level = 0;
@@ -749,15 +719,13 @@ void rdg_assign_level_map (struct _rdg * rdg)
         // if this level does not exist, create it
         if (map_fetch(rdg->levels, rdg_node->level) == NULL) {
             struct _map * new_level_map = map_create();
-            map_insert(rdg->levels, rdg_node->level, new_level_map);
-            object_delete(new_level_map);
+            map_insert_take(rdg->levels, rdg_node->level, new_level_map);
         }
 
         // insert this node's index into it's level's map
         struct _map * level_map = map_fetch(rdg->levels, rdg_node->level);
         struct _index * index = index_create(rdg_node->index);
-        map_insert(level_map, level_map->size, index);
-        object_delete(index);
+        map_insert_take(level_map, level_map->size, index);
     }
 }
 
@@ -797,7 +765,8 @@ void rdg_create_virtual_nodes (struct _rdg * rdg)
 
         struct _rdg_node * rdg_head = node->data;
 
-        // for each successor
+        // for each successor. this loop removes and adds successors of node,
+        // so it walks a copy of them
         struct _list * successors = graph_node_successors(node);
         struct _list_it * list_it;
         for (list_it = list_iterator(successors);
@@ -889,14 +858,10 @@ void rdg_remove_virtual_nodes (struct _rdg * rdg)
         }
         uint64_t successor_index = -1;
         uint64_t predecessor_index = -1;
-        struct _list_it * eit;
-        for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-            struct _graph_edge * edge = eit->data;
-            if (edge->head == node->index)
-                successor_index = edge->tail;
-            else
-                predecessor_index = edge->head;
-        }
+        if (node->successors.size > 0)
+            successor_index = node->successors.edges[node->successors.size - 1]->tail;
+        if (node->predecessors.size > 0)
+            predecessor_index = node->predecessors.edges[node->predecessors.size - 1]->head;
 
         if ((successor_index == -1) || (predecessor_index == -1)) {
             fprintf(stderr, "-1 edge index in rdg_destroy_virtual_nodes\n");
@@ -1061,15 +1026,20 @@ void rdg_assign_x (struct _rdg * rdg)
 
             int above_sum = 0;
             int above_n   = 0;
-            struct _list_it * eit;
-            for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-                struct _graph_edge * edge = eit->data;
+            size_t i;
+            for (i = 0; i < node->successors.size; i++) {
                 struct _rdg_node * neighbor;
-                if (edge->head == node->index)
-                    neighbor = graph_fetch_data(rdg->graph, edge->tail);
-                else
-                    neighbor = graph_fetch_data(rdg->graph, edge->head);
-
+                neighbor = graph_fetch_data(rdg->graph,
+                                            node->successors.edges[i]->tail);
+                if (neighbor->level < rdg_node->level) {
+                    above_sum += rdg_node_center_x(neighbor);
+                    above_n++;
+                }
+            }
+            for (i = 0; i < node->predecessors.size; i++) {
+                struct _rdg_node * neighbor;
+                neighbor = graph_fetch_data(rdg->graph,
+                                            node->predecessors.edges[i]->head);
                 if (neighbor->level < rdg_node->level) {
                     above_sum += rdg_node_center_x(neighbor);
                     above_n++;
@@ -1099,15 +1069,20 @@ void rdg_assign_x (struct _rdg * rdg)
 
             int below_sum = 0;
             int below_n   = 0;
-            struct _list_it * eit;
-            for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-                struct _graph_edge * edge = eit->data;
+            size_t i;
+            for (i = 0; i < node->successors.size; i++) {
                 struct _rdg_node * neighbor;
-                if (edge->head == node->index)
-                    neighbor = graph_fetch_data(rdg->graph, edge->tail);
-                else
-                    neighbor = graph_fetch_data(rdg->graph, edge->head);
-
+                neighbor = graph_fetch_data(rdg->graph,
+                                            node->successors.edges[i]->tail);
+                if (neighbor->level > rdg_node->level) {
+                    below_sum += rdg_node_center_x(neighbor);
+                    below_n++;
+                }
+            }
+            for (i = 0; i < node->predecessors.size; i++) {
+                struct _rdg_node * neighbor;
+                neighbor = graph_fetch_data(rdg->graph,
+                                            node->predecessors.edges[i]->head);
                 if (neighbor->level > rdg_node->level) {
                     below_sum += rdg_node_center_x(neighbor);
                     below_n++;
@@ -1255,12 +1230,10 @@ inline void rdg_swap_node_positions (struct _rdg * rdg,
     map_remove(level_map, right);
 
     index = index_create(rdg_right_node->index);
-    map_insert(level_map, left, index);
-    object_delete(index);
+    map_insert_take(level_map, left, index);
 
     index = index_create(rdg_left_node->index);
-    map_insert(level_map, right, index);
-    object_delete(index);
+    map_insert_take(level_map, right, index);
 }
 
 
@@ -1271,14 +1244,16 @@ double rdg_node_adjacent_center (struct _rdg * rdg, struct _rdg_node * rdg_node)
     double n   = 0;
 
     struct _graph_node * node = graph_fetch_node(rdg->graph, rdg_node->index);
-    struct _list_it * it;
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
+    size_t i;
+    for (i = 0; i < node->successors.size; i++) {
         struct _rdg_node * rdg_adjacent;
-        if (edge->head == rdg_node->index)
-            rdg_adjacent = graph_fetch_data(rdg->graph, edge->tail);
-        else
-            rdg_adjacent = graph_fetch_data(rdg->graph, edge->head);
+        rdg_adjacent = graph_fetch_data(rdg->graph, node->successors.edges[i]->tail);
+        n   += 1.0;
+        sum += rdg_adjacent->position;
+    }
+    for (i = 0; i < node->predecessors.size; i++) {
+        struct _rdg_node * rdg_adjacent;
+        rdg_adjacent = graph_fetch_data(rdg->graph, node->predecessors.edges[i]->head);
         n   += 1.0;
         sum += rdg_adjacent->position;
     }
@@ -1438,14 +1413,8 @@ void rdg_draw_edge (struct _rdg * rdg,
     while (last_node->flags & RDG_NODE_VIRTUAL) {
         struct _graph_node * node = graph_fetch_node(rdg->graph, last_node->index);
         last_node = NULL;
-        struct _list_it * it;
-        for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            if (edge->head == node->index) {
-                last_node = graph_fetch_data(rdg->graph, edge->tail);
-                break;
-            }
-        }
+        if (node->successors.size > 0)
+            last_node = graph_fetch_data(rdg->graph, node->successors.edges[0]->tail);
         if (last_node == NULL)
             return;
     }
@@ -1510,8 +1479,7 @@ void rdg_draw_edge (struct _rdg * rdg,
 
             if (index == NULL) {
                 index = index_create(3);
-                map_insert(level_spacings, next_node->level, index);
-                object_delete(index);
+                map_insert_take(level_spacings, next_node->level, index);
                 spacing = 4.0;
             }
             else {
@@ -1568,14 +1536,8 @@ void rdg_draw_edge (struct _rdg * rdg,
 
         struct _graph_node * node = graph_fetch_node(rdg->graph, next_node->index);
         next_node = NULL;
-        struct _list_it * it;
-        for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            if (edge->head == node->index) {
-                next_node = graph_fetch_data(rdg->graph, edge->tail);
-                break;
-            }
-        }
+        if (node->successors.size > 0)
+            next_node = graph_fetch_data(rdg->graph, node->successors.edges[0]->tail);
         if (next_node == NULL)
             return;
     }
@@ -1636,13 +1598,10 @@ void rdg_draw (struct _rdg * rdg)
             continue;
 
         // draw edges
-        struct _list_it * eit;
-        struct _list * successors = graph_node_successors(graph_it_node(graph_it));
-        for (eit = list_iterator(successors); eit != NULL; eit = eit->next) {
-            struct _graph_edge * edge = eit->data;
-            rdg_draw_edge(rdg, edge, level_edge_spacings);
-        }
-        object_delete(successors);
+        struct _graph_node * node = graph_it_node(graph_it);
+        size_t i;
+        for (i = 0; i < node->successors.size; i++)
+            rdg_draw_edge(rdg, node->successors.edges[i], level_edge_spacings);
     }
 
     object_delete(level_edge_spacings);
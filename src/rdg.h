@@ -5,6 +5,7 @@
 #include <inttypes.h>
 
 #include "graph.h"
+#include "graph_view.h"
 #include "index.h"
 #include "list.h"
 #include "map.h"
@@ -38,7 +39,6 @@ enum {
 #define RDG_ARROW_DEGREES 0.5
 
 #define RDG_NODE_VIRTUAL      (1 << 0)
-#define RDG_NODE_ACYCLIC      (1 << 1)
 #define RDG_NODE_LEVEL_SET    (1 << 2)
 #define RDG_NODE_POSITIONED   (1 << 4)
 
@@ -102,6 +102,10 @@ void rdg_debug (struct _rdg * rdg);
 struct _rdg * rdg_create (uint64_t        top_index,
                           struct _graph * graph,
                           struct _map   * labels);
+// like rdg_create, but draws the nodes of view, read from the graph it views
+struct _rdg * rdg_create_view (uint64_t             top_index,
+                               struct _graph_view * view,
+                               struct _map        * labels);
 void          rdg_delete (struct _rdg * rdg);
 struct _rdg * rdg_copy   (struct _rdg * rdg);
 
@@ -178,8 +182,12 @@ int rdg_node_sink_y   (struct _rdg * rdg,
                        struct _rdg_node * dst_node);
 
 // utility functions
-void rdg_acyclicize     (struct _graph * graph, uint64_t top_index);
-void rdg_acyclicize_pre (struct _graph * graph, uint64_t index);
+void rdg_acyclicize     (struct _graph      * graph,
+                         struct _graph_walk * walk,
+                         uint64_t             top_index);
+void rdg_acyclicize_pre (struct _graph      * graph,
+                         struct _graph_walk * walk,
+                         uint64_t             index);
 
 
 void rdg_node_level_zero         (struct _graph_node * node);
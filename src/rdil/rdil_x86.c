@@ -444,8 +444,7 @@ struct _rdil_operand * rdil_x86_operand (ud_t *   ud_obj,
             result = rdil_operand_create(RDIL_VAR, 32, -1);
             struct _rdil_ins * ins;
             ins = rdil_ins_create(RDIL_ADD, address, result, index_scale, base_displ);
-            list_append(list, ins);
-            object_delete(ins);
+            list_append_take(list, ins);
         }
         else {
             result = object_copy(base_displ);
@@ -579,8 +578,7 @@ void rdil_x86_operand_set (ud_t *   ud_obj,
     int full_reg = rdil_x86_full_reg(reg);
     struct _rdil_operand * dst = rdil_operand_create(RDIL_VAR, 32, full_reg);
     struct _rdil_ins     * ins = rdil_ins_create(RDIL_ASSIGN, address, dst, value);
-    list_append(list, ins);
-    object_delete(ins);
+    list_append_take(list, ins);
     object_delete(dst);
 
     return;
@@ -1,6 +1,7 @@
 #include "rdis.h"
 
 #include "buffer.h"
+#include "graph_csr.h"
 #include "gui.h"
 #include "index.h"
 #include "instruction.h"
@@ -56,10 +57,18 @@ struct _rdis * rdis_create_with_gui (_loader * loader,
     rdis_console(rdis, LANG_MEMORYLOADED);
 
     rdis->functions  = loader_functions(loader, rdis->memory);
+    rdis->function_index = NULL;
     printf("functions loaded\n");fflush(stdout);
     rdis_console(rdis, LANG_FUNCSLOADED);
 
     rdis->graph      = loader_graph_functions(loader, rdis->memory, rdis->functions);
+    rdis->graph_csr   = NULL;
+    rdis->graph_views = map_create();
+    rdis->ins_index   = NULL;
+    rdis->dominators      = map_create();
+    rdis->post_dominators = map_create();
+    rdis->xrefs           = NULL;
+    rdis->xrefs_dirty     = queue_create();
     printf("graph loaded\n");fflush(stdout);
     rdis_console(rdis, LANG_GRAPHLOADED);
 
@@ -69,6 +78,7 @@ struct _rdis * rdis_create_with_gui (_loader * loader,
 
     rdis_check_references(rdis);
     rdis_functions_bounds(rdis);
+    rdis_freeze_tables(rdis);
 
     // this should be the last thing done so startup script accesses a valid
     // rdis
@@ -81,8 +91,17 @@ struct _rdis * rdis_create_with_gui (_loader * loader,
 void rdis_delete (struct _rdis * rdis)
 {
     object_delete(rdis->callbacks);
+    rdis_graph_changed(rdis);
+    objects_delete(rdis->graph_views,
+                   rdis->dominators,
+                   rdis->post_dominators,
+                   rdis->xrefs_dirty,
+                   NULL);
+    if (rdis->xrefs != NULL)
+        object_delete(rdis->xrefs);
     object_delete(rdis->graph);
     object_delete(rdis->labels);
+    rdis_functions_changed(rdis);
     object_delete(rdis->functions);
     object_delete(rdis->memory);
     if (rdis->loader != NULL)
@@ -152,15 +171,45 @@ struct _rdis * rdis_deserialize (json_t * json)
     rdis->gui              = NULL;
     rdis->loader           = NULL;
     rdis->graph            = ggraph;
+    rdis->graph_csr        = NULL;
+    rdis->graph_views      = map_create();
+    rdis->ins_index        = NULL;
+    rdis->dominators       = map_create();
+    rdis->post_dominators  = map_create();
+    rdis->xrefs            = NULL;
+    rdis->xrefs_dirty      = queue_create();
     rdis->labels           = llabels;
     rdis->functions        = ffunctions;
+    rdis->function_index   = NULL;
     rdis->memory           = mmemory;
+    rdis_freeze_tables(rdis);
     rdis->rdis_lua         = rdis_lua_create(rdis);
 
     return rdis;
 }
 
 
+// returns 1 if reference is a constant which points into loaded memory
+int rdis_reference_addressable (struct _rdis * rdis, struct _reference * reference)
+{
+    if (reference->type != REFERENCE_CONSTANT)
+        return 0;
+
+    uint64_t lower;
+    struct _buffer * buffer = map_fetch_max_entry(rdis->memory,
+                                                  reference->address,
+                                                  &lower);
+    if (buffer == NULL)
+        return 0;
+    uint64_t upper = lower + buffer->size;
+    if (    (reference->address < lower)
+         || (reference->address >= upper))
+        return 0;
+
+    return 1;
+}
+
+
 void rdis_check_references (struct _rdis * rdis)
 {
     struct _graph_it * git;
@@ -174,79 +223,97 @@ void rdis_check_references (struct _rdis * rdis)
             struct _ins * ins = lit->data;
             struct _list_it * rit;
 
+            for (rit = list_iterator(ins->references); rit != NULL; rit = rit->next) {
+                if (rdis_reference_addressable(rdis, rit->data))
+                    break;
+            }
+            if (rit == NULL)
+                continue;
+
+            // this ins may be shared with other graphs, so we modify our own
+            lit->data = ins = object_own(ins);
+
             // for each reference
             for (rit = list_iterator(ins->references); rit != NULL; rit = rit->next) {
                 struct _reference * reference = rit->data;
 
-                if (reference->type == REFERENCE_CONSTANT) {
-                    uint64_t lower = map_fetch_max_key(rdis->memory, reference->address);
-                    struct _buffer * buffer = map_fetch(rdis->memory, lower);
-                    if (buffer == NULL)
-                        continue;
-                    uint64_t upper = lower + buffer->size;
-                    if (    (reference->address < lower)
-                         || (reference->address >= upper))
-                        continue;
+                if (rdis_reference_addressable(rdis, reference))
                     reference->type = REFERENCE_CONSTANT_ADDRESSABLE;
-                }
             }
         }
     }
 }
 
 
-struct _map * rdis_g_references (struct _rdis * rdis)
+// labels and functions are walked and searched every time the function list
+// is drawn, but only change when a function is added or removed
+void rdis_freeze_tables (struct _rdis * rdis)
 {
-    struct _map * references = map_create();
-
-    struct _graph_it * git;
-    // for each node
-    for (git = graph_iterator(rdis->graph); git != NULL; git = graph_it_next(git)) {
-        struct _graph_node * node = graph_it_node(git);
-        struct _list_it * lit;
+    map_freeze(rdis->labels);
+    map_freeze(rdis->functions);
+}
 
-        // for each instruction
-        for (lit = list_iterator(node->data); lit != NULL; lit = lit->next) {
-            struct _ins * ins = lit->data;
-            struct _list_it * rit;
 
-            // for each reference
-            for (rit = list_iterator(ins->references); rit != NULL; rit = rit->next) {
-                struct _reference * reference = rit->data;
-                int delete_reference = 0;
-
-                if (reference->type == REFERENCE_CONSTANT) {
-                    uint64_t lower = map_fetch_max_key(rdis->memory, reference->address);
-                    struct _buffer * buffer = map_fetch(rdis->memory, lower);
-                    if (buffer == NULL)
-                        continue;
-                    uint64_t upper = lower + buffer->size;
-                    if (    (reference->address < lower)
-                         || (reference->address >= upper))
-                        continue;
-                    reference = object_copy(reference);
-                    reference->type = REFERENCE_CONSTANT_ADDRESSABLE;
-                    delete_reference = 1;
-                }
+// files the references of every instruction in node with rdis->xrefs, in
+// place of whatever was filed for those instructions before. addressable
+// constants are filed as REFERENCE_CONSTANT_ADDRESSABLE, and other constants
+// are left out
+void rdis_xrefs_node (struct _rdis * rdis, struct _graph_node * node)
+{
+    struct _list_it * lit;
+    for (lit = list_iterator(node->data); lit != NULL; lit = lit->next) {
+        struct _ins   * ins = lit->data;
+        struct _list  * references = NULL;
+        struct _list_it * rit;
 
+        for (rit = list_iterator(ins->references); rit != NULL; rit = rit->next) {
+            struct _reference * reference = rit->data;
 
-                struct _list * ref_list = map_fetch(references, reference->address);
-                if (ref_list == NULL) {
-                    ref_list = list_create();
-                    map_insert(references, reference->address, ref_list);
-                    object_delete(ref_list);
-                    ref_list = map_fetch(references, reference->address);
-                }
+            if (    (reference->type == REFERENCE_CONSTANT)
+                 && (! rdis_reference_addressable(rdis, reference)))
+                continue;
 
-                list_append(ref_list, reference);
+            if (references == NULL)
+                references = list_create();
 
-                if (delete_reference)
-                    object_delete(reference);
-            }
+            reference = object_copy(reference);
+            if (reference->type == REFERENCE_CONSTANT)
+                reference->type = REFERENCE_CONSTANT_ADDRESSABLE;
+            list_append_take(references, reference);
         }
+
+        if (references == NULL)
+            xref_index_remove(rdis->xrefs, ins->address);
+        else
+            xref_index_set(rdis->xrefs, ins->address, references);
     }
+}
+
+
+struct _xref_index * rdis_xrefs (struct _rdis * rdis)
+{
+    if (rdis->xrefs == NULL) {
+        rdis->xrefs = xref_index_create();
+
+        struct _graph_it * it;
+        for (it = graph_iterator(rdis->graph); it != NULL; it = graph_it_next(it))
+            rdis_xrefs_node(rdis, graph_it_node(it));
 
-    return references;
+        object_delete(rdis->xrefs_dirty);
+        rdis->xrefs_dirty = queue_create();
+    }
+
+    // the references of dirty nodes were dropped when they were marked, so
+    // nodes which are gone now have nothing left to do
+    while (rdis->xrefs_dirty->size > 0) {
+        struct _index * index = queue_peek(rdis->xrefs_dirty);
+        struct _graph_node * node = graph_fetch_node(rdis->graph, index->index);
+        if (node != NULL)
+            rdis_xrefs_node(rdis, node);
+        queue_pop(rdis->xrefs_dirty);
+    }
+
+    return rdis->xrefs;
 }
 
 
@@ -281,6 +348,175 @@ void rdis_clear_gui (struct _rdis * rdis)
 }
 
 
+// the snapshot of rdis->graph views are read from, frozen when first needed
+struct _graph_csr * rdis_graph_csr (struct _rdis * rdis)
+{
+    if (rdis->graph_csr == NULL)
+        rdis->graph_csr = graph_freeze(rdis->graph);
+    return rdis->graph_csr;
+}
+
+
+struct _graph_view * rdis_graph_view (struct _rdis * rdis, uint64_t index)
+{
+    struct _graph_view * view = map_fetch(rdis->graph_views, index);
+    if (view != NULL)
+        return view;
+
+    struct _graph_csr * csr = rdis_graph_csr(rdis);
+    if (csr == NULL)
+        return NULL;
+
+    view = graph_view_family(rdis->graph, csr, index);
+    if (view == NULL)
+        return NULL;
+
+    map_insert_take(rdis->graph_views, index, view);
+
+    return view;
+}
+
+
+struct _ins_index * rdis_ins_index (struct _rdis * rdis)
+{
+    if ((rdis->ins_index == NULL) && (rdis->graph != NULL))
+        rdis->ins_index = ins_index_create(rdis->graph);
+    return rdis->ins_index;
+}
+
+
+void rdis_graph_changed (struct _rdis * rdis)
+{
+    object_delete(rdis->graph_views);
+    rdis->graph_views = map_create();
+
+    if (rdis->ins_index != NULL) {
+        object_delete(rdis->ins_index);
+        rdis->ins_index = NULL;
+    }
+
+    if (rdis->graph_csr != NULL) {
+        object_delete(rdis->graph_csr);
+        rdis->graph_csr = NULL;
+    }
+}
+
+
+struct _graph_dom * rdis_dom (struct _rdis * rdis,
+                              struct _map  * trees,
+                              uint64_t       address,
+                              int            post)
+{
+    struct _graph_dom * dom = map_fetch(trees, address);
+    if (dom != NULL)
+        return dom;
+
+    struct _graph_csr * csr = rdis_graph_csr(rdis);
+    if (csr == NULL)
+        return NULL;
+
+    if (post)
+        dom = graph_post_dominators(csr, address);
+    else
+        dom = graph_dominators(csr, address);
+    if (dom == NULL)
+        return NULL;
+
+    map_insert_take(trees, address, dom);
+
+    return dom;
+}
+
+
+struct _graph_dom * rdis_dominators (struct _rdis * rdis, uint64_t address)
+{
+    return rdis_dom(rdis, rdis->dominators, address, 0);
+}
+
+
+struct _graph_dom * rdis_post_dominators (struct _rdis * rdis, uint64_t address)
+{
+    return rdis_dom(rdis, rdis->post_dominators, address, 1);
+}
+
+
+// removes the trees in trees which hold the node at index. this looks at every
+// cached tree, but each look takes constant time
+void rdis_dom_drop (struct _map * trees, uint64_t index)
+{
+    struct _queue  * queue = queue_create();
+    struct _map_it * it;
+
+    for (it = map_iterator(trees); it != NULL; it = map_it_next(it)) {
+        if (graph_dom_contains(map_it_data(it), index))
+            queue_push_take(queue, index_create(map_it_key(it)));
+    }
+
+    while (queue->size > 0) {
+        struct _index * key = queue_peek(queue);
+        map_remove(trees, key->index);
+        queue_pop(queue);
+    }
+
+    object_delete(queue);
+}
+
+
+void rdis_node_changed (struct _rdis * rdis, uint64_t index)
+{
+    rdis_dom_drop(rdis->dominators, index);
+    rdis_dom_drop(rdis->post_dominators, index);
+
+    if (rdis->xrefs == NULL)
+        return;
+
+    struct _graph_node * node = graph_fetch_node(rdis->graph, index);
+    if (node != NULL) {
+        struct _list_it * it;
+        for (it = list_iterator(node->data); it != NULL; it = it->next) {
+            struct _ins * ins = it->data;
+            xref_index_remove(rdis->xrefs, ins->address);
+        }
+    }
+    queue_push_take(rdis->xrefs_dirty, index_create(index));
+}
+
+
+// the nodes of graph are about to be merged into rdis->graph, where they
+// replace nodes at the same index and truncate_blocks may cut the blocks they
+// start in
+void rdis_nodes_merging (struct _rdis * rdis, struct _graph * graph)
+{
+    struct _graph_it * it;
+    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
+        uint64_t index = graph_it_index(it);
+        rdis_node_changed(rdis, index);
+
+        struct _graph_node * node = graph_fetch_node_max(rdis->graph, index);
+        if ((node != NULL) && (node->index != index))
+            rdis_node_changed(rdis, node->index);
+    }
+}
+
+
+void rdis_graph_reset (struct _rdis * rdis)
+{
+    rdis_graph_changed(rdis);
+
+    object_delete(rdis->dominators);
+    object_delete(rdis->post_dominators);
+    rdis->dominators      = map_create();
+    rdis->post_dominators = map_create();
+
+    if (rdis->xrefs != NULL) {
+        object_delete(rdis->xrefs);
+        rdis->xrefs = NULL;
+    }
+
+    rdis_functions_changed(rdis);
+}
+
+
 int rdis_user_function (struct _rdis * rdis, uint64_t address)
 {
     // get a tree of all functions reachable at this address
@@ -290,8 +526,7 @@ int rdis_user_function (struct _rdis * rdis, uint64_t address)
 
     // add in this address as a new function as well
     struct _function * function = function_create(address);
-    map_insert(functions, function->address, function);
-    object_delete(function);
+    map_insert_take(functions, function->address, function);
 
     // for each newly reachable function
     struct _map_it * mit;
@@ -310,13 +545,14 @@ int rdis_user_function (struct _rdis * rdis, uint64_t address)
         struct _label * label = loader_label_address(rdis->loader,
                                                      rdis->memory,
                                                      fitaddress);
-        map_insert(rdis->labels, fitaddress, label);
-        object_delete(label);
+        map_insert_take(rdis->labels, fitaddress, label);
 
         // if this function is already in our graph, all we need to do is make
         // sure its a separate node and then remove function predecessors
         struct _graph_node * node = graph_fetch_node_max(rdis->graph, fitaddress);
         if (node != NULL) {
+            // the node is either split or loses its function predecessors
+            rdis_node_changed(rdis, node->index);
 
             // already a node, remove function predecessors
             if (node->index == address) {
@@ -342,22 +578,19 @@ int rdis_user_function (struct _rdis * rdis, uint64_t address)
                             break;
                     }
                     // create a new graph node for this new function
+                    rdis_node_changed(rdis, fitaddress);
                     graph_add_node(rdis->graph, fitaddress, new_ins_list);
                     // all graph successors from old node are added to new node
-                    struct _queue   * queue      = queue_create();
-                    struct _list    * successors = graph_node_successors(node);
-                    struct _list_it * sit;
-                    for (sit = list_iterator(successors);
-                         sit != NULL;
-                         sit = sit->next) {
-                        struct _graph_edge * edge = sit->data;
+                    struct _queue * queue = queue_create();
+                    size_t i;
+                    for (i = 0; i < node->successors.size; i++) {
+                        struct _graph_edge * edge = node->successors.edges[i];
                         graph_add_edge(rdis->graph,
                                        fitaddress,
                                        edge->tail,
                                        edge->data);
                         queue_push(queue, edge);
                     }
-                    object_delete(successors);
 
                     // and removed from old node
                     while (queue->size > 0) {
@@ -379,12 +612,18 @@ int rdis_user_function (struct _rdis * rdis, uint64_t address)
         struct _graph * graph = loader_graph_address(rdis->loader,
                                                      rdis->memory,
                                                      fitaddress);
-        graph_merge(rdis->graph, graph);
-        object_delete(graph);
+        rdis_nodes_merging(rdis, graph);
+        graph_merge_take(rdis->graph, graph);
+        truncate_blocks(rdis->graph);
     }
 
+    rdis_graph_changed(rdis);
+    rdis_functions_changed(rdis);
+
     object_delete(functions);
 
+    rdis_freeze_tables(rdis);
+
     rdis_callback(rdis, RDIS_CALLBACK_ALL);
 
     return 0;
@@ -395,26 +634,27 @@ int rdis_remove_function (struct _rdis * rdis, uint64_t address)
 {
     map_remove(rdis->functions, address);
     map_remove(rdis->labels, address);
+    rdis_functions_changed(rdis);
 
-    struct _graph * family = graph_family(rdis->graph, address);
+    struct _graph_view * family = rdis_graph_view(rdis, address);
     if (family == NULL)
         return -1;
 
-    struct _graph_it * it;
-
-    for (it = graph_iterator(family); it != NULL; it = graph_it_next(it)) {
-        struct _graph_node * node = graph_it_node(it);
-
-        printf("rdis_remove_function %p %p %p %llx\n",
-               node,
-               node->data,
-               node->edges,
-               (unsigned long long) node->index);
+    // indexes are read from the snapshot, so the view survives the nodes it
+    // names being removed. it is dropped with the rest once we are done
+    size_t i;
+    for (i = 0; i < family->size; i++) {
+        printf("rdis_remove_function %p %llx\n",
+               graph_view_data(family, i),
+               (unsigned long long) graph_view_index(family, i));
 
-        graph_remove_node(rdis->graph, node->index);
+        rdis_node_changed(rdis, graph_view_index(family, i));
+        graph_remove_node(rdis->graph, graph_view_index(family, i));
     }
 
-    object_delete(family);
+    rdis_graph_changed(rdis);
+
+    rdis_freeze_tables(rdis);
 
     rdis_callback(rdis, RDIS_CALLBACK_GRAPH
                         | RDIS_CALLBACK_FUNCTION
@@ -426,7 +666,7 @@ int rdis_remove_function (struct _rdis * rdis, uint64_t address)
 
 int rdis_function_reachable (struct _rdis * rdis, uint64_t address)
 {
-    struct _function * function = map_fetch(rdis->functions, address);
+    struct _function * function = map_fetch_own(rdis->functions, address);
     if (function == NULL)
         return -1;
     function->flags |= FUNCTION_REACHABLE;
@@ -445,7 +685,7 @@ int rdis_function_reachable (struct _rdis * rdis, uint64_t address)
             if (    (ins->flags & (INS_TARGET_SET | INS_CALL))
                  == (INS_TARGET_SET | INS_CALL)) {
 
-                function = map_fetch(rdis->functions, ins->target);
+                function = map_fetch_own(rdis->functions, ins->target);
                 if (function == NULL)
                     continue;
                 function->flags |= FUNCTION_REACHABLE;
@@ -457,14 +697,31 @@ int rdis_function_reachable (struct _rdis * rdis, uint64_t address)
 }
 
 
+// widens lower and upper to cover every instruction in ins_list
+void rdis_ins_list_bounds (struct _list * ins_list,
+                           uint64_t     * lower,
+                           uint64_t     * upper)
+{
+    struct _list_it * it;
+    for (it = list_iterator(ins_list); it != NULL; it = it->next) {
+        struct _ins * ins = it->data;
+
+        if (ins->address < *lower)
+            *lower = ins->address;
+        if (ins->address + ins->size > *upper)
+            *upper = ins->address + ins->size;
+    }
+}
+
+
 int rdis_function_bounds (struct _rdis * rdis, uint64_t address)
 {
-    struct _function * function = map_fetch(rdis->functions, address);
+    struct _function * function = map_fetch_own(rdis->functions, address);
     
     if (function == NULL)
         return -1;
 
-    struct _graph * family = graph_family(rdis->graph, address);
+    struct _graph_view * family = rdis_graph_view(rdis, address);
 
     if (family == NULL)
         return -1;
@@ -472,45 +729,96 @@ int rdis_function_bounds (struct _rdis * rdis, uint64_t address)
     uint64_t lower = -1;
     uint64_t upper = 0;
 
-    struct _graph_it * it;
-    for (it = graph_iterator(family); it != NULL; it = graph_it_next(it)) {
-        struct _graph_node * node = graph_it_node(it);
-        struct _list * ins_list   = node->data;
-        struct _list_it * iit;
-        for (iit = list_iterator(ins_list); iit != NULL; iit = iit->next) {
-            struct _ins * ins = iit->data;
-
-            if (ins->address < lower)
-                lower = ins->address;
-            if (ins->address + ins->size > upper)
-                upper = ins->address + ins->size;
-        }
-    }
-
-    object_delete(family);
+    size_t i;
+    for (i = 0; i < family->size; i++)
+        rdis_ins_list_bounds(graph_view_data(family, i), &lower, &upper);
 
     function->bounds.lower = lower;
     function->bounds.upper = upper;
+    rdis_functions_changed(rdis);
 
     return 0;
 }
 
 
-int rdis_functions_bounds (struct _rdis * rdis)
+// sets the bounds of every function in functions. rather than copy out the
+// family of each function, each family is walked over the snapshot views
+// share, reusing one visited set
+int rdis_functions_bounds_map (struct _rdis * rdis, struct _map * functions)
 {
-    struct _map_it * it;
+    struct _graph_csr * csr = rdis_graph_csr(rdis);
+    if (csr == NULL)
+        return -1;
+
+    uint64_t * visited = graph_csr_visited_create(csr);
+    uint32_t * ids     = malloc(sizeof(uint32_t) * csr->size);
     int result = 0;
 
-    for (it = map_iterator(rdis->functions); it != NULL; it = map_it_next(it)) {
-        struct _function * function = map_it_data(it);
+    struct _map_it * it;
+    for (it = map_iterator(functions); it != NULL; it = map_it_next(it)) {
+        uint64_t address = ((struct _function *) map_it_data(it))->address;
+        struct _function * function = map_fetch_own(rdis->functions, address);
+        uint32_t id = graph_csr_id(csr, address);
+
+        if ((function == NULL) || (id == GRAPH_CSR_NONE)) {
+            result = -1;
+            continue;
+        }
+
+        size_t ids_n = graph_csr_family(csr, id, visited, ids);
+
+        uint64_t lower = -1;
+        uint64_t upper = 0;
+
+        size_t i;
+        for (i = 0; i < ids_n; i++)
+            rdis_ins_list_bounds(csr->data[ids[i]], &lower, &upper);
 
-        result |= rdis_function_bounds(rdis, function->address);
+        graph_csr_visited_clear(visited, ids, ids_n);
+
+        function->bounds.lower = lower;
+        function->bounds.upper = upper;
     }
 
+    free(visited);
+    free(ids);
+
+    rdis_functions_changed(rdis);
+
     return result;
 }
 
 
+struct _function_index * rdis_function_index (struct _rdis * rdis)
+{
+    if (rdis->function_index == NULL)
+        rdis->function_index = function_index_create(rdis->functions);
+    return rdis->function_index;
+}
+
+
+void rdis_functions_changed (struct _rdis * rdis)
+{
+    if (rdis->function_index != NULL) {
+        object_delete(rdis->function_index);
+        rdis->function_index = NULL;
+    }
+}
+
+
+int rdis_functions_bounds (struct _rdis * rdis)
+{
+    return rdis_functions_bounds_map(rdis, rdis->functions);
+}
+
+
+// function_index_overlap callback for rdis_update_memory
+void rdis_queue_function (uint64_t address, void * queue)
+{
+    queue_push_take(queue, index_create(address));
+}
+
+
 int rdis_update_memory (struct _rdis *   rdis,
                         uint64_t         address,
                         struct _buffer * buffer)
@@ -520,26 +828,22 @@ int rdis_update_memory (struct _rdis *   rdis,
 
     mem_map_set (rdis->memory, address, buffer);
 
-    // we will regraph functions whose bounds fall within this updated memory,
-    // and all functions whose bounds fall within the bounds of functions to be
+    // we will regraph functions whose bounds overlap this updated memory,
+    // and all functions whose bounds overlap the bounds of functions to be
     // regraphed (step 2 simplifies things later on)
+    struct _function_index * function_index = rdis_function_index(rdis);
     struct _queue * queue = queue_create();
     struct _map_it * it;
-    for (it = map_iterator(rdis->functions); it != NULL; it = map_it_next(it)) {
-        struct _function * function = map_it_data(it);
-        if (    (    (function->bounds.lower >= address)
-                  && (function->bounds.lower <  address + buffer->size))
-             || (    (function->bounds.upper >= address)
-                  && (function->bounds.upper <  address + buffer->size))
-             || (    (function->bounds.lower <= address)
-                  && (function->bounds.upper >= address + buffer->size))) {
-            queue_push(queue, function);
-        }
-    }
+    function_index_overlap(function_index,
+                           address,
+                           address + buffer->size,
+                           rdis_queue_function,
+                           queue);
 
     struct _map * regraph_functions = map_create();
     while (queue->size > 0) {
-        struct _function * function = queue_peek(queue);
+        struct _index * index = queue_peek(queue);
+        struct _function * function = map_fetch(rdis->functions, index->index);
 
         if (map_fetch(regraph_functions, function->address) != NULL) {
             queue_pop(queue);
@@ -550,18 +854,13 @@ int rdis_update_memory (struct _rdis *   rdis,
                (unsigned long long) function->address);
 
         map_insert(regraph_functions, function->address, function);
+        queue_pop(queue);
 
-        for (it = map_iterator(rdis->functions); it != NULL; it = map_it_next(it)) {
-            struct _function * cmp_function = map_it_data(it);
-
-            if (    (    (cmp_function->bounds.lower >= function->bounds.lower)
-                      && (cmp_function->bounds.lower <  function->bounds.upper))
-                 || (    (cmp_function->bounds.upper >= function->bounds.lower)
-                      && (cmp_function->bounds.upper <  function->bounds.upper))
-                 || (    (cmp_function->bounds.lower <= function->bounds.lower)
-                      && (cmp_function->bounds.upper >= function->bounds.upper)))
-                queue_push(queue, cmp_function);
-        }
+        function_index_overlap(function_index,
+                               function->bounds.lower,
+                               function->bounds.upper,
+                               rdis_queue_function,
+                               queue);
     }
 
     // regraph dem functions
@@ -572,18 +871,29 @@ int rdis_update_memory (struct _rdis *   rdis,
 
     // We are now going to go through all nodes in our regraph functions. We
     // will copy over comments to the new instructions and then remove the
-    // regraph function nodes from the original graph
+    // regraph function nodes from the original graph. Families are read from
+    // one snapshot and nodes are only removed once every family is queued.
+    // Two functions are either in the same family or in disjoint ones, so a
+    // family whose first node is queued already is skipped
+    struct _ins_index * new_index = ins_index_create(new_graph);
+    uint64_t * queued = NULL;
     for (it = map_iterator(regraph_functions); it != NULL; it = map_it_next(it)) {
-        struct _function * function = map_it_data(it);
-        struct _graph    * family   = graph_family(rdis->graph, function->address);
+        struct _function   * function = map_it_data(it);
+        struct _graph_view * family   = rdis_graph_view(rdis, function->address);
         if (family == NULL)
             continue;
 
-        struct _graph_it * git;
-        for (git  = graph_iterator(family);
-             git != NULL;
-             git  = graph_it_next(git)) {
-            struct _list * ins_list = graph_it_data(git);
+        if (queued == NULL)
+            queued = graph_csr_visited_create(family->csr);
+        if (GRAPH_CSR_VISITED(queued, family->ids[0]))
+            continue;
+
+        size_t i;
+        for (i = 0; i < family->size; i++) {
+            uint32_t id = family->ids[i];
+            queued[id >> 6] |= (uint64_t) 1 << (id & 63);
+
+            struct _list * ins_list = graph_view_data(family, i);
             struct _list_it * iit;
             for (iit = list_iterator(ins_list); iit != NULL; iit = iit->next) {
                 struct _ins * ins = iit->data;
@@ -591,9 +901,11 @@ int rdis_update_memory (struct _rdis *   rdis,
                 if (ins->comment == NULL)
                     continue;
 
-                struct _ins * new_ins = graph_fetch_ins(new_graph, ins->address);
+                struct _ins * new_ins = ins_index_fetch(new_index,
+                                                        new_graph,
+                                                        ins->address);
 
-                if (ins->size != new_ins->size)
+                if ((new_ins == NULL) || (ins->size != new_ins->size))
                     continue;
 
                 if (memcmp(ins->bytes, new_ins->bytes, ins->size) == 0) {
@@ -603,30 +915,30 @@ int rdis_update_memory (struct _rdis *   rdis,
                 }
             }
             // add node for deletion
-            struct _index * index = index_create(graph_it_index(git));
-            queue_push(queue, index);
-            object_delete(index);
+            struct _index * index = index_create(graph_view_index(family, i));
+            queue_push_take(queue, index);
         }
+    }
+    free(queued);
+    object_delete(new_index);
 
-        object_delete(family);
-
-        while (queue->size > 0) {
-            struct _index * index = queue_peek(queue);
-            graph_remove_node(rdis->graph, index->index);
-            queue_pop(queue);
-        }
+    while (queue->size > 0) {
+        struct _index * index = queue_peek(queue);
+        rdis_node_changed(rdis, index->index);
+        graph_remove_node(rdis->graph, index->index);
+        queue_pop(queue);
     }
 
     // merge the new graph with the old graph
-    graph_merge(rdis->graph, new_graph);
+    rdis_nodes_merging(rdis, new_graph);
+    graph_merge_take(rdis->graph, new_graph);
+    truncate_blocks(rdis->graph);
+    rdis_graph_changed(rdis);
 
     // reset bounds of these functions
-    for (it = map_iterator(regraph_functions); it != NULL; it = map_it_next(it)) {
-        struct _function * function = map_it_data(it);
-        rdis_function_bounds(rdis, function->address);
-    }
+    rdis_functions_bounds_map(rdis, regraph_functions);
 
-    objects_delete(queue, new_graph, regraph_functions, NULL);
+    objects_delete(queue, regraph_functions, NULL);
 
     rdis_callback(rdis, RDIS_CALLBACK_ALL);
 
@@ -647,8 +959,7 @@ uint64_t rdis_add_callback (struct _rdis * rdis,
     printf("adding callback %p %p %llx\n",
            rc->callback, rc->data, (unsigned long long) rc->identifier);
 
-    map_insert(rdis->callbacks, identifier, rc);
-    object_delete(rc);
+    map_insert_take(rdis->callbacks, identifier, rc);
 
     return identifier;
 }
@@ -664,6 +975,10 @@ void rdis_callback (struct _rdis * rdis, int type_mask)
 {
     struct _map_it * it;
 
+    // callbacks are about to ask for views of the new graph
+    if (type_mask & RDIS_CALLBACK_GRAPH)
+        rdis_graph_changed(rdis);
+
     for (it = map_iterator(rdis->callbacks); it != NULL; it = map_it_next(it)) {
         struct _rdis_callback * rc = map_it_data(it);
 
@@ -2,12 +2,18 @@
 #define rdis_HEADER
 
 #include "buffer.h"
+#include "function_index.h"
 #include "graph.h"
+#include "graph_dom.h"
+#include "graph_view.h"
+#include "ins_index.h"
 #include "loader.h"
 #include "map.h"
 #include "object.h"
+#include "queue.h"
 #include "rdis_lua.h"
 #include "tree.h"
+#include "xref_index.h"
 
 #define RDIS_CALLBACK(XX) ((void (*) (void *)) XX)
 
@@ -39,8 +45,25 @@ struct _rdis {
 
     _loader          * loader;
     struct _graph    * graph;
+    // families in graph, cached by index until graph changes
+    struct _graph_csr * graph_csr;
+    struct _map       * graph_views;
+    // instructions in graph by address, built when first needed and dropped
+    // with the views
+    struct _ins_index * ins_index;
+    // dominator and post-dominator trees, cached by function address until
+    // a node in the function changes
+    struct _map       * dominators;
+    struct _map       * post_dominators;
+    // references by address and by instruction. nodes whose references are
+    // out of date wait in xrefs_dirty until the index is next read
+    struct _xref_index * xrefs;
+    struct _queue      * xrefs_dirty;
     struct _map      * labels;
     struct _map      * functions;
+    // functions by bounds, built when first needed and dropped when bounds
+    // or functions change
+    struct _function_index * function_index;
     struct _map      * memory;
     struct _rdis_lua * rdis_lua;
 };
@@ -56,7 +79,13 @@ json_t *       rdis_serialize    (struct _rdis * rdis);
 struct _rdis * rdis_deserialize  (json_t * json);
 
 void           rdis_check_references (struct _rdis * rdis);
-struct _map *  rdis_g_references     (struct _rdis * rdis);
+// freezes labels and functions into their read optimized form. they thaw
+// themselves on the next write
+void           rdis_freeze_tables    (struct _rdis * rdis);
+// the references made by the instructions in rdis->graph. the index belongs
+// to rdis. it is built on first use and then kept up to date a node at a time,
+// through rdis_node_changed
+struct _xref_index * rdis_xrefs      (struct _rdis * rdis);
 
 void rdis_set_console (struct _rdis * rdis,
                        void (* console_callback) (void *, const char *),
@@ -66,6 +95,32 @@ void rdis_console     (struct _rdis * rdis, const char * string);
 void rdis_set_gui     (struct _rdis * rdis, struct _gui * gui);
 void rdis_clear_gui   (struct _rdis * rdis);
 
+// returns the family of the node at index in rdis->graph, the nodes
+// graph_family would copy, without copying them. NULL if there is no node at
+// index. views are cached and belong to rdis, and are dropped when the graph
+// changes
+struct _graph_view * rdis_graph_view    (struct _rdis * rdis, uint64_t index);
+// the index of the instructions in rdis->graph, for finding the instruction
+// starting at or covering an address. it belongs to rdis and is built when
+// first needed after the graph changes. returns NULL if graph is NULL
+struct _ins_index  * rdis_ins_index     (struct _rdis * rdis);
+// drops cached views. call this after changing rdis->graph. a callback of type
+// RDIS_CALLBACK_GRAPH calls it before any callback is run
+void                 rdis_graph_changed (struct _rdis * rdis);
+
+// the dominator and post-dominator trees of the function at address. NULL if
+// there is no node at address. trees are cached and belong to rdis. unlike
+// views they survive changes to the graph, until rdis_node_changed is called
+// for a node they hold
+struct _graph_dom * rdis_dominators      (struct _rdis * rdis, uint64_t address);
+struct _graph_dom * rdis_post_dominators (struct _rdis * rdis, uint64_t address);
+// drops the cached trees holding the node at index, and its references. call
+// this before changing the node's instructions or edges, removing it, or adding
+// a node at index
+void                rdis_node_changed    (struct _rdis * rdis, uint64_t index);
+// drops everything cached about rdis->graph, for when it is replaced
+void                rdis_graph_reset     (struct _rdis * rdis);
+
 // creates a user function based on the bytes found at address,
 // updates graph, labels and function_tree appropriately
 // and then calls callbacks
@@ -85,6 +140,14 @@ int rdis_function_bounds (struct _rdis * rdis, uint64_t address);
 // set the bounds of all functions
 int rdis_functions_bounds (struct _rdis * rdis);
 
+// the index of functions by bounds, for finding the functions which hold an
+// address or overlap a range. it belongs to rdis and is built when first
+// needed after functions change
+struct _function_index * rdis_function_index    (struct _rdis * rdis);
+// drops the function index. call this after adding or removing functions or
+// changing their bounds. setting bounds through rdis calls it
+void                     rdis_functions_changed (struct _rdis * rdis);
+
 int rdis_update_memory (struct _rdis *   rdis,
                         uint64_t         address,
                         struct _buffer * buffer);
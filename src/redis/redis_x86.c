@@ -39,8 +39,9 @@ struct _redis_x86 * redis_x86_copy (struct _redis_x86 * redis_x86)
 {
     struct _redis_x86 * new_redis_x86 = redis_x86_create();
 
+    // writes go through map_fetch_own, so the copies may share memory
     object_delete (new_redis_x86->mem);
-    new_redis_x86->mem = object_copy(redis_x86->mem);
+    new_redis_x86->mem = map_snapshot(redis_x86->mem);
 
     memcpy(new_redis_x86->regs, redis_x86->regs, sizeof(redis_x86->regs));
 
@@ -58,8 +59,10 @@ struct _redis_x86 * redis_x86_copy (struct _redis_x86 * redis_x86)
 void redis_x86_mem_from_mem_map (struct _redis_x86 * redis_x86,
                                  struct _map * mem_map)
 {
+    // a snapshot of mem_map, so emulating a large binary copies nothing up
+    // front, and writes never reach the caller's map
     object_delete(redis_x86->mem);
-    redis_x86->mem = object_copy(mem_map);
+    redis_x86->mem = map_snapshot(mem_map);
 }
 
 void redis_x86_false_stack (struct _redis_x86 * redis_x86)
@@ -92,10 +95,10 @@ int redis_x86_step (struct _redis_x86 * redis_x86)
     uint8_t ins_mem[16];
     size_t  ins_mem_size;
 
-    uint64_t         buf_addr = map_fetch_max_key(redis_x86->mem,
-                                                  redis_x86->regs[RED_EIP]);
-    struct _buffer * buf      = map_fetch_max(redis_x86->mem,
-                                              redis_x86->regs[RED_EIP]);
+    uint64_t         buf_addr;
+    struct _buffer * buf      = map_fetch_max_entry(redis_x86->mem,
+                                                    redis_x86->regs[RED_EIP],
+                                                    &buf_addr);
 
     if (buf == NULL) {
         snprintf(redis_x86->error_msg, REDIS_X86_ERROR_MSG_SIZE,
@@ -371,10 +374,9 @@ int redis_x86_set_operand (struct _redis_x86 * redis_x86,
 int redis_x86_mem_set32 (struct _redis_x86 * redis_x86, uint32_t addr, uint32_t value)
 {
     struct _buffer * buffer;
-    uint32_t buf_addr;
+    uint64_t buf_addr;
 
-    buf_addr = map_fetch_max_key(redis_x86->mem, addr);
-    buffer   = map_fetch_max(redis_x86->mem, addr);
+    buffer = map_fetch_max_entry(redis_x86->mem, addr, &buf_addr);
 
     if ((buffer == NULL) || (addr - buf_addr > buffer->size - 4)) {
         snprintf(redis_x86->error_msg, REDIS_X86_ERROR_MSG_SIZE,
@@ -386,6 +388,9 @@ int redis_x86_mem_set32 (struct _redis_x86 * redis_x86, uint32_t addr, uint32_t
 
     uint32_t offset = addr - buf_addr;
 
+    // our memory map is a snapshot, its buffers may be shared with rdis
+    buffer = map_fetch_own(redis_x86->mem, buf_addr);
+
     buffer->bytes[offset  ] = (value >> 0 ) & 0xff;
     buffer->bytes[offset+1] = (value >> 8 ) & 0xff;
     buffer->bytes[offset+2] = (value >> 16) & 0xff;
@@ -398,10 +403,9 @@ int redis_x86_mem_set32 (struct _redis_x86 * redis_x86, uint32_t addr, uint32_t
 int redis_x86_mem_set8 (struct _redis_x86 * redis_x86, uint32_t addr, uint8_t value)
 {
     struct _buffer * buffer;
-    uint32_t buf_addr;
+    uint64_t buf_addr;
 
-    buf_addr = map_fetch_max_key(redis_x86->mem, addr);
-    buffer   = map_fetch_max(redis_x86->mem, addr);
+    buffer = map_fetch_max_entry(redis_x86->mem, addr, &buf_addr);
 
     if ((buffer == NULL) || (addr - buf_addr > buffer->size - 1)) {
         snprintf(redis_x86->error_msg, REDIS_X86_ERROR_MSG_SIZE,
@@ -413,6 +417,8 @@ int redis_x86_mem_set8 (struct _redis_x86 * redis_x86, uint32_t addr, uint8_t va
 
     uint32_t offset = addr - buf_addr;
 
+    buffer = map_fetch_own(redis_x86->mem, buf_addr);
+
     buffer->bytes[offset] = value;
 
     return REDIS_SUCCESS;
@@ -422,12 +428,11 @@ int redis_x86_mem_set8 (struct _redis_x86 * redis_x86, uint32_t addr, uint8_t va
 uint32_t redis_x86_mem_get32 (struct _redis_x86 * redis_x86, uint32_t addr, int * error)
 {
     struct _buffer * buffer;
-    uint32_t buf_addr;
+    uint64_t buf_addr;
 
-    buf_addr = map_fetch_max_key(redis_x86->mem, addr);
-    buffer   = map_fetch_max(redis_x86->mem, addr);
+    buffer = map_fetch_max_entry(redis_x86->mem, addr, &buf_addr);
 
-    printf("%x %x %x\n", addr, buf_addr, (unsigned int) buffer->size);
+    printf("%x %x %x\n", addr, (unsigned int) buf_addr, (unsigned int) buffer->size);
 
     if ((buffer == NULL) || (addr - buf_addr > buffer->size - 4)) {
         snprintf(redis_x86->error_msg, REDIS_X86_ERROR_MSG_SIZE,
@@ -454,10 +459,9 @@ uint32_t redis_x86_mem_get32 (struct _redis_x86 * redis_x86, uint32_t addr, int
 uint16_t redis_x86_mem_get16 (struct _redis_x86 * redis_x86, uint32_t addr, int * error)
 {
     struct _buffer * buffer;
-    uint32_t buf_addr;
+    uint64_t buf_addr;
 
-    buf_addr = map_fetch_max_key(redis_x86->mem, addr);
-    buffer   = map_fetch_max(redis_x86->mem, addr);
+    buffer = map_fetch_max_entry(redis_x86->mem, addr, &buf_addr);
 
     if ((buffer == NULL) || (addr - buf_addr > buffer->size - 2)) {
         snprintf(redis_x86->error_msg, REDIS_X86_ERROR_MSG_SIZE,
@@ -482,10 +486,9 @@ uint16_t redis_x86_mem_get16 (struct _redis_x86 * redis_x86, uint32_t addr, int
 uint8_t redis_x86_mem_get8 (struct _redis_x86 * redis_x86, uint32_t addr, int * error)
 {
     struct _buffer * buffer;
-    uint32_t buf_addr;
+    uint64_t buf_addr;
 
-    buf_addr = map_fetch_max_key(redis_x86->mem, addr);
-    buffer   = map_fetch_max(redis_x86->mem, addr);
+    buffer = map_fetch_max_entry(redis_x86->mem, addr, &buf_addr);
 
     if ((buffer == NULL) || (addr - buf_addr > buffer->size - 1)) {
         snprintf(redis_x86->error_msg, REDIS_X86_ERROR_MSG_SIZE,
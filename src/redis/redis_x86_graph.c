@@ -67,11 +67,9 @@ struct _graph * redis_x86_graph (uint64_t address, struct _map * memory)
                 }
 
                 struct _list * list = list_create();
-                list_append(list, ins);
-                object_delete(ins);
+                list_append_take(list, ins);
 
-                graph_add_node(graph, next_index, list);
-                object_delete(list);
+                graph_add_node_take(graph, next_index, list);
 
                 map_remove(ins_map, redis_x86->ins_addr);
                 index = index_create(next_index++);
@@ -91,11 +89,9 @@ struct _graph * redis_x86_graph (uint64_t address, struct _map * memory)
                 break;
             }
             struct _list * list = list_create();
-            list_append(list, ins);
-            object_delete(ins);
+            list_append_take(list, ins);
 
-            graph_add_node(graph, next_index, list);
-            object_delete(list);
+            graph_add_node_take(graph, next_index, list);
 
             index = index_create(next_index++);
             map_insert(ins_map, redis_x86->ins_addr, index);
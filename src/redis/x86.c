@@ -57,8 +57,8 @@ int redis_x86_step (struct _redis_x86 * redis_x86)
     uint8_t ins_mem[16];
     size_t  ins_mem_size;
 
-    uint64_t         buf_addr = map_fetch_max_key(ins_mem, redis_x86->RED_EIP);
-    struct _buffer * buf      = map_fetch_max(ins_mem, redis_x86->RED_EIP);
+    uint64_t         buf_addr;
+    struct _buffer * buf      = map_fetch_max_entry(ins_mem, redis_x86->RED_EIP, &buf_addr);
 
     if (buf == NULL)
         return REDIS_INVALID_IP;
@@ -111,6 +111,12 @@ static const struct luaL_Reg rl_rdis_lib_f [] = {
     {"redis_x86" ,         rl_rdis_redis_x86},
     {"setting",            rl_rdis_setting},
     {"entry",              rl_rdis_entry},
+    {"dominators",         rl_rdis_dominators},
+    {"post_dominators",    rl_rdis_post_dominators},
+    {"dominates",          rl_rdis_dominates},
+    {"post_dominates",     rl_rdis_post_dominates},
+    {"back_edge",          rl_rdis_back_edge},
+    {"loop_header",        rl_rdis_loop_header},
     {NULL, NULL}
 };
 
@@ -690,14 +696,19 @@ int rl_graph_node_edges (lua_State * L)
     struct _graph_node * node = rl_check_graph_node(L, -1);
     lua_pop(L, 1);
 
-    struct _list_it * it;
+    size_t i;
 
     lua_newtable(L);
     int table_index = 1;
 
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
+    for (i = 0; i < node->successors.size; i++) {
         lua_pushinteger(L, table_index++);
-        rl_graph_edge_push(L, it->data);
+        rl_graph_edge_push(L, node->successors.edges[i]);
+        lua_settable(L, -3);
+    }
+    for (i = 0; i < node->predecessors.size; i++) {
+        lua_pushinteger(L, table_index++);
+        rl_graph_edge_push(L, node->predecessors.edges[i]);
         lua_settable(L, -3);
     }
 
@@ -814,7 +825,9 @@ int rl_rdg_ins_by_coords (lua_State * L)
                                              rdis_lua->rdis->labels,
                                              x, y);
 
-    struct _ins * ins = graph_fetch_ins(rdis_lua->rdis->graph, address);
+    struct _ins * ins = ins_index_fetch(rdis_ins_index(rdis_lua->rdis),
+                                        rdis_lua->rdis->graph,
+                                        address);
     
     if (ins == NULL)
         lua_pushnil(L);
@@ -911,8 +924,8 @@ int rl_rdis_peek (lua_State * L)
     uint64_t addr = rl_check_uint64(L, -1);
     lua_pop(L, 1);
 
-    struct _buffer * buffer = map_fetch_max(rdis_lua->rdis->memory, addr);
-    uint64_t base = map_fetch_max_key(rdis_lua->rdis->memory, addr);
+    uint64_t base;
+    struct _buffer * buffer = map_fetch_max_entry(rdis_lua->rdis->memory, addr, &base);
 
     if ((buffer == NULL) || (buffer->size + base > addr))
         luaL_error(L, "%llx not in memory", addr);
@@ -1040,6 +1053,9 @@ int rl_rdis_load (lua_State * L)
     rdis_lua->rdis->labels    = labels;
     rdis_lua->rdis->functions = functions;
     rdis_lua->rdis->memory    = memory;
+    rdis_graph_reset(rdis_lua->rdis);
+
+    rdis_freeze_tables(rdis_lua->rdis);
 
     return 0;
 }
@@ -1086,6 +1102,9 @@ int rl_rdis_loader (lua_State * L)
     rdis_lua->rdis->labels    = loader_labels_functions(loader,
                                                         rdis_lua->rdis->memory,
                                                         rdis_lua->rdis->functions);
+    rdis_graph_reset(rdis_lua->rdis);
+
+    rdis_freeze_tables(rdis_lua->rdis);
 
     lua_pop(L, 1);
     lua_pushboolean(L, 1);
@@ -1101,7 +1120,7 @@ int rl_rdis_set_function_label (lua_State * L)
     const char * text = luaL_checkstring(L, -1);
     lua_pop(L, 2);
 
-    struct _label * label = map_fetch(rdis_lua->rdis->labels, address);
+    struct _label * label = map_fetch_own(rdis_lua->rdis->labels, address);
 
     if (label == NULL) {
         luaL_error(L, "could not find function label at given address");
@@ -1130,7 +1149,7 @@ int rl_rdis_set_ins_comment (lua_State * L)
         return 0;
     }
 
-    struct _ins * ins = graph_node_ins(node, ins_address);
+    struct _ins * ins = graph_node_ins_own(node, ins_address);
     if (ins == NULL) {
         luaL_error(L, "could not find instruction");
         return 0;
@@ -1204,7 +1223,7 @@ int rl_rdis_rdg (lua_State * L)
 
     uint64_t address = rl_check_uint64(L, -1);
 
-    struct _graph * family = graph_family(rdis_lua->rdis->graph, address);
+    struct _graph_view * family = rdis_graph_view(rdis_lua->rdis, address);
 
     if (family == NULL) {
         char tmp[128];
@@ -1215,13 +1234,12 @@ int rl_rdis_rdg (lua_State * L)
         return 0;
     }
     else {
-        struct _rdg * rdg = rdg_create(address, family, rdis_lua->rdis->labels);
+        struct _rdg * rdg = rdg_create_view(address, family, rdis_lua->rdis->labels);
         rdg_draw(rdg);
 
         lua_pop(L, 1);
         rl_rdg_push(L, rdg);
 
-        object_delete(family);
         return 1;
     }
 }
@@ -1251,6 +1269,8 @@ int rl_rdis_setting (lua_State * L)
 
     if (strcmp(setting_name, "reference_popup") == 0)
         settings.reference_popup = value & 1;
+    else if ((strcmp(setting_name, "worker_threads") == 0) && (value >= 0))
+        settings.worker_threads = value;
 
     return 0;
 }
@@ -1263,4 +1283,113 @@ int rl_rdis_entry (lua_State * L)
     rl_uint64_push(L, loader_entry(rdis_lua->rdis->loader));
 
     return 1;
-}
\ No newline at end of file
+}
+
+// the dominator or post-dominator tree of the function whose address is at
+// position. raises an error if there is none
+struct _graph_dom * rl_check_dom (lua_State * L, int position, int post)
+{
+    struct _rdis_lua * rdis_lua = rl_get_rdis_lua(L);
+
+    uint64_t address = rl_check_uint64(L, position);
+
+    struct _graph_dom * dom;
+    if (post)
+        dom = rdis_post_dominators(rdis_lua->rdis, address);
+    else
+        dom = rdis_dominators(rdis_lua->rdis, address);
+
+    if (dom == NULL)
+        luaL_error(L, "did not find node");
+
+    return dom;
+}
+
+
+// pushes a table of the immediate dominator of each block in dom which has one
+int rl_dom_push (lua_State * L, struct _graph_dom * dom)
+{
+    lua_newtable(L);
+
+    uint32_t node;
+    for (node = 0; node < dom->size; node++) {
+        if (dom->idom[node] == GRAPH_DOM_NONE)
+            continue;
+
+        rl_uint64_push(L, dom->indexes[node]);
+        rl_uint64_push(L, dom->indexes[dom->idom[node]]);
+
+        lua_settable(L, -3);
+    }
+
+    return 1;
+}
+
+
+int rl_rdis_dominators (lua_State * L)
+{
+    struct _graph_dom * dom = rl_check_dom(L, -1, 0);
+    lua_pop(L, 1);
+
+    return rl_dom_push(L, dom);
+}
+
+
+int rl_rdis_post_dominators (lua_State * L)
+{
+    struct _graph_dom * dom = rl_check_dom(L, -1, 1);
+    lua_pop(L, 1);
+
+    return rl_dom_push(L, dom);
+}
+
+
+int rl_rdis_dominates (lua_State * L)
+{
+    struct _graph_dom * dom = rl_check_dom(L, -3, 0);
+    uint64_t a = rl_check_uint64(L, -2);
+    uint64_t b = rl_check_uint64(L, -1);
+    lua_pop(L, 3);
+
+    lua_pushboolean(L, graph_dom_dominates(dom, a, b));
+
+    return 1;
+}
+
+
+int rl_rdis_post_dominates (lua_State * L)
+{
+    struct _graph_dom * dom = rl_check_dom(L, -3, 1);
+    uint64_t a = rl_check_uint64(L, -2);
+    uint64_t b = rl_check_uint64(L, -1);
+    lua_pop(L, 3);
+
+    lua_pushboolean(L, graph_dom_dominates(dom, a, b));
+
+    return 1;
+}
+
+
+int rl_rdis_back_edge (lua_State * L)
+{
+    struct _graph_dom * dom = rl_check_dom(L, -3, 0);
+    uint64_t head = rl_check_uint64(L, -2);
+    uint64_t tail = rl_check_uint64(L, -1);
+    lua_pop(L, 3);
+
+    lua_pushboolean(L, graph_dom_back_edge(dom, head, tail));
+
+    return 1;
+}
+
+
+int rl_rdis_loop_header (lua_State * L)
+{
+    struct _graph_dom * dom = rl_check_dom(L, -2, 0);
+    uint64_t index = rl_check_uint64(L, -1);
+    lua_pop(L, 2);
+
+    lua_pushboolean(L, graph_dom_loop_header(dom, index));
+
+    return 1;
+}
@@ -102,4 +102,14 @@ int rl_rdis_redis_x86          (lua_State * L);
 int rl_rdis_setting            (lua_State * L);
 int rl_rdis_entry              (lua_State * L);
 
+struct _graph_dom * rl_check_dom (lua_State * L, int position, int post);
+int rl_dom_push                  (lua_State * L, struct _graph_dom * dom);
+
+int rl_rdis_dominators         (lua_State * L);
+int rl_rdis_post_dominators    (lua_State * L);
+int rl_rdis_dominates          (lua_State * L);
+int rl_rdis_post_dominates     (lua_State * L);
+int rl_rdis_back_edge          (lua_State * L);
+int rl_rdis_loop_header        (lua_State * L);
+
 #endif
\ No newline at end of file
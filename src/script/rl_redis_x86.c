@@ -211,11 +211,9 @@ int rl_redis_x86_step (lua_State * L)
                 }
 
                 struct _list * list = list_create();
-                list_append(list, ins);
-                object_delete(ins);
+                list_append_take(list, ins);
 
-                graph_add_node(graph, rl_redis_x86->next_index, list);
-                object_delete(list);
+                graph_add_node_take(graph, rl_redis_x86->next_index, list);
 
                 map_remove(ins_map, redis_x86->ins_addr);
                 index = index_create(rl_redis_x86->next_index++);
@@ -237,11 +235,9 @@ int rl_redis_x86_step (lua_State * L)
                 return 0;
             }
             struct _list * list = list_create();
-            list_append(list, ins);
-            object_delete(ins);
+            list_append_take(list, ins);
 
-            graph_add_node(graph, rl_redis_x86->next_index, list);
-            object_delete(list);
+            graph_add_node_take(graph, rl_redis_x86->next_index, list);
 
             index = index_create(rl_redis_x86->next_index++);
             map_insert(ins_map, redis_x86->ins_addr, index);
@@ -1,5 +1,6 @@
 #include "settings.h"
 
 struct _settings settings = {
-	1
+	1,
+	0
 };
\ No newline at end of file
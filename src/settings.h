@@ -3,6 +3,8 @@
 
 struct _settings {
 	unsigned char reference_popup;
+	// threads in the wqueue worker pool, 0 for one per CPU. see wqueue.h
+	unsigned int  worker_threads;
 };
 
 extern struct _settings settings;
@@ -3,6 +3,7 @@
 #include "buffer.h"
 #include "function.h"
 #include "graph.h"
+#include "graph_csr.h"
 #include "index.h"
 #include "instruction.h"
 #include "queue.h"
@@ -26,12 +27,9 @@ void remove_function_predecessors (struct _graph * graph, struct _map * function
             continue;
         }
 
-        struct _list * predecessors = graph_node_predecessors(node);
-        struct _list_it * lit;
-        for (lit = list_iterator(predecessors); lit != NULL; lit = lit->next) {
-            struct _graph_edge * edge = lit->data;
-            queue_push(queue, edge);
-        }
+        size_t i;
+        for (i = 0; i < node->predecessors.size; i++)
+            queue_push(queue, node->predecessors.edges[i]);
     }
 
     while (queue->size > 0) {
@@ -44,9 +42,68 @@ void remove_function_predecessors (struct _graph * graph, struct _map * function
 }
 
 
-void create_call_graph_list (struct _graph_node * node, struct _list * call_list)
+void truncate_blocks (struct _graph * graph)
+{
+    struct _graph_it * it;
+    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
+        struct _graph_node * node     = graph_it_node(it);
+        struct _list       * ins_list = node->data;
+        struct _list_it    * lit      = list_iterator(ins_list);
+
+        // the first instruction starts this block
+        if (lit == NULL)
+            continue;
+
+        for (lit = lit->next; lit != NULL; lit = lit->next) {
+            struct _ins * ins = lit->data;
+            if (graph_fetch_node(graph, ins->address) != NULL)
+                break;
+        }
+
+        if (lit != NULL) {
+            // the block we ran into holds the rest of these instructions, and
+            // its last block has the edges of our last instruction
+            uint64_t tail = ((struct _ins *) lit->data)->address;
+            while (lit != NULL)
+                lit = list_remove(ins_list, lit);
+
+            while (node->successors.size > 0) {
+                struct _graph_edge * edge = node->successors.edges[0];
+                graph_remove_edge(graph, edge->head, edge->tail);
+            }
+
+            struct _ins_edge * ins_edge = ins_edge_create(INS_EDGE_NORMAL);
+            graph_add_edge(graph, node->index, tail, ins_edge);
+            object_delete(ins_edge);
+            continue;
+        }
+
+        // when two graphs had a block at the same address, the one kept may be
+        // shorter than the one dropped, which brought along the edges of its
+        // own last instruction. only edges to the instruction after our last
+        // one, or to its target, are ours
+        struct _ins * last = NULL;
+        for (lit = list_iterator(ins_list); lit != NULL; lit = lit->next)
+            last = lit->data;
+
+        uint64_t target = -1;
+        if (    (last->flags & INS_TARGET_SET)
+             && (! (last->flags & INS_CALL)))
+            target = last->target;
+
+        size_t i = node->successors.size;
+        while (i-- > 0) {
+            struct _graph_edge * edge = node->successors.edges[i];
+            if (    (edge->tail != last->address + last->size)
+                 && (edge->tail != target))
+                graph_remove_edge(graph, edge->head, edge->tail);
+        }
+    }
+}
+
+
+void create_call_graph_list (struct _list * ins_list, struct _list * call_list)
 {
-    struct _list * ins_list = node->data;
     struct _list_it * it;
     for (it = list_iterator(ins_list); it != NULL; it = it->next) {
         struct _ins * ins = it->data;
@@ -64,13 +121,18 @@ struct _graph * create_call_graph (struct _graph * graph, uint64_t indx)
     if (node == NULL)
         return NULL;
 
+    // every function is walked from scratch, so walk a snapshot and reuse one
+    // visited set instead of building a tree of visited nodes each time
+    struct _graph_csr * csr = graph_freeze(graph);
+    uint64_t * visited = graph_csr_visited_create(csr);
+    uint32_t * ids     = malloc(sizeof(uint32_t) * csr->size);
+
     struct _graph * call_graph     = graph_create();
     struct _queue * function_queue = queue_create();
     struct _queue * edge_queue     = queue_create();
 
     struct _index * index = index_create(node->index);
-    queue_push(function_queue, index);
-    object_delete(index);
+    queue_push_take(function_queue, index);
 
     while (function_queue->size > 0) {
         struct _index * index = queue_peek(function_queue);
@@ -82,12 +144,17 @@ struct _graph * create_call_graph (struct _graph * graph, uint64_t indx)
 
         struct _list * call_list = list_create();
 
-        if (graph_fetch_node(graph, index->index) == NULL) {
+        uint32_t id = graph_csr_id(csr, index->index);
+        if (id == GRAPH_CSR_NONE) {
             printf("didn't find node %llx\n", (unsigned long long) index->index);
         }
-        
-        graph_bfs_data(graph, index->index, call_list,
-             (void (*) (struct _graph_node *, void *)) create_call_graph_list);
+        else {
+            size_t ids_n = graph_csr_reachable(csr, id, visited, ids);
+            size_t i;
+            for (i = 0; i < ids_n; i++)
+                create_call_graph_list(csr->data[ids[i]], call_list);
+            graph_csr_visited_clear(visited, ids, ids_n);
+        }
 
         // for every call we are making
         struct _list_it * it;
@@ -96,18 +163,16 @@ struct _graph * create_call_graph (struct _graph * graph, uint64_t indx)
             // we haven't already added that function
             struct _ins * ins = it->data;
             if (    (ins->flags & INS_TARGET_SET)
-                 && (graph_fetch_node(graph, ins->target) != NULL)
+                 && (graph_csr_id(csr, ins->target) != GRAPH_CSR_NONE)
                  && (graph_fetch_node(call_graph, ins->target) == NULL)) {
                 // add the target to the function queue
                 struct _index * new_index = index_create(ins->target);
-                queue_push(function_queue, new_index);
-                object_delete(new_index);
+                queue_push_take(function_queue, new_index);
                 // and add an edge for later
                 struct _ins_edge * ins_edge = ins_edge_create(INS_EDGE_NORMAL);
                 struct _graph_edge * edge;
                 edge = graph_edge_create(index->index, ins->target, ins_edge);
-                queue_push(edge_queue, edge);
-                object_delete(edge);
+                queue_push_take(edge_queue, edge);
                 object_delete(ins_edge);
             }
         }
@@ -121,6 +186,10 @@ struct _graph * create_call_graph (struct _graph * graph, uint64_t indx)
     }
     object_delete(function_queue);
 
+    free(visited);
+    free(ids);
+    object_delete(csr);
+
     // add all the edges
     while (edge_queue->size > 0) {
         struct _graph_edge * edge = queue_peek(edge_queue);
@@ -206,11 +275,11 @@ struct _ins * graph_fetch_ins (struct _graph * graph, uint64_t address)
 
 int mem_map_byte (struct _map * mem_map, uint64_t address)
 {
-    struct _buffer * buffer = map_fetch_max(mem_map, address);
+    uint64_t base_address;
+    struct _buffer * buffer = map_fetch_max_entry(mem_map, address, &base_address);
     if (buffer == NULL)
         return -1;
 
-    uint64_t base_address = map_fetch_max_key(mem_map, address);
     if (address >= base_address + buffer->size)
         return -1;
 
@@ -223,8 +292,8 @@ int mem_map_byte (struct _map * mem_map, uint64_t address)
 
 int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buf)
 {
-    struct _buffer * buf2 = map_fetch_max(mem_map, address + buf->size);
-    uint64_t key          = map_fetch_max_key(mem_map, address + buf->size);
+    uint64_t key;
+    struct _buffer * buf2 = map_fetch_max_entry(mem_map, address + buf->size, &key);
 
     if (    (buf2 != NULL)
          && (    ((address <= key) && (address + buf->size > key))
@@ -234,6 +303,7 @@ int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buf)
 
         // if this section fits inside a previous section, modify in place
         if ((address >= key) && (address + buf->size <= key + buf2->size)) {
+            buf2 = map_fetch_own(mem_map, key);
             memcpy(&(buf2->bytes[address - key]), buf->bytes, buf->size);
         }
 
@@ -253,8 +323,7 @@ int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buf)
             struct _buffer * new_buffer = buffer_create(tmp, new_size);
             free(tmp);
             map_remove(mem_map, key);
-            map_insert(mem_map, address, new_buffer);
-            object_delete(new_buffer);
+            map_insert_take(mem_map, address, new_buffer);
         }
 
         // if this section overlaps previous section but starts after previous
@@ -268,8 +337,7 @@ int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buf)
             struct _buffer * new_buffer = buffer_create(tmp, new_size);
             free(tmp);
             map_remove(mem_map, key);
-            map_insert(mem_map, key, new_buffer);
-            object_delete(new_buffer);
+            map_insert_take(mem_map, key, new_buffer);
         }
     }
     else {
@@ -296,6 +364,24 @@ struct _ins * graph_node_ins (struct _graph_node * node, uint64_t address)
 }
 
 
+struct _ins * graph_node_ins_own (struct _graph_node * node, uint64_t address)
+{
+    if (node == NULL)
+        return NULL;
+
+    struct _list_it * lit;
+    for (lit = list_iterator(node->data); lit != NULL; lit = lit->next) {
+        struct _ins * ins = lit->data;
+        if (ins->address == address) {
+            lit->data = object_own(ins);
+            return lit->data;
+        }
+    }
+
+    return NULL;
+}
+
+
 
 int remove_all_after (struct _graph_node * node, uint64_t index)
 {
@@ -320,12 +406,11 @@ int remove_all_after (struct _graph_node * node, uint64_t index)
     struct _queue * queue = queue_create();
     struct _graph * graph = node->graph;
 
-    struct _list * successors = graph_node_successors(node);
-    for (lit = list_iterator(successors); lit != NULL; lit = lit->next) {
-        struct _graph_edge * edge = lit->data;
+    size_t i;
+    for (i = 0; i < node->successors.size; i++) {
+        struct _graph_edge * edge = node->successors.edges[i];
         queue_push(queue, graph_fetch_node(graph, edge->tail));
     }
-    object_delete(successors);
 
     // we only add this node if it is empty, IE the instruction we removed was
     // the first instruction for this node
@@ -342,14 +427,11 @@ int remove_all_after (struct _graph_node * node, uint64_t index)
             continue;
         }
 
-        struct _list * successors = graph_node_successors(node);
-        struct _list_it * lit;
-        for (lit = list_iterator(successors); lit != NULL; lit = lit->next) {
-            struct _graph_edge * edge = lit->data;
+        for (i = 0; i < node->successors.size; i++) {
+            struct _graph_edge * edge = node->successors.edges[i];
             struct _graph_node * sucnode = graph_fetch_node(graph, edge->tail);
             queue_push(queue, sucnode);
         }
-        object_delete(successors);
 
         graph_remove_node(graph, node->index);
         queue_pop(queue);
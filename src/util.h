@@ -21,6 +21,17 @@
 void remove_function_predecessors (struct _graph * graph, struct _map * functions);
 
 
+/*
+* Graphs of basic blocks disassembled separately and then merged overlap where
+* a block of one runs on into a block which starts in another. Each such block
+* is cut short at the first instruction which starts another block, and falls
+* through to it, and edges which do not leave from the last instruction of
+* their block are removed. Call this after merging and before
+* remove_function_predecessors.
+*/
+void truncate_blocks (struct _graph * graph);
+
+
 /*
 * Starting with the function of which node index is a the head, create a
 * call graph. The call graph will be of the same internal structure as a loader
@@ -32,6 +43,8 @@ int is_string (uint8_t * data, size_t data_size);
 
 size_t rdstrcat (char * dst, char * src, size_t size);
 
+// looks in the node at or before address, and then in every node of graph.
+// build an ins_index when looking up more than one address
 struct _ins * graph_fetch_ins (struct _graph * graph, uint64_t address);
 
 int mem_map_byte (struct _map * mem_map, uint64_t address);
@@ -40,6 +53,13 @@ int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buffe
 
 struct _ins * graph_node_ins (struct _graph_node * node, uint64_t address);
 
+/*
+* Like graph_node_ins, but if the instruction is shared with another graph it
+* is first replaced in this node by a private copy. Use this to fetch an
+* instruction which is about to be modified.
+*/
+struct _ins * graph_node_ins_own (struct _graph_node * node, uint64_t address);
+
 /*
 * Removes all instructions and successor nodes starting with an instruction in
 * a node from a loader graph
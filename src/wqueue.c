@@ -1,11 +1,16 @@
 #include "wqueue.h"
 
+#include "settings.h"
+
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+#include <unistd.h>
 
 static const struct _object wqueue_item_object = {
     (void   (*) (void *)) wqueue_item_delete, 
-    (void * (*) (void *)) wqueue_item_copy, 
+    NULL,
     NULL,
     NULL
 };
@@ -18,25 +23,235 @@ static const struct _object wqueue_object = {
 };
 
 
+// a deque of items waiting to run. the worker owning a deque pushes and pops
+// at the tail, thieves take from the head. items[head] .. items[tail - 1],
+// wrapped around capacity, are waiting
+struct _wqueue_deque {
+    pthread_mutex_t        lock;
+    struct _wqueue_item ** items;
+    size_t                 capacity;
+    size_t                 head;
+    size_t                 tail;
+};
+
+struct _wqueue_pool {
+    pthread_mutex_t lock;
+    // signalled when work is queued, and broadcast when a wqueue finishes
+    pthread_cond_t  work;
+    // threads waiting on work, and items waiting in any deque. both are read
+    // and written atomically
+    int             sleeping;
+    size_t          queued;
+    // items pushed from outside the pool
+    struct _wqueue_deque   shared;
+    struct _wqueue_deque * deques[WQUEUE_WORKERS_MAX];
+    int                    threads_n;
+};
+
+static struct _wqueue_pool wqueue_pool = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    0,
+    0,
+    {PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0},
+    {NULL},
+    0
+};
+
+// the deque of the worker running this thread, NULL outside the pool
+static __thread struct _wqueue_deque * wqueue_deque = NULL;
+// the wqueue of the work item this thread is running
+static __thread struct _wqueue * wqueue_running = NULL;
+// where this thread starts looking for work to steal
+static __thread unsigned int wqueue_victim = 0;
+
+
+void * wqueue_worker (void * deque);
+
+
+struct _wqueue_deque * wqueue_deque_create ()
+{
+    struct _wqueue_deque * deque = malloc(sizeof(struct _wqueue_deque));
+
+    pthread_mutex_init(&(deque->lock), NULL);
+    deque->items    = NULL;
+    deque->capacity = 0;
+    deque->head     = 0;
+    deque->tail     = 0;
+
+    return deque;
+}
+
+
+void wqueue_deque_push (struct _wqueue_deque * deque,
+                        struct _wqueue_item  * wqueue_item)
+{
+    pthread_mutex_lock(&(deque->lock));
+
+    if (deque->tail - deque->head == deque->capacity) {
+        size_t capacity = deque->capacity == 0 ? 64 : deque->capacity * 2;
+        struct _wqueue_item ** items;
+        items = malloc(sizeof(struct _wqueue_item *) * capacity);
+
+        size_t i;
+        for (i = 0; i < deque->capacity; i++)
+            items[i] = deque->items[(deque->head + i) & (deque->capacity - 1)];
+
+        free(deque->items);
+        deque->items    = items;
+        deque->tail     = deque->capacity;
+        deque->head     = 0;
+        deque->capacity = capacity;
+    }
+
+    deque->items[deque->tail++ & (deque->capacity - 1)] = wqueue_item;
+
+    pthread_mutex_unlock(&(deque->lock));
+}
+
+
+// takes the newest item, or NULL
+struct _wqueue_item * wqueue_deque_pop (struct _wqueue_deque * deque)
+{
+    struct _wqueue_item * wqueue_item = NULL;
+
+    pthread_mutex_lock(&(deque->lock));
+    if (deque->tail != deque->head)
+        wqueue_item = deque->items[--deque->tail & (deque->capacity - 1)];
+    pthread_mutex_unlock(&(deque->lock));
+
+    return wqueue_item;
+}
+
+
+// takes the oldest item, or NULL
+struct _wqueue_item * wqueue_deque_steal (struct _wqueue_deque * deque)
+{
+    struct _wqueue_item * wqueue_item = NULL;
+
+    pthread_mutex_lock(&(deque->lock));
+    if (deque->tail != deque->head)
+        wqueue_item = deque->items[deque->head++ & (deque->capacity - 1)];
+    pthread_mutex_unlock(&(deque->lock));
+
+    return wqueue_item;
+}
+
+
+// starts workers until the pool is as large as settings ask
+void wqueue_pool_fit ()
+{
+    int threads_n = settings.worker_threads;
+    if (threads_n == 0)
+        threads_n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads_n < 1)
+        threads_n = 1;
+    if (threads_n > WQUEUE_WORKERS_MAX)
+        threads_n = WQUEUE_WORKERS_MAX;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    pthread_mutex_lock(&(wqueue_pool.lock));
+    while (wqueue_pool.threads_n < threads_n) {
+        struct _wqueue_deque * deque = wqueue_pool.deques[wqueue_pool.threads_n];
+        if (deque == NULL)
+            deque = wqueue_deque_create();
+
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, wqueue_worker, deque) != 0) {
+            fprintf(stderr, "wqueue_pool_fit: could not start worker %d\n",
+                    wqueue_pool.threads_n);
+            wqueue_pool.deques[wqueue_pool.threads_n] = deque;
+            break;
+        }
+
+        // thieves read threads_n without the lock, so the deque goes in first
+        __atomic_store_n(&(wqueue_pool.deques[wqueue_pool.threads_n]),
+                         deque, __ATOMIC_RELEASE);
+        __atomic_store_n(&(wqueue_pool.threads_n),
+                         wqueue_pool.threads_n + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&(wqueue_pool.lock));
+
+    pthread_attr_destroy(&attr);
+}
+
+
+// wakes one sleeping thread, or all of them. sleepers count themselves before
+// they look for a reason to wake, and wakers change that reason before they
+// look for sleepers, so one of the two always sees the other
+void wqueue_pool_wake (int all)
+{
+    if (__atomic_load_n(&(wqueue_pool.sleeping), __ATOMIC_SEQ_CST) == 0)
+        return;
+
+    pthread_mutex_lock(&(wqueue_pool.lock));
+    if (all)
+        pthread_cond_broadcast(&(wqueue_pool.work));
+    else
+        pthread_cond_signal(&(wqueue_pool.work));
+    pthread_mutex_unlock(&(wqueue_pool.lock));
+}
+
+
+// queues an item on this thread's deque, or on the shared deque outside the
+// pool, and wakes a worker for it
+void wqueue_pool_queue (struct _wqueue_item * wqueue_item)
+{
+    if (wqueue_deque != NULL)
+        wqueue_deque_push(wqueue_deque, wqueue_item);
+    else
+        wqueue_deque_push(&(wqueue_pool.shared), wqueue_item);
+
+    __atomic_add_fetch(&(wqueue_pool.queued), 1, __ATOMIC_SEQ_CST);
+    wqueue_pool_wake(0);
+}
+
+
+// finds an item to run, looking at this thread's own deque, then the shared
+// deque, then every worker's deque in turn. returns NULL if nothing is queued
+struct _wqueue_item * wqueue_pool_find ()
+{
+    struct _wqueue_item * wqueue_item = NULL;
+
+    if (wqueue_deque != NULL)
+        wqueue_item = wqueue_deque_pop(wqueue_deque);
+
+    if (wqueue_item == NULL)
+        wqueue_item = wqueue_deque_steal(&(wqueue_pool.shared));
+
+    int threads_n = __atomic_load_n(&(wqueue_pool.threads_n), __ATOMIC_ACQUIRE);
+    int i;
+    for (i = 0; (wqueue_item == NULL) && (i < threads_n); i++) {
+        struct _wqueue_deque * victim;
+        victim = __atomic_load_n(&(wqueue_pool.deques[wqueue_victim++ % threads_n]),
+                                 __ATOMIC_ACQUIRE);
+        if (victim != wqueue_deque)
+            wqueue_item = wqueue_deque_steal(victim);
+    }
+
+    if (wqueue_item != NULL)
+        __atomic_sub_fetch(&(wqueue_pool.queued), 1, __ATOMIC_SEQ_CST);
+
+    return wqueue_item;
+}
+
+
 struct _wqueue * wqueue_create ()
 {
     struct _wqueue * wqueue = (struct _wqueue *) malloc(sizeof(struct _wqueue));
 
     wqueue->object       = &wqueue_object;
-    wqueue->work_queue   = queue_create();
     wqueue->results      = NULL;
     wqueue->results_last = NULL;
-    wqueue->max_thread_launched = -1;
-
-    int i;
-    for (i = 0; i < WQUEUE_THREAD_N; i++) {
-        wqueue->thread_status[i] = 0;
-    }
+    wqueue->unfinished   = 0;
 
-    pthread_attr_init(&(wqueue->attr));
-    pthread_attr_setdetachstate(&(wqueue->attr), PTHREAD_CREATE_JOINABLE);
+    pthread_cond_init(&(wqueue->ready), NULL);
     pthread_mutex_init(&(wqueue->lock), NULL);
 
+    wqueue_pool_fit();
 
     return wqueue;
 }
@@ -44,8 +259,8 @@ struct _wqueue * wqueue_create ()
 
 void wqueue_delete (struct _wqueue * wqueue)
 {
+    pthread_cond_destroy(&(wqueue->ready));
     pthread_mutex_destroy(&(wqueue->lock));
-    object_delete(wqueue->work_queue);
     while (wqueue->results != NULL) {
         struct _wqueue_result * next = wqueue->results->next;
         wqueue_result_delete(wqueue->results);
@@ -58,7 +273,8 @@ void wqueue_delete (struct _wqueue * wqueue)
 
 struct _wqueue_item * wqueue_item_create (struct _wqueue * wqueue,
                                           void * (* callback) (void *),
-                                          void * argument)
+                                          void * argument,
+                                          void   (* release) (void *))
 {
     struct _wqueue_item * wqueue_item;
 
@@ -67,7 +283,8 @@ struct _wqueue_item * wqueue_item_create (struct _wqueue * wqueue,
     wqueue_item->object   = &wqueue_item_object;
     wqueue_item->wqueue   = wqueue;
     wqueue_item->callback = callback;
-    wqueue_item->argument = object_copy(argument);
+    wqueue_item->argument = argument;
+    wqueue_item->release  = release;
 
     return wqueue_item;
 }
@@ -75,51 +292,87 @@ struct _wqueue_item * wqueue_item_create (struct _wqueue * wqueue,
 
 void wqueue_item_delete (struct _wqueue_item * wqueue_item)
 {
-    object_delete(wqueue_item->argument);
+    if (wqueue_item->release != NULL)
+        wqueue_item->release(wqueue_item->argument);
     free(wqueue_item);
 }
 
 
-struct _wqueue_item * wqueue_item_copy (struct _wqueue_item * wqueue_item)
+
+void wqueue_task (struct _wqueue * wqueue,
+                  void * (* callback) (void *),
+                  void * context,
+                  void   (* release) (void *))
 {
-    return wqueue_item_create(wqueue_item->wqueue,
-                              wqueue_item->callback,
-                              wqueue_item->argument);
+    struct _wqueue_item * wqueue_item;
+    wqueue_item = wqueue_item_create(wqueue, callback, context, release);
+
+    __atomic_add_fetch(&(wqueue->unfinished), 1, __ATOMIC_SEQ_CST);
+
+    wqueue_pool_queue(wqueue_item);
 }
 
 
+void wqueue_spawn_task (void * (* callback) (void *),
+                        void * context,
+                        void   (* release) (void *))
+{
+    if (wqueue_running == NULL) {
+        fprintf(stderr, "wqueue_spawn_task: called outside of a work item\n");
+        if (release != NULL)
+            release(context);
+        return;
+    }
+
+    wqueue_task(wqueue_running, callback, context, release);
+}
+
 
-void wqueue_push (struct _wqueue * wqueue,
-                  void * (*callback) (void *),
-                  void * argument)
+// appends result to the results. the caller holds the lock
+void wqueue_result_add (struct _wqueue * wqueue, void * result)
 {
-    struct _wqueue_item * wqueue_item;
-    wqueue_item = wqueue_item_create(wqueue, callback, argument);
+    struct _wqueue_result * wqueue_result = wqueue_result_create(result);
 
-    // add work item to queue
-    queue_push(wqueue->work_queue, wqueue_item);
-    object_delete(wqueue_item);
+    if (wqueue->results == NULL) {
+        wqueue->results = wqueue_result;
+        wqueue->results_last = wqueue_result;
+    }
+    else {
+        wqueue->results_last->next = wqueue_result;
+        wqueue->results_last = wqueue_result;
+    }
 }
 
 
+void wqueue_item_run (struct _wqueue_item * wqueue_item);
+
+
 void wqueue_wait (struct _wqueue * wqueue)
 {
-    // keep doing work
-    pthread_mutex_lock(&(wqueue->lock));
-    while (wqueue->work_queue->size > 0) {
-        pthread_mutex_unlock(&(wqueue->lock));
-        wqueue_run(wqueue);
-        pthread_mutex_lock(&(wqueue->lock));
-    }
-    pthread_mutex_unlock(&(wqueue->lock));
+    while (__atomic_load_n(&(wqueue->unfinished), __ATOMIC_SEQ_CST) > 0) {
+        // the items of this wqueue may be anywhere in the pool, so help with
+        // whatever is queued
+        struct _wqueue_item * wqueue_item = wqueue_pool_find();
+        if (wqueue_item != NULL) {
+            wqueue_item_run(wqueue_item);
+            continue;
+        }
 
-    // all works has been launched by threads, wait for threads
-    // to finish
-    int i = 0;
-    for (i = 0; i <= wqueue->max_thread_launched; i++) {
-        void * status;
-        pthread_join(wqueue->pthreads[i], &status);
+        // the rest of the items are running. sleep until one of them queues
+        // more work, or the last of them finishes
+        pthread_mutex_lock(&(wqueue_pool.lock));
+        __atomic_add_fetch(&(wqueue_pool.sleeping), 1, __ATOMIC_SEQ_CST);
+        if (    (__atomic_load_n(&(wqueue_pool.queued), __ATOMIC_SEQ_CST) == 0)
+             && (__atomic_load_n(&(wqueue->unfinished), __ATOMIC_SEQ_CST) > 0))
+            pthread_cond_wait(&(wqueue_pool.work), &(wqueue_pool.lock));
+        __atomic_sub_fetch(&(wqueue_pool.sleeping), 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&(wqueue_pool.lock));
     }
+
+    // the last item to finish released the lock after it was done with
+    // wqueue, take it once so nothing is still inside
+    pthread_mutex_lock(&(wqueue->lock));
+    pthread_mutex_unlock(&(wqueue->lock));
 }
 
 
@@ -143,6 +396,66 @@ void wqueue_pop (struct _wqueue * wqueue)
 }
 
 
+void * wqueue_take (struct _wqueue * wqueue)
+{
+    if (wqueue->results == NULL)
+        return NULL;
+
+    struct _wqueue_result * tmp = wqueue->results;
+    void * data = tmp->data;
+    wqueue->results = tmp->next;
+    free(tmp);
+
+    return data;
+}
+
+
+void * wqueue_next_result (struct _wqueue * wqueue, int timeout)
+{
+    struct timespec deadline;
+    if (timeout >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&(wqueue->lock));
+
+    // running items spawn children without the lock
+    while (    (wqueue->results == NULL)
+            && (__atomic_load_n(&(wqueue->unfinished), __ATOMIC_SEQ_CST) > 0)) {
+        if (timeout < 0)
+            pthread_cond_wait(&(wqueue->ready), &(wqueue->lock));
+        else if (pthread_cond_timedwait(&(wqueue->ready),
+                                        &(wqueue->lock),
+                                        &deadline) == ETIMEDOUT)
+            break;
+    }
+
+    void * result = wqueue_take(wqueue);
+
+    pthread_mutex_unlock(&(wqueue->lock));
+
+    return result;
+}
+
+
+int wqueue_finished (struct _wqueue * wqueue)
+{
+    pthread_mutex_lock(&(wqueue->lock));
+    size_t unfinished = __atomic_load_n(&(wqueue->unfinished),
+                                        __ATOMIC_SEQ_CST);
+    int finished = (unfinished == 0) && (wqueue->results == NULL);
+    pthread_mutex_unlock(&(wqueue->lock));
+
+    return finished;
+}
+
+
 struct _wqueue_result * wqueue_result_create (void * data)
 {
     struct _wqueue_result * wqueue_result;
@@ -163,74 +476,62 @@ void wqueue_result_delete (struct _wqueue_result * wqueue_result)
 }
 
 
-void wqueue_run (struct _wqueue * wqueue)
+// runs wqueue_item and hands its result to its wqueue
+void wqueue_item_run (struct _wqueue_item * wqueue_item)
 {
-    if (wqueue->work_queue->size == 0) {
-        return;
-    }
+    struct _wqueue * wqueue = wqueue_item->wqueue;
+
+    // work items may run inside a wqueue_wait of another work item
+    struct _wqueue * outer = wqueue_running;
+    wqueue_running = wqueue;
+    void * result = wqueue_item->callback(wqueue_item->argument);
+    wqueue_running = outer;
+
+    wqueue_item_delete(wqueue_item);
 
-    // search for a free thread
     pthread_mutex_lock(&(wqueue->lock));
-    int free_thread;
-    for (free_thread = 0; free_thread < WQUEUE_THREAD_N; free_thread++) {
-        if (wqueue->thread_status[free_thread] == 2) {
-            void * status;
-            pthread_join(wqueue->pthreads[free_thread], &status);
-            break;
-        }
-        if (wqueue->thread_status[free_thread] == 0)
-            break;
-    }
-    pthread_mutex_unlock(&(wqueue->lock));
 
-    if (free_thread == WQUEUE_THREAD_N) {
-        return;
+    // add result to results
+    if (result != NULL) {
+        wqueue_result_add(wqueue, result);
+        pthread_cond_signal(&(wqueue->ready));
     }
 
-    wqueue->thread_status[free_thread] = 1;
-    if (wqueue->max_thread_launched < free_thread)
-        wqueue->max_thread_launched = free_thread;
+    // once unfinished reaches 0 the waiting thread may delete wqueue, so it
+    // is the last thing done with it
+    size_t unfinished = __atomic_sub_fetch(&(wqueue->unfinished), 1,
+                                           __ATOMIC_SEQ_CST);
+    if (unfinished == 0)
+        pthread_cond_broadcast(&(wqueue->ready));
 
-    // get the work item
-    struct _wqueue_item * wqueue_item = object_copy(queue_peek(wqueue->work_queue));
-    queue_pop(wqueue->work_queue);
+    pthread_mutex_unlock(&(wqueue->lock));
 
-    // set this item's thread_index
-    wqueue_item->thread_index = free_thread;
-    
-    // launch
-    pthread_create(&(wqueue->pthreads[free_thread]),
-                   &(wqueue->attr),
-                   (void * (*) (void *)) wqueue_launch,
-                   (void *) wqueue_item);
+    if (unfinished == 0)
+        wqueue_pool_wake(1);
 }
 
 
-void * wqueue_launch (struct _wqueue_item * wqueue_item)
+void * wqueue_worker (void * deque)
 {
-    void * result = wqueue_item->callback(wqueue_item->argument);
-
-    struct _wqueue * wqueue = wqueue_item->wqueue;
-
-    struct _wqueue_result * wqueue_result = wqueue_result_create(result);
-
-    pthread_mutex_lock(&(wqueue->lock));
+    wqueue_deque  = deque;
+    // spread the workers' first victims out
+    static unsigned int workers_started = 0;
+    wqueue_victim = __atomic_fetch_add(&workers_started, 1, __ATOMIC_RELAXED);
+
+    while (1) {
+        struct _wqueue_item * wqueue_item = wqueue_pool_find();
+        if (wqueue_item != NULL) {
+            wqueue_item_run(wqueue_item);
+            continue;
+        }
 
-    // add result to results
-    if (wqueue->results == NULL) {
-        wqueue->results = wqueue_result;
-        wqueue->results_last = wqueue_result;
-    }
-    else {
-        wqueue->results_last->next = wqueue_result;
-        wqueue->results_last = wqueue_result;
+        pthread_mutex_lock(&(wqueue_pool.lock));
+        __atomic_add_fetch(&(wqueue_pool.sleeping), 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&(wqueue_pool.queued), __ATOMIC_SEQ_CST) == 0)
+            pthread_cond_wait(&(wqueue_pool.work), &(wqueue_pool.lock));
+        __atomic_sub_fetch(&(wqueue_pool.sleeping), 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&(wqueue_pool.lock));
     }
 
-    // set this thread as waiting for pthread_join
-    wqueue->thread_status[wqueue_item->thread_index] = 2;
-
-    // unlock and look for new work items
-    pthread_mutex_unlock(&(wqueue->lock));
-
-    pthread_exit(NULL);
-}
\ No newline at end of file
+    return NULL;
+}
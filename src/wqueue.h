@@ -7,16 +7,46 @@
 #include "queue.h"
 
 #define WQUEUE_CALLBACK(XX) ((void * (*) (void *)) XX)
-#define WQUEUE_THREAD_N 16
+#define WQUEUE_RELEASE(XX) ((void (*) (void *)) XX)
+
+/*
+* Every wqueue hands its work to one pool of worker threads, started by the
+* first wqueue_create and kept for the life of the process. The pool has
+* settings.worker_threads threads, or one per CPU when that is 0. It grows
+* when the setting is raised, and never shrinks. Work items start as soon as
+* they are pushed, and idle workers sleep until there is work.
+*
+* Each worker keeps a deque of its own. Items pushed by a running work item go
+* on the bottom of its worker's deque, and the worker takes its next item from
+* the bottom, so a work item's children run where their parent's data is
+* still warm. Idle workers steal from the top of other workers' deques, where
+* the oldest and usually largest work waits. Items pushed from outside the
+* pool wait in a shared queue, oldest first.
+*
+* A wqueue is a task group. wqueue_task pushes callback(context) onto a
+* wqueue, and work items may push more work onto their own wqueue with
+* wqueue_spawn_task. wqueue_wait returns once every item, children included,
+* has finished. A thread waiting on a wqueue runs queued work items until then
+* instead of sleeping, so work items may wait on wqueues of their own without
+* tying up a worker.
+*
+* Contexts are plain pointers and are never copied. A task's context stays the
+* caller's when release is NULL, in which case it must outlive the task, and
+* read only contexts may be shared by any number of tasks. Otherwise the task
+* owns context, and calls release(context) once it has run.
+*/
+
+#define WQUEUE_WORKERS_MAX 256
 
 struct _wqueue_item {
     const struct _object * object;
 
     struct _wqueue * wqueue;
-    int              thread_index;
-    
+
     void * (* callback) (void *);
     void *    argument;
+    // called on argument once the item has run, unless NULL
+    void   (* release)  (void *);
 };
 
 struct _wqueue_result {
@@ -27,15 +57,14 @@ struct _wqueue_result {
 struct _wqueue {
     const struct _object * object;
 
-    struct _queue         * work_queue;
     struct _wqueue_result * results;
     struct _wqueue_result * results_last;
 
-    int             max_thread_launched;
-    int             thread_status[WQUEUE_THREAD_N];
-
-    pthread_t       pthreads[WQUEUE_THREAD_N];
-    pthread_attr_t  attr;
+    // items pushed and not yet finished
+    size_t          unfinished;
+    // signalled when a result is added, and broadcast when the last item
+    // finishes
+    pthread_cond_t  ready;
     pthread_mutex_t lock;
 };
 
@@ -44,25 +73,45 @@ struct _wqueue * wqueue_create ();
 void             wqueue_delete (struct _wqueue * wqueue);
 
 
+// items adopt argument, see wqueue_task
 struct _wqueue_item * wqueue_item_create (struct _wqueue * wqueue,
                                           void * (* callback) (void *),
-                                          void * argument);
+                                          void * argument,
+                                          void   (* release) (void *));
 void                  wqueue_item_delete (struct _wqueue_item * wqueue_item);
-struct _wqueue_item * wqueue_item_copy   (struct _wqueue_item * wqueue_item);
 
-void   wqueue_push (struct _wqueue * wqueue,
-                    void * (* callback) (void *),
-                    void * argument);
+void   wqueue_task       (struct _wqueue * wqueue,
+                          void * (* callback) (void *),
+                          void * context,
+                          void   (* release) (void *));
+// pushes work onto the wqueue of the work item calling it. may only be
+// called from within a work item
+void   wqueue_spawn_task (void * (* callback) (void *),
+                          void * context,
+                          void   (* release) (void *));
+// blocks until every item pushed has finished, running queued work meanwhile.
+// NULL results are not kept
 void   wqueue_wait (struct _wqueue * wqueue);
 void * wqueue_peek (struct _wqueue * wqueue);
 void   wqueue_pop  (struct _wqueue * wqueue);
+// like wqueue_pop, but returns the result instead of deleting it
+void * wqueue_take (struct _wqueue * wqueue);
+
+/*
+* Results may also be taken while work is still running, so they can be dealt
+* with as they come in. wqueue_next_result takes the oldest result, waiting
+* for one for up to timeout milliseconds, or for as long as it takes when
+* timeout is negative. It returns NULL when it times out, or once every item
+* has finished and every result has been taken, which wqueue_finished tells
+* apart. Call these from the thread which owns the wqueue, not from work
+* items.
+*/
+void * wqueue_next_result (struct _wqueue * wqueue, int timeout);
+int    wqueue_finished    (struct _wqueue * wqueue);
 
 
 struct _wqueue_result * wqueue_result_create (void * data);
 void                    wqueue_result_delete (struct _wqueue_result *);
 
 
-void   wqueue_run    (struct _wqueue * wqueue);
-void * wqueue_launch (struct _wqueue_item * wqueue_item);
-
 #endif
\ No newline at end of file